@@ -0,0 +1,212 @@
+/* drv-flash.c
+
+   written by agent
+   16 Oct 2026
+
+   Copyright (C) 2026 agent
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   version 2 as published by the Free Software Foundation.
+   Please refer to the file debian/copyright for further details.
+
+   -----------
+   DESCRIPTION
+   -----------
+
+   File-backed stand-ins for the NOR and NAND flash drivers.  The
+   flash image is a plain dump of the array, e.g. from nanddump
+   without OOB data.  Writes only clear bits, as they would on the
+   device, and erase sets whole erase blocks to 0xff.  There is no
+   OOB area, no ECC, and no bad block handling.
+
+   The NOR driver maps so that readers may use the image in place as
+   they would a memory mapped NOR array.  The NAND driver does not
+   map, forcing readers through the buffered paths.
+
+*/
+
+#include <config.h>
+#include <apex.h>
+#include <driver.h>
+#include <service.h>
+#include <linux/string.h>
+#include <error.h>
+#include <spinner.h>
+
+#include "host.h"
+
+#define REGION(d) ((struct host_region*) (d)->driver->priv)
+
+static int flash_open (struct descriptor_d* d)
+{
+  struct host_region* region = REGION (d);
+
+  if (!region->pb)
+    return -1;
+
+  /* Perform bounds check */
+  if (d->start > region->cb)
+    return ERROR_OPEN;
+
+  return 0;
+}
+
+/* flash_available
+
+   returns the number of bytes that may be transferred from the
+   current descriptor index, limited by the descriptor and by the
+   size of the image.
+
+*/
+
+static size_t flash_available (struct descriptor_d* d, size_t cb)
+{
+  struct host_region* region = REGION (d);
+  unsigned long index = d->start + d->index;
+
+  if (d->index + cb > d->length)
+    cb = d->length - d->index;
+  if (index >= region->cb)
+    return 0;
+  if (index + cb > region->cb)
+    cb = region->cb - index;
+  return cb;
+}
+
+static ssize_t flash_read (struct descriptor_d* d, void* pv, size_t cb)
+{
+  cb = flash_available (d, cb);
+  memcpy (pv, REGION (d)->pb + d->start + d->index, cb);
+  d->index += cb;
+  return cb;
+}
+
+static ssize_t flash_map (struct descriptor_d* d, const void** ppv, size_t cb)
+{
+  cb = flash_available (d, cb);
+  *ppv = REGION (d)->pb + d->start + d->index;
+  d->index += cb;
+  return cb;
+}
+
+static ssize_t flash_write (struct descriptor_d* d, const void* pv, size_t cb)
+{
+  unsigned char* pb;
+  const unsigned char* pbSrc = pv;
+  ssize_t cbWrote;
+
+  cb = flash_available (d, cb);
+  cbWrote = cb;
+  pb = REGION (d)->pb + d->start + d->index;
+
+  while (cb--)
+    *pb++ &= *pbSrc++;
+
+  d->index += cbWrote;
+  return cbWrote;
+}
+
+static void flash_erase (struct descriptor_d* d, size_t cb)
+{
+  struct host_region* region = REGION (d);
+
+  cb = flash_available (d, cb);
+
+  SPINNER_STEP;
+
+  while (cb > 0) {
+    unsigned long index = d->start + d->index;
+    unsigned long block = index & ~(region->cbEraseBlock - 1);
+    unsigned long available = region->cbEraseBlock - (index - block);
+    unsigned long cbBlock = region->cbEraseBlock;
+
+    if (available > cb)
+      available = cb;
+    if (block + cbBlock > region->cb)
+      cbBlock = region->cb - block;
+
+    memset (region->pb + block, 0xff, cbBlock);
+
+    d->index += available;
+    cb -= available;
+    SPINNER_STEP;
+  }
+}
+
+static int flash_query (struct descriptor_d* d, int index, void* pv)
+{
+  struct host_region* region = REGION (d);
+
+  if (!region->pb)
+    return ERROR_UNSUPPORTED;
+
+  switch (index) {
+  default:
+    return ERROR_UNSUPPORTED;
+  case QUERY_START:
+    *(unsigned long*)pv = 0;
+    break;
+  case QUERY_SIZE:
+    *(unsigned long*)pv = region->cb;
+    break;
+  case QUERY_ERASEBLOCKSIZE:
+    *(unsigned long*)pv = region->cbEraseBlock;
+    break;
+  case QUERY_IOSIZE:
+    if (!region->cbPage)
+      return ERROR_UNSUPPORTED;
+    *(unsigned long*)pv = region->cbPage;
+    break;
+  }
+
+  return 0;
+}
+
+#if !defined (CONFIG_SMALL)
+static void flash_report (void)
+{
+  if (host_nor.pb)
+    printf ("  nor:     %ld KiB, %ld KiB erase blocks\n",
+	    host_nor.cb/1024, host_nor.cbEraseBlock/1024);
+  if (host_nand.pb)
+    printf ("  nand:    %ld KiB, %ld KiB erase blocks, %ld byte pages\n",
+	    host_nand.cb/1024, host_nand.cbEraseBlock/1024,
+	    host_nand.cbPage);
+}
+#endif
+
+static __driver_3 struct driver_d nor_driver = {
+  .name = "nor-file",
+  .description = "file-backed NOR flash driver",
+  .flags = DRIVER_WRITEPROGRESS(5),
+  .priv = &host_nor,
+  .open = flash_open,
+  .close = close_helper,
+  .read = flash_read,
+  .write = flash_write,
+  .erase = flash_erase,
+  .seek = seek_helper,
+  .query = flash_query,
+  .map = flash_map,
+};
+
+static __driver_3 struct driver_d nand_driver = {
+  .name = "nand-file",
+  .description = "file-backed NAND flash driver",
+  .flags = DRIVER_WRITEPROGRESS(6),
+  .priv = &host_nand,
+  .open = flash_open,
+  .close = close_helper,
+  .read = flash_read,
+  .write = flash_write,
+  .erase = flash_erase,
+  .seek = seek_helper,
+  .query = flash_query,
+};
+
+static __service_6 struct service_d flash_service = {
+#if !defined (CONFIG_SMALL)
+  .report = flash_report,
+#endif
+};
@@ -0,0 +1,54 @@
+/* host.h
+
+   written by agent
+   16 Oct 2026
+
+   Copyright (C) 2026 agent
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   version 2 as published by the Free Software Foundation.
+   Please refer to the file debian/copyright for further details.
+
+   -----------
+   DESCRIPTION
+   -----------
+
+   Interface between the host startup code, built against the C
+   library, and the stand-in drivers, built against the APEX headers.
+   Only basic C types may appear here since the two sides don't share
+   a set of system headers.
+
+*/
+
+#if !defined (__HOST_H__)
+#    define   __HOST_H__
+
+/* ----- Includes */
+
+/* ----- Types */
+
+struct host_region {
+  unsigned char* pb;		/* Mapping of the backing file */
+  unsigned long cb;		/* Length of the region */
+  unsigned long start;		/* Physical address, memory only */
+  unsigned long cbEraseBlock;	/* Flash erase block size */
+  unsigned long cbPage;		/* Flash program page size */
+};
+
+/* ----- Globals */
+
+extern struct host_region host_memory;
+extern struct host_region host_nor;
+extern struct host_region host_nand;
+
+/* ----- Prototypes */
+
+extern int  host_read (void* pv, unsigned long cb);
+extern int  host_poll (void);
+extern void host_write (const void* pv, unsigned long cb);
+extern unsigned long host_time_us (void);
+extern void host_sleep_us (unsigned long us);
+extern void __attribute__((noreturn)) host_exit (int status);
+
+#endif  /* __HOST_H__ */
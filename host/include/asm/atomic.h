@@ -0,0 +1,8 @@
+#ifndef __ASM_HOST_ATOMIC_H
+#define __ASM_HOST_ATOMIC_H
+
+/* Only the type is needed by <linux/spinlock.h>. */
+
+typedef struct { volatile int counter; } atomic_t;
+
+#endif
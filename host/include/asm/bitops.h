@@ -0,0 +1,25 @@
+#ifndef __ASM_HOST_BITOPS_H
+#define __ASM_HOST_BITOPS_H
+
+#ifndef _LINUX_BITOPS_H
+#error only <linux/bitops.h> can be included directly
+#endif
+
+#include <asm-generic/bitops/non-atomic.h>
+/* Single threaded, so the atomic operations are the non-atomic ones */
+#define set_bit(nr,p)			__set_bit(nr,p)
+#define clear_bit(nr,p)			__clear_bit(nr,p)
+#define change_bit(nr,p)		__change_bit(nr,p)
+#define test_and_set_bit(nr,p)		__test_and_set_bit(nr,p)
+#define test_and_clear_bit(nr,p)	__test_and_clear_bit(nr,p)
+#define test_and_change_bit(nr,p)	__test_and_change_bit(nr,p)
+
+#include <asm-generic/bitops/__ffs.h>
+#include <asm-generic/bitops/ffz.h>
+#include <asm-generic/bitops/fls.h>
+#include <asm-generic/bitops/__fls.h>
+#include <asm-generic/bitops/fls64.h>
+#include <asm-generic/bitops/ffs.h>
+#include <asm-generic/bitops/hweight.h>
+
+#endif
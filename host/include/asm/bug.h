@@ -0,0 +1,6 @@
+#ifndef __ASM_HOST_BUG_H
+#define __ASM_HOST_BUG_H
+
+#include <asm-generic/bug.h>
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef __ASM_HOST_BYTEORDER_H
+#define __ASM_HOST_BYTEORDER_H
+
+#include <linux/compiler.h>
+#include <asm/types.h>
+
+#define __arch__swab32(x) __builtin_bswap32(x)
+#define __arch__swab64(x) __builtin_bswap64(x)
+
+#if !defined(__STRICT_ANSI__) || defined(__KERNEL__)
+#  define __BYTEORDER_HAS_U64__
+#endif
+
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#include <linux/byteorder/big_endian.h>
+#else
+#include <linux/byteorder/little_endian.h>
+#endif
+
+#endif
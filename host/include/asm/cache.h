@@ -0,0 +1,7 @@
+#ifndef __ASM_HOST_CACHE_H
+#define __ASM_HOST_CACHE_H
+
+#define L1_CACHE_SHIFT		6
+#define L1_CACHE_BYTES		(1 << L1_CACHE_SHIFT)
+
+#endif
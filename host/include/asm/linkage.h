@@ -0,0 +1 @@
+#include <asm-arm/linkage.h>
@@ -0,0 +1,6 @@
+#ifndef __ASM_HOST_PROCESSOR_H
+#define __ASM_HOST_PROCESSOR_H
+
+#define cpu_relax()	__asm__ __volatile__ ("" : : : "memory")
+
+#endif
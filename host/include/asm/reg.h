@@ -0,0 +1 @@
+#include <asm-arm/reg.h>
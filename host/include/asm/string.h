@@ -0,0 +1,10 @@
+#ifndef __ASM_HOST_STRING_H
+#define __ASM_HOST_STRING_H
+
+/* No architecture specific string routines.  The generic
+   declarations in <linux/string.h> are satisfied by src/lib and,
+   for the few routines APEX doesn't implement, the host C library. */
+
+#define memzero(p,n) memset ((p), 0, (n))
+
+#endif
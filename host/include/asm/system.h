@@ -0,0 +1,11 @@
+#ifndef __ASM_HOST_SYSTEM_H
+#define __ASM_HOST_SYSTEM_H
+
+#define mb()	__asm__ __volatile__ ("" : : : "memory")
+#define rmb()	mb()
+#define wmb()	mb()
+#define smp_mb()	mb()
+#define smp_rmb()	mb()
+#define smp_wmb()	mb()
+
+#endif
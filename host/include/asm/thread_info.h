@@ -0,0 +1,12 @@
+#ifndef __ASM_HOST_THREAD_INFO_H
+#define __ASM_HOST_THREAD_INFO_H
+
+/* Pulled in by <linux/time.h> through the spinlock headers.  There
+   are no threads in the loader. */
+
+struct thread_info {
+	unsigned long		flags;
+	int			preempt_count;
+};
+
+#endif
@@ -0,0 +1,69 @@
+/*
+ * Configuration for the host-native build of APEX.
+ *
+ * This file stands in for the one generated by kconfig.  It selects
+ * the target independent parts of the loader: command interpreter,
+ * region copy and checksum, environment, zlib, PNG, and the
+ * filesystem drivers.  Options that depend on a CPU, a board, or on
+ * the link map of the loader image are omitted.
+ */
+#define CONFIG_EXPERIMENTAL 1
+#define CONFIG_TARGET_DESCRIPTION "Linux host"
+#define CONFIG_CC_OPTIMIZE_FOR_SPEED 1
+#define CONFIG_LITTLEENDIAN 1
+#define CONFIG_ALLHELP 1
+#define CONFIG_ALPHABETIZE_COMMANDS 1
+#define CONFIG_PARTIAL_MATCHES 1
+#define CONFIG_TIME_COMMANDS 1
+#define CONFIG_BOOT_TRACE 1
+#define CONFIG_BOOT_TRACE_ENTRIES 64
+#define CONFIG_REGION_COPY_PIPELINE 1
+#define CONFIG_REGION_BUFFER_SIZE 16384
+#define CONFIG_CMD_BENCH 1
+#define CONFIG_CMD_CHECKSUM 1
+#define CONFIG_CMD_COPY 1
+#define CONFIG_CMD_COMPARE 1
+#define CONFIG_CMD_DRVINFO 1
+#define CONFIG_CMD_DUMP 1
+#define CONFIG_CMD_ECHO 1
+#define CONFIG_CMD_ENV 1
+#define CONFIG_CMD_IMAGE 1
+#define CONFIG_CMD_IMAGE_APEX 1
+#define CONFIG_CMD_IMAGE_UBOOT 1
+#define CONFIG_CMD_IMAGE_SHOW 1
+#define CONFIG_IMAGE_INFLATE 1
+#define CONFIG_LZO 1
+#define CONFIG_IMAGE_CACHE 1
+#define CONFIG_IMAGE_CACHE_REGION "nor:192k+64k"
+#define CONFIG_IMAGE_CACHE_INTERVAL 15
+#define CONFIG_IMAGE_PLAN 1
+#define CONFIG_IMAGE_BLOCK_CRC 1
+#define CONFIG_CMD_SETENV 1
+#define CONFIG_CMD_SETUNSET 1
+#define CONFIG_CMD_ERASE 1
+#define CONFIG_CMD_FILL 1
+#define CONFIG_CMD_WAIT 1
+#define CONFIG_CRC32_LSB 1
+#define CONFIG_CRC32_SLICE_BY_8 1
+#define CONFIG_DRIVER_CONSOLE_DEVICE "serial"
+#define CONFIG_DRIVER_FAT 1
+#define CONFIG_DRIVER_FAT_BLOCKDEVICE "nand"
+#define CONFIG_DRIVER_EXT2 1
+#define CONFIG_DRIVER_EXT2_BLOCKDEVICE "nand"
+#define CONFIG_DRIVER_JFFS2 1
+#define CONFIG_DRIVER_JFFS2_BLOCKDEVICE "nor:2m+2m"
+#define CONFIG_DRIVER_JFFS2_SUMMARY 1
+#define CONFIG_DRIVER_JFFS2_SNAPSHOT 1
+#define CONFIG_DRIVER_JFFS2_SNAPSHOT_REGION "nor:1536k+512k"
+#define CONFIG_DRIVER_FIS 1
+#define CONFIG_DRIVER_FIS_BLOCKDEVICE "nor:"
+#define CONFIG_DRIVER_BLOCK_CACHE 1
+#define CONFIG_DRIVER_BLOCK_CACHE_BLOCKS 64
+#define CONFIG_DRIVER_STATS 1
+#define CONFIG_USES_PATHNAME_PARSER 1
+#define CONFIG_ENV 1
+#define CONFIG_ENV_MUTABLE 1
+#define CONFIG_ENV_REGION "nor:128k+64k"
+#define CONFIG_ENV_CHECK_LEN 1024
+#define CONFIG_ALIASES 1
+#define CONFIG_VARIABLES 1
@@ -0,0 +1,26 @@
+/* memory.h
+
+   written by agent
+   16 Oct 2026
+
+   Copyright (C) 2026 agent
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   version 2 as published by the Free Software Foundation.
+   Please refer to the file debian/copyright for further details.
+
+   -----------
+   DESCRIPTION
+   -----------
+
+   There are no RAM banks to probe in the host build.  The memory
+   region is mapped by the host startup code and registered with the
+   memory driver before services are initialized.
+
+*/
+
+#if !defined (__MEMORY_H__)
+#    define   __MEMORY_H__
+
+#endif  /* __MEMORY_H__ */
@@ -0,0 +1,38 @@
+/* initialize.c
+
+   written by agent
+   16 Oct 2026
+
+   Copyright (C) 2026 agent
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   version 2 as published by the Free Software Foundation.
+   Please refer to the file debian/copyright for further details.
+
+   -----------
+   DESCRIPTION
+   -----------
+
+   Target initialization for the host build.  The only work is to
+   hand the memory region, already mapped by the host startup code,
+   to the memory driver in place of the SDRAM probe.
+
+*/
+
+#include <config.h>
+#include <apex.h>
+#include <service.h>
+#include <drv-mem.h>
+
+#include "host.h"
+
+static void target_init (void)
+{
+  memory_regions[0].start  = host_memory.start;
+  memory_regions[0].length = host_memory.cb;
+}
+
+static __service_0 struct service_d host_target_service = {
+  .init    = target_init,
+};
@@ -0,0 +1,313 @@
+/* main.c
+
+   written by agent
+   16 Oct 2026
+
+   Copyright (C) 2026 agent
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   version 2 as published by the Free Software Foundation.
+   Please refer to the file debian/copyright for further details.
+
+   -----------
+   DESCRIPTION
+   -----------
+
+   Host startup for the user-space build of APEX.  This is the only
+   file compiled against the C library.  It maps the files that back
+   the memory, nor, and nand stand-in drivers, sets up the terminal,
+   and hands control to the loader's init() which never returns.
+   End of input on stdin terminates the program so that command
+   scripts can be piped in.
+
+   o Addresses
+
+     The loader core freely converts between pointers and 32 bit
+     integers, e.g. in drv-mem and the image loaders.  The program is
+     linked without PIE and the memory region is mapped at its
+     physical address which must be below 4GiB.  Flash images are
+     mapped with MAP_32BIT for the same reason.
+
+   o Flash images
+
+     Flash dumps are mapped privately unless -w is given so that
+     erase and write commands don't modify the files.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "host.h"
+
+#if !defined (MAP_32BIT)
+# define MAP_32BIT 0
+#endif
+
+#define MEMORY_START_DEFAULT	(0x20000000)
+#define MEMORY_SIZE_DEFAULT	(64*1024*1024)
+#define ERASEBLOCK_DEFAULT	(128*1024)
+#define PAGE_DEFAULT		(2048)
+
+struct host_region host_memory;
+struct host_region host_nor;
+struct host_region host_nand;
+
+static struct termios termios_saved;
+static int fWritable;
+
+extern void init (void);
+
+static void usage (void)
+{
+  fprintf (stderr,
+"usage: apex-host [OPTIONS]\n"
+"  -m SIZE|FILE  size of memory, or file with its initial content (64m)\n"
+"  -a ADDRESS    physical address of memory (0x20000000)\n"
+"  -n FILE       NOR flash image\n"
+"  -N FILE       NAND flash image\n"
+"  -e SIZE       NOR erase block size (128k)\n"
+"  -E SIZE       NAND erase block size (128k)\n"
+"  -p SIZE       NAND page size (2k)\n"
+"  -w            write flash changes back to the image files\n"
+"Commands are read from stdin.  The program exits at end of input.\n");
+  exit (2);
+}
+
+static int parse_size (const char* sz, unsigned long* pl)
+{
+  char* pchEnd;
+  unsigned long l = strtoul (sz, &pchEnd, 0);
+
+  switch (*pchEnd) {
+  case 'k':
+  case 'K':
+    l *= 1024;
+    ++pchEnd;
+    break;
+  case 'm':
+  case 'M':
+    l *= 1024*1024;
+    ++pchEnd;
+    break;
+  }
+  if (*pchEnd || pchEnd == sz)
+    return -1;
+  *pl = l;
+  return 0;
+}
+
+static void fail (const char* sz)
+{
+  perror (sz);
+  exit (1);
+}
+
+static void map_file (struct host_region* region, const char* szPath,
+		      unsigned long address, unsigned long cbMin)
+{
+  int fd = open (szPath, fWritable ? O_RDWR : O_RDONLY);
+  struct stat st;
+  int flags = fWritable ? MAP_SHARED : MAP_PRIVATE;
+
+  if (fd < 0 || fstat (fd, &st))
+    fail (szPath);
+  region->cb = st.st_size > cbMin ? st.st_size : cbMin;
+  if (address)
+    flags |= MAP_FIXED_NOREPLACE;
+  else
+    flags |= MAP_32BIT;
+
+  region->pb = mmap ((void*) address, region->cb, PROT_READ | PROT_WRITE,
+		     flags, fd, 0);
+  if (region->pb == MAP_FAILED)
+    fail (szPath);
+  close (fd);
+
+	/* Reads past the end of a short file fault, so the tail of
+	   memory is backed by anonymous pages instead. */
+  if (region->cb > st.st_size) {
+    unsigned long cbFile = (st.st_size + getpagesize () - 1)
+      & ~(getpagesize () - 1);
+    if (cbFile < region->cb
+	&& mmap (region->pb + cbFile, region->cb - cbFile,
+		 PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED)
+      fail (szPath);
+  }
+}
+
+static void map_memory (const char* sz, unsigned long address)
+{
+  unsigned long cb = MEMORY_SIZE_DEFAULT;
+
+  host_memory.start = address;
+
+  if (sz && parse_size (sz, &cb)) {
+    map_file (&host_memory, sz, address, cb);
+    return;
+  }
+
+  host_memory.cb = cb;
+  host_memory.pb = mmap ((void*) address, cb, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE,
+			 -1, 0);
+  if (host_memory.pb == MAP_FAILED)
+    fail ("memory");
+}
+
+static void restore_terminal (void)
+{
+  tcsetattr (0, TCSANOW, &termios_saved);
+}
+
+static void setup_terminal (void)
+{
+  struct termios termios;
+
+  if (!isatty (0) || tcgetattr (0, &termios_saved))
+    return;
+
+	/* APEX echoes and edits the command line itself.  Signals are
+	   left enabled so that ^C still stops the program. */
+  termios = termios_saved;
+  termios.c_lflag &= ~(ICANON | ECHO);
+  termios.c_cc[VMIN] = 1;
+  termios.c_cc[VTIME] = 0;
+  tcsetattr (0, TCSANOW, &termios);
+  atexit (restore_terminal);
+}
+
+int host_read (void* pv, unsigned long cb)
+{
+  ssize_t cbRead;
+
+  do
+    cbRead = read (0, pv, cb);
+  while (cbRead < 0 && errno == EINTR);
+
+  if (cbRead <= 0)
+    host_exit (0);
+
+  return cbRead;
+}
+
+int host_poll (void)
+{
+  int cb = 0;
+
+	/* Polling must not see the end of input as a pending
+	   character or the ^C checks would consume it and exit
+	   before the command completes. */
+  return ioctl (0, FIONREAD, &cb) == 0 && cb > 0;
+}
+
+void host_write (const void* pv, unsigned long cb)
+{
+  while (cb) {
+    ssize_t cbWrote = write (1, pv, cb);
+    if (cbWrote < 0) {
+      if (errno == EINTR)
+	continue;
+      return;
+    }
+    pv += cbWrote;
+    cb -= cbWrote;
+  }
+}
+
+unsigned long host_time_us (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec*1000000UL + ts.tv_nsec/1000;
+}
+
+void host_sleep_us (unsigned long us)
+{
+  struct timespec ts = { .tv_sec = us/1000000, .tv_nsec = (us%1000000)*1000 };
+
+  while (nanosleep (&ts, &ts) && errno == EINTR)
+    ;
+}
+
+void host_exit (int status)
+{
+  host_write ("\n", 1);
+  exit (status);
+}
+
+int main (int argc, char** argv)
+{
+  const char* szMemory = NULL;
+  const char* szNor = NULL;
+  const char* szNand = NULL;
+  unsigned long address = MEMORY_START_DEFAULT;
+  int ch;
+
+  host_nor.cbEraseBlock = ERASEBLOCK_DEFAULT;
+  host_nand.cbEraseBlock = ERASEBLOCK_DEFAULT;
+  host_nand.cbPage = PAGE_DEFAULT;
+
+  while ((ch = getopt (argc, argv, "m:a:n:N:e:E:p:w")) != -1) {
+    switch (ch) {
+    case 'm':
+      szMemory = optarg;
+      break;
+    case 'a':
+      if (parse_size (optarg, &address))
+	usage ();
+      break;
+    case 'n':
+      szNor = optarg;
+      break;
+    case 'N':
+      szNand = optarg;
+      break;
+    case 'e':
+      if (parse_size (optarg, &host_nor.cbEraseBlock))
+	usage ();
+      break;
+    case 'E':
+      if (parse_size (optarg, &host_nand.cbEraseBlock))
+	usage ();
+      break;
+    case 'p':
+      if (parse_size (optarg, &host_nand.cbPage))
+	usage ();
+      break;
+    case 'w':
+      fWritable = 1;
+      break;
+    default:
+      usage ();
+    }
+  }
+  if (optind != argc
+      || address >= 0x100000000UL
+      || !host_nor.cbEraseBlock || !host_nand.cbEraseBlock
+      || !host_nand.cbPage)
+    usage ();
+
+  map_memory (szMemory, address);
+  if (szNor)
+    map_file (&host_nor, szNor, 0, 0);
+  if (szNand)
+    map_file (&host_nand, szNand, 0, 0);
+
+  setup_terminal ();
+
+  init ();			/* Never returns */
+  return 0;
+}
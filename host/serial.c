@@ -0,0 +1,64 @@
+/* serial.c
+
+   written by agent
+   16 Oct 2026
+
+   Copyright (C) 2026 agent
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   version 2 as published by the Free Software Foundation.
+   Please refer to the file debian/copyright for further details.
+
+   -----------
+   DESCRIPTION
+   -----------
+
+   Console driver for the host build using stdin and stdout.  Line
+   feeds are delivered as carriage returns since that is what the
+   command reader expects from a terminal.
+
+*/
+
+#include <config.h>
+#include <driver.h>
+
+#include "host.h"
+
+static ssize_t host_serial_poll (struct descriptor_d* d, size_t cb)
+{
+  return cb ? host_poll () : 0;
+}
+
+static ssize_t host_serial_read (struct descriptor_d* d, void* pv, size_t cb)
+{
+  ssize_t cRead = 0;
+  unsigned char* pb;
+
+  for (pb = (unsigned char*) pv; cb--; ++pb) {
+    host_read (pb, 1);		/* Exits at end of input */
+    if (*pb == '\n')
+      *pb = '\r';
+    ++cRead;
+  }
+
+  return cRead;
+}
+
+static ssize_t host_serial_write (struct descriptor_d* d,
+				  const void* pv, size_t cb)
+{
+  host_write (pv, cb);
+  return cb;
+}
+
+static __driver_0 struct driver_d host_serial_driver = {
+  .name = "serial-host",
+  .description = "host stdin/stdout serial driver",
+  .flags = DRIVER_SERIAL | DRIVER_CONSOLE,
+  .open = open_helper,          /* Always succeed */
+  .close = close_helper,
+  .read = host_serial_read,
+  .write = host_serial_write,
+  .poll = host_serial_poll,
+};
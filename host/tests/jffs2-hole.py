@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+#
+# jffs2-hole.py
+#
+# Regression test for JFFS2 files with a hole node longer than the
+# driver's 4KiB block.  Linux writes such a node, a COMPRESSION_ZERO
+# node with no data, when a file is extended by truncate().  The test
+# builds a NOR image with one file made of a data node, a 16KiB zero
+# node, and another data node.  apex-host reads the file whole and in
+# pieces that start inside the hole, and the POSIX cksum of each read
+# must match the expected contents.
+#
+# usage: jffs2-hole.py APEX-HOST
+#
+
+import struct
+import subprocess
+import sys
+import tempfile
+
+CB_NOR = 4*1024*1024
+IB_JFFS2 = 2*1024*1024		# jffs2-drv default, nor:2m+2m
+CB_ERASEBLOCK = 64*1024
+
+MARKER = 0x1985
+NODE_DIRENT = 0xe001
+NODE_INODE = 0xe002
+COMPRESSION_NONE = 0x00
+COMPRESSION_ZERO = 0x01
+
+
+def crc_table(poly):
+    table = []
+    for i in range(256):
+        c = i << 24
+        for _ in range(8):
+            c = ((c << 1) ^ poly) if c & 0x80000000 else (c << 1)
+            c &= 0xffffffff
+        table.append(c)
+    return table
+
+TABLE = crc_table(0x04c11db7)
+
+def crc_msb(crc, data):
+    for b in data:
+        crc = ((crc << 8) & 0xffffffff) ^ TABLE[((crc >> 24) ^ b) & 0xff]
+    return crc
+
+def crc_jffs2(data):
+    """CRC as computed by the APEX JFFS2 driver."""
+    return ~crc_msb(0xffffffff, data) & 0xffffffff
+
+def cksum(data):
+    """POSIX cksum, as printed by the checksum command."""
+    crc = crc_msb(0, data)
+    n = len(data)
+    while n:
+        crc = crc_msb(crc, bytes([n & 0xff]))
+        n >>= 8
+    return ~crc & 0xffffffff
+
+
+def header(node_type, length):
+    h = struct.pack('<HHI', MARKER, node_type, length)
+    return h + struct.pack('<I', crc_jffs2(h))
+
+def dirent(pino, ino, name, dtype, version=1):
+    name = name.encode()
+    b = header(NODE_DIRENT, 40 + len(name))
+    b += struct.pack('<IIIIBBxx', pino, version, ino, 0, len(name), dtype)
+    b += struct.pack('<I', crc_jffs2(b))
+    return b + struct.pack('<I', crc_jffs2(name)) + name
+
+def inode(ino, mode, isize, offset, data, version, compr=COMPRESSION_NONE,
+          dsize=None):
+    if dsize is None:
+        dsize = len(data)
+    b = header(NODE_INODE, 68 + len(data))
+    b += struct.pack('<IIIHHIIIIIIIBBH', ino, version, mode, 0, 0, isize,
+                     0, 0, 0, offset, len(data), dsize, compr, 0, 0)
+    b += struct.pack('<II', crc_jffs2(data), crc_jffs2(b))
+    return b + data
+
+def pad(b):
+    return b + b'\xff'*((-len(b)) & 3)
+
+
+def main():
+    apex = sys.argv[1]
+
+    head = bytes(range(256))*16			# 4KiB at 0
+    cbHole = 16*1024				# Zero node at 4KiB
+    tail = b'tail of the file after the hole'*32
+    ibTail = len(head) + cbHole
+    contents = head + bytes(cbHole) + tail
+
+    fs = b''
+    fs += pad(inode(2, 0o100644, len(head), 0, head, 1))
+    fs += pad(inode(2, 0o100644, ibTail, len(head), b'', 2,
+                    COMPRESSION_ZERO, cbHole))
+    fs += pad(inode(2, 0o100644, len(contents), ibTail, tail, 3))
+    fs += pad(dirent(1, 2, 'hole', 8))
+    fs += b'\xff'*((-len(fs)) % CB_ERASEBLOCK)
+
+    nor = bytearray(b'\xff'*CB_NOR)
+    nor[IB_JFFS2:IB_JFFS2 + len(fs)] = fs
+
+    checks = [('jffs2:/hole', contents),
+              ('jffs2:/hole+%d' % (8*1024), contents[:8*1024]),
+              ('jffs2:/hole@%d+%d' % (6*1024, 8*1024),
+               contents[6*1024:14*1024]),
+              ('jffs2:/hole@%d' % (ibTail - 100), contents[ibTail - 100:])]
+
+    with tempfile.NamedTemporaryFile(suffix='.img') as f:
+        f.write(nor)
+        f.flush()
+        script = ''.join('checksum %s\n' % c[0] for c in checks)
+        out = subprocess.run([apex, '-e', '64k', '-n', f.name],
+                             input=script.encode(), stdout=subprocess.PIPE,
+                             stderr=subprocess.STDOUT).stdout.decode()
+
+    sums = [int(l.split()[1], 16) for l in out.splitlines()
+            if l.startswith('crc32 ')]
+    failed = len(sums) != len(checks)
+    for i, (region, data) in enumerate(checks):
+        expected = cksum(data)
+        got = sums[i] if i < len(sums) else None
+        ok = got == expected
+        failed = failed or not ok
+        print('%-24s %s' % (region, 'ok' if ok else
+                            'FAILED expected 0x%08x got %s'
+                            % (expected, got and '0x%08x' % got)))
+    if failed:
+        print(out)
+    return 1 if failed else 0
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,70 @@
+/* timer.c
+
+   written by agent
+   16 Oct 2026
+
+   Copyright (C) 2026 agent
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   version 2 as published by the Free Software Foundation.
+   Please refer to the file debian/copyright for further details.
+
+   -----------
+   DESCRIPTION
+   -----------
+
+   Timer for the host build.  Ticks are microseconds of the host's
+   monotonic clock counted from the timer service initialization.
+
+*/
+
+#include <config.h>
+#include <apex.h>
+#include <service.h>
+
+#include "host.h"
+
+static unsigned long time_start;
+
+static void host_timer_init (void)
+{
+  time_start = host_time_us ();
+}
+
+unsigned long timer_read (void)
+{
+  return host_time_us () - time_start;
+}
+
+
+/* timer_delta
+
+   returns the difference in time in milliseconds.
+
+ */
+
+unsigned long timer_delta (unsigned long start, unsigned long end)
+{
+  return (end - start)/1000;
+}
+
+/* timer_delta_ticks
+
+   returns the difference in time in timer ticks.
+
+ */
+
+unsigned long timer_delta_ticks (unsigned long start, unsigned long end)
+{
+  return end - start;
+}
+
+void usleep (unsigned long us)
+{
+  host_sleep_us (us);
+}
+
+static __service_2 struct service_d host_timer_service = {
+  .init    = host_timer_init,
+};
@@ -63,6 +63,7 @@ extern void __attribute__((noreturn)) exec_monitor (void);
 
 extern unsigned long timer_read (void);
 extern unsigned long timer_delta (unsigned long, unsigned long);
+extern unsigned long timer_delta_ticks (unsigned long, unsigned long);
 extern void usleep (unsigned long);
 #define udelay usleep		/* Just for convenience */
 static inline void msleep (int c) {	/* Only way to guarantee the range */
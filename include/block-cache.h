@@ -0,0 +1,45 @@
+/* block-cache.h
+
+   written by agent
+   16 Oct 2026
+
+   Copyright (C) 2026 agent
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   version 2 as published by the Free Software Foundation.
+   Please refer to the file debian/copyright for further details.
+
+   -----------
+   DESCRIPTION
+   -----------
+
+   Shared block cache for filesystem drivers.  Reads of metadata go
+   through block_cache_read() which has the same semantics as the
+   read() method of the underlying driver.  When the cache isn't
+   configured, the calls fall through to the driver.
+
+*/
+
+#if !defined (__BLOCK_CACHE_H__)
+#    define   __BLOCK_CACHE_H__
+
+/* ----- Includes */
+
+#include <driver.h>
+
+/* ----- Types */
+
+/* ----- Globals */
+
+/* ----- Prototypes */
+
+#if defined (CONFIG_DRIVER_BLOCK_CACHE)
+ssize_t block_cache_read (struct descriptor_d* d, void* pv, size_t cb);
+void block_cache_invalidate (const struct driver_d* driver);
+#else
+# define block_cache_read(d,pv,cb)	((d)->driver->read (d, pv, cb))
+# define block_cache_invalidate(p)	do { } while (0)
+#endif
+
+#endif  /* __BLOCK_CACHE_H__ */
@@ -0,0 +1,59 @@
+/* crc32.h
+
+   written by agent
+   16 Oct 2026
+
+   Copyright (C) 2026 agent
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   version 2 as published by the Free Software Foundation.
+   Please refer to the file debian/copyright for further details.
+
+   -----------
+   DESCRIPTION
+   -----------
+
+   CRC32 routines.  compute_crc32 is the MSB order CRC compatible with
+   POSIX cksum.  compute_crc32_lsb is the LSB order CRC used by U-Boot
+   and zlib.
+
+   crc32_combine and crc32_combine_lsb return the CRC of two
+   concatenated sequences from the CRCs of each, the second computed
+   from zero, and the length of the second.  This lets a region be
+   checked in independent pieces, in any order, and lets a check
+   resume from a saved partial CRC.
+
+   CRC32_TABLE_ROWS is the number of lookup table rows used by the
+   table implementations, one per byte processed in each step.  It is
+   zero for the bitwise implementations used in SMALL builds.
+
+*/
+
+#if !defined (__CRC32_H__)
+#    define   __CRC32_H__
+
+/* ----- Includes */
+
+#include <linux/types.h>
+
+/* ----- Types */
+
+#if defined (CONFIG_CRC32_SLICE_BY_8)
+# define CRC32_TABLE_ROWS	(8)
+#elif defined (CONFIG_CRC32_SLICE_BY_4)
+# define CRC32_TABLE_ROWS	(4)
+#elif defined (CONFIG_CRC32_BYTE_TABLE)
+# define CRC32_TABLE_ROWS	(1)
+#else
+# define CRC32_TABLE_ROWS	(0)
+#endif
+
+/* ----- Prototypes */
+
+uint32_t compute_crc32     (uint32_t crc, const void* pv, int cb);
+uint32_t compute_crc32_lsb (uint32_t crc, const void* pv, int cb);
+uint32_t crc32_combine     (uint32_t crc1, uint32_t crc2, size_t cb2);
+uint32_t crc32_combine_lsb (uint32_t crc1, uint32_t crc2, size_t cb2);
+
+#endif  /* __CRC32_H__ */
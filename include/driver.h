@@ -65,6 +65,8 @@ struct descriptor_d {
 #define QUERY_START             2	/* Physical address of device */
 #define QUERY_SIZE              3	/* Total size of device */
 #define QUERY_ERASEBLOCKSIZE    4	/* Erase block size at given index */
+#define QUERY_IOSIZE            5	/* Preferred unit of transfer */
+#define QUERY_DEVICE            6	/* Descriptor of underlying device */
 
 #define DRIVER_SERIAL           (1<<1)		/* Serial, UART, device */
 #define DRIVER_CONSOLE          (1<<2)          /* May be used as console */
@@ -96,6 +98,8 @@ int o = ((dou)->driver->flags >> DRIVER_WRITEPROGRESS_SHIFT)\
 #define driver_can_seek(p)  ((p)->seek != NULL)
 #define driver_can_read(p)  ((p)->read != NULL)
 #define driver_can_write(p) ((p)->write != NULL)
+#define driver_can_map(p)   ((p)->map != NULL)
+#define driver_can_overlap(p) ((p)->write_start != NULL && (p)->poll != NULL)
 
 #define descriptor_query(d,i,pv)\
 	((d)->driver->query\
@@ -118,6 +122,10 @@ struct driver_d {
   int		(*info)  (struct descriptor_d*);
   int		(*query) (struct descriptor_d*, int, void*);
   void		(*flush) (struct descriptor_d*);
+  ssize_t	(*map)   (struct descriptor_d*, const void** ppv, size_t cb);
+	/* Overlapped write.  The data must remain untouched until
+	   poll() returns non-zero, zero meaning the write is busy. */
+  ssize_t	(*write_start) (struct descriptor_d*, const void* pv, size_t cb);
 };
 
 #define __driver_0 __used __section(.driver.0) /* serial */
@@ -139,11 +147,17 @@ extern void   close_descriptor (struct descriptor_d* d);
 extern int    is_descriptor_open (struct descriptor_d* d);
 extern int    open_descriptor (struct descriptor_d* d);
 extern int    parse_descriptor (const char* sz, struct descriptor_d* d);
+extern ssize_t read_mapped (struct descriptor_d* d, const void** ppv,
+                            void* pv, size_t cb);
 extern int    parse_descriptor_simple (const char* sz, unsigned long start,
 				       unsigned long length,
 				       struct descriptor_d* d);
 //extern size_t seek_helper (struct descriptor_d* d, ssize_t ib, int whence);
 extern driver_off_t seek_helper (struct descriptor_d* d, driver_off_t ib,
                                  int whence);
+#if defined (CONFIG_DRIVER_STATS)
+extern void   driver_stats_report (void);
+extern void   driver_stats_reset (void);
+#endif
 
 #endif  /* __DRIVER_H__ */
@@ -0,0 +1,84 @@
+/* inflate.h
+
+   written by agent
+   16 Oct 2026
+
+   Copyright (C) 2026 agent
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   version 2 as published by the Free Software Foundation.
+   Please refer to the file debian/copyright for further details.
+
+   -----------
+   DESCRIPTION
+   -----------
+
+   Deflate decompression into a contiguous output buffer.  The output
+   buffer is the window, so the whole stream must be inflated in one
+   call to a single buffer.  Input is supplied in pieces through the
+   fill callback.  The decoder needs no heap and no window buffer.
+   Its decoding tables are static and about 8KiB.
+
+   The callback is called when next_in is exhausted.  It sets next_in
+   and avail_in and returns a positive value, or returns zero or less
+   when there is no more input.  It may be NULL when all of the input
+   is present on entry.
+
+   inflate_zlib and inflate_gzip check the Adler-32 or CRC32 in the
+   stream trailer.  The check is computed as the output is written,
+   over each new piece of output when a block ends and before each
+   call to the fill callback, so the output is never read again in a
+   second pass.
+
+*/
+
+#if !defined (__INFLATE_H__)
+#    define   __INFLATE_H__
+
+/* ----- Includes */
+
+#include <linux/types.h>
+
+/* ----- Types */
+
+enum {
+  INFLATE_OK		=  0,
+  INFLATE_E_DATA	= -1,	/* Corrupt deflate data */
+  INFLATE_E_INPUT	= -2,	/* Input ends before the stream */
+  INFLATE_E_OUTPUT	= -3,	/* Output buffer is too small */
+  INFLATE_E_CHECK	= -4,	/* Adler-32 or CRC32 mismatch */
+};
+
+enum {
+  INFLATE_CHECK_NONE	= 0,
+  INFLATE_CHECK_ADLER32	= 1,
+  INFLATE_CHECK_CRC32	= 2,
+};
+
+struct inflate_d {
+  const unsigned char* next_in;
+  size_t avail_in;
+  int (*fill) (struct inflate_d*);
+  void* context;		/* For the fill callback */
+
+  unsigned char* out;		/* Output buffer and window */
+  size_t cbOut;			/* Size of the output buffer */
+  size_t total_out;		/* Bytes written to out */
+
+  int check;			/* INFLATE_CHECK_ type of the output */
+  unsigned long checksum;	/* Running check of the output */
+  size_t ibCheck;		/* Output covered by checksum */
+
+  unsigned long hold;		/* Bit buffer */
+  unsigned bits;		/* Bits in the bit buffer */
+};
+
+/* ----- Prototypes */
+
+void inflate_init (struct inflate_d* inf, void* out, size_t cbOut);
+int inflate_raw (struct inflate_d* inf);
+int inflate_zlib (struct inflate_d* inf);
+int inflate_gzip (struct inflate_d* inf);
+
+#endif  /* __INFLATE_H__ */
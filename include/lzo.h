@@ -0,0 +1,46 @@
+/* lzo.h
+
+   written by agent
+   16 Oct 2026
+
+   Copyright (C) 2026 agent
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   version 2 as published by the Free Software Foundation.
+   Please refer to the file debian/copyright for further details.
+
+   -----------
+   DESCRIPTION
+   -----------
+
+   LZO1X block decompression.  This is the format written by the
+   LZO1X compressors of liblzo, lzop, and the Linux kernel, used for
+   JFFS2 nodes and for lzop files.  The result codes match liblzo.
+
+*/
+
+#if !defined (__LZO_H__)
+#    define   __LZO_H__
+
+/* ----- Includes */
+
+#include <linux/types.h>
+
+/* ----- Types */
+
+enum {
+  LZO_E_OK			=  0,
+  LZO_E_ERROR			= -1,
+  LZO_E_INPUT_OVERRUN		= -4,
+  LZO_E_OUTPUT_OVERRUN		= -5,
+  LZO_E_LOOKBEHIND_OVERRUN	= -6,
+  LZO_E_INPUT_NOT_CONSUMED	= -8,
+};
+
+/* ----- Prototypes */
+
+int lzo1x_decompress (const void* src, size_t cbSrc,
+                      void* dst, size_t* pcbDst);
+
+#endif  /* __LZO_H__ */
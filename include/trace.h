@@ -0,0 +1,63 @@
+/* trace.h
+
+   written by agent
+   16 Oct 2026
+
+   Copyright (C) 2026 agent
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   version 2 as published by the Free Software Foundation.
+   Please refer to the file debian/copyright for further details.
+
+   -----------
+   DESCRIPTION
+   -----------
+
+   Boot phase trace.  TRACE() records a timestamped event in a ring
+   that can be shown with the trace command and is passed to the
+   kernel in an ATAG.  The macro compiles to nothing unless
+   CONFIG_BOOT_TRACE is set.
+
+*/
+
+#if !defined (__TRACE_H__)
+#    define   __TRACE_H__
+
+/* ----- Includes */
+
+#include <linux/types.h>
+
+/* ----- Types */
+
+enum {
+  traceService	= 1,		/* Service init, arg is the index */
+  traceCommand	= 2,		/* Command from the startup script */
+  traceOpen	= 3,		/* Descriptor opened */
+  traceImage	= 4,		/* Image load phase, arg is the payload */
+  traceBoot	= 5,		/* Control passed to the kernel */
+};
+
+#define CB_TRACE_LABEL	(16)
+
+struct trace_entry {
+  u32 time;			/* Timer ticks, ms from trace_get () */
+  u16 type;
+  u16 arg;
+  char sz[CB_TRACE_LABEL];	/* Truncated, not always terminated */
+};
+
+/* ----- Globals */
+
+/* ----- Prototypes */
+
+#if defined (CONFIG_BOOT_TRACE)
+void trace_event (int type, int arg, const char* sz);
+int  trace_count (void);
+void trace_get (int i, struct trace_entry* entry);
+# define TRACE(t,a,sz)	trace_event (t, a, sz)
+#else
+# define TRACE(t,a,sz)	do { } while (0)
+#endif
+
+#endif  /* __TRACE_H__ */
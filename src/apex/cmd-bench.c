@@ -0,0 +1,613 @@
+/* cmd-bench.c
+
+   written by agent
+   16 Oct 2026
+
+   Copyright (C) 2026 agent
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   version 2 as published by the Free Software Foundation.
+   Please refer to the file debian/copyright for further details.
+
+   -----------
+   DESCRIPTION
+   -----------
+
+   Throughput measurements for board bring-up.  Each test repeats an
+   operation until it has run for at least MS_BENCH milliseconds and
+   reports the rate in MiB/s.  The rates are also stored in variables,
+   e.g. bench-memcpy, so that startup commands can log them.
+
+   o Scratch memory
+
+     The mem, crc, and inflate tests need a memory region to work in.
+     Nothing in APEX tracks free memory, so the user supplies it.
+
+   o Inflate
+
+     The inflate test decompresses an embedded zlib stream, a copy of
+     docs/Sections compressed with zlib level 9, with the inflate
+     engine used for images and JFFS2.  The inflate-zlib test
+     decompresses the same stream with zlib, as used by the PNG
+     reader, for comparison.  Every zlib inflate starts with
+     zlib_heap_reset() which clears the whole zlib heap.  The time for
+     the setup alone is measured separately and subtracted so that the
+     rate reflects the decompressor.
+
+*/
+
+#include <config.h>
+#include <linux/types.h>
+#include <linux/string.h>
+#include <linux/kernel.h>
+#include <apex.h>
+#include <command.h>
+#include <driver.h>
+#include <error.h>
+#include <variables.h>
+#include <inflate.h>
+#include <zlib.h>
+#include <zlib-heap.h>
+#include "region-copy.h"
+
+#define MS_BENCH	(250)		/* Minimum duration of each test */
+#define CB_BATCH	(64*1024)	/* Bytes between timer reads */
+
+extern uint32_t compute_crc32 (uint32_t crc, const void *pv, int cb);
+#if defined (CONFIG_CRC32_LSB)
+extern uint32_t compute_crc32_lsb (uint32_t crc, const void *pv, int cb);
+#endif
+
+#define CB_INFLATE_OUT	(5256)
+#define CRC_INFLATE_OUT	(0xf5c3b56c)
+
+static const unsigned char rgbInflate[] = {
+  0x78, 0xda, 0x7d, 0x58, 0x4d, 0x6f, 0xe4, 0x36, 0x12, 0xbd, 0xf3, 0x57,
+  0xf0, 0xe6, 0x99, 0xa0, 0xb7, 0x81, 0x04, 0xc8, 0x25, 0xc0, 0x1c, 0xbc,
+  0x1e, 0x2f, 0x30, 0x40, 0xe6, 0x03, 0x1e, 0x07, 0xd9, 0x2b, 0x5b, 0xaa,
+  0xee, 0xe6, 0x9a, 0x22, 0x15, 0x92, 0x72, 0xbb, 0xe7, 0xd7, 0xe7, 0x55,
+  0x91, 0x94, 0xd4, 0x6d, 0x67, 0x7d, 0x99, 0x44, 0x2d, 0xd6, 0xc7, 0xab,
+  0xaa, 0x57, 0x8f, 0xfa, 0xf0, 0xe1, 0x1f, 0xff, 0x94, 0xe6, 0xbf, 0xdb,
+  0x6f, 0xf7, 0xff, 0xd5, 0xff, 0x0e, 0x21, 0xeb, 0xdf, 0x83, 0xe9, 0x29,
+  0x96, 0xa7, 0xf8, 0xfb, 0x4e, 0x5d, 0xb6, 0xc1, 0x27, 0xf5, 0xe1, 0xff,
+  0x98, 0x50, 0x9f, 0xa7, 0xee, 0xa8, 0xc3, 0x5e, 0xe7, 0x23, 0xe9, 0x10,
+  0x0f, 0xc6, 0xdb, 0x1f, 0x86, 0x8f, 0xb5, 0x67, 0x62, 0x7e, 0x67, 0xbd,
+  0x89, 0x67, 0x6d, 0x07, 0x73, 0x20, 0x6d, 0x93, 0xee, 0x82, 0xcf, 0x31,
+  0x38, 0x47, 0xbd, 0xde, 0x9d, 0xf9, 0x35, 0xe5, 0xac, 0x7f, 0xa2, 0xa8,
+  0x53, 0x17, 0xed, 0x98, 0xb5, 0xf1, 0xbd, 0x4e, 0xd5, 0x3d, 0xff, 0x1c,
+  0xc9, 0xfa, 0xad, 0xd6, 0x8f, 0x47, 0x9c, 0x3d, 0x9a, 0xa4, 0x77, 0xd4,
+  0x85, 0x81, 0x74, 0x9a, 0xf6, 0x7b, 0xdb, 0x59, 0xf2, 0xd9, 0x9d, 0x15,
+  0x9e, 0x8c, 0x8e, 0x5e, 0xf0, 0x10, 0x01, 0xe5, 0xa3, 0xc9, 0xba, 0x0f,
+  0xdd, 0x34, 0xe0, 0xc7, 0x12, 0x4f, 0x1a, 0xa9, 0xb3, 0x78, 0x5d, 0xe7,
+  0x20, 0x81, 0x35, 0x8f, 0xcd, 0x8d, 0x4d, 0xca, 0x53, 0x47, 0x29, 0x71,
+  0xa4, 0x78, 0x67, 0x30, 0x4f, 0xf0, 0x40, 0x3e, 0x11, 0xa7, 0x62, 0xf3,
+  0x56, 0xa9, 0x8a, 0x88, 0xf6, 0x66, 0xa0, 0xa4, 0x8d, 0x3b, 0x99, 0x33,
+  0xc7, 0x72, 0xb0, 0x5e, 0x9f, 0x6c, 0x3e, 0x6a, 0xa3, 0x47, 0x8a, 0x36,
+  0xf4, 0x1a, 0x0f, 0x42, 0x04, 0x96, 0x6c, 0xc7, 0xa6, 0xe0, 0x4c, 0x26,
+  0xc9, 0xb2, 0x3a, 0xd3, 0xe9, 0x3c, 0xec, 0x82, 0x4b, 0x7a, 0x1f, 0xc3,
+  0xa0, 0x03, 0x27, 0xa8, 0x0f, 0x2e, 0xec, 0x0c, 0x1e, 0xe1, 0x68, 0x8b,
+  0x0e, 0x19, 0x7f, 0x09, 0x2d, 0x40, 0xc4, 0x73, 0x2e, 0xbe, 0x94, 0xf8,
+  0xe2, 0x97, 0x52, 0x8e, 0xd6, 0x1f, 0xf4, 0xcd, 0x36, 0x92, 0xbb, 0x61,
+  0x50, 0xcc, 0x94, 0x68, 0x9d, 0xdc, 0xc9, 0x3a, 0xa7, 0x05, 0x18, 0x23,
+  0x76, 0x01, 0x8a, 0xcd, 0x5c, 0x00, 0xa3, 0x70, 0x24, 0x74, 0x15, 0x99,
+  0xe2, 0x01, 0x09, 0x3e, 0xe2, 0xe8, 0x18, 0x51, 0x26, 0x40, 0x70, 0x9c,
+  0x62, 0xef, 0x28, 0x95, 0x53, 0x62, 0x53, 0xda, 0x43, 0x93, 0xef, 0xc2,
+  0xe4, 0x33, 0xc5, 0xb4, 0x81, 0xcb, 0x7d, 0x88, 0xc4, 0x36, 0x3b, 0xe3,
+  0x35, 0xbd, 0x50, 0x37, 0x65, 0x52, 0x28, 0x90, 0xd1, 0xbb, 0xe0, 0xcd,
+  0xde, 0xf6, 0xa4, 0xef, 0x60, 0x31, 0x1c, 0xa2, 0x19, 0xb4, 0x89, 0xf4,
+  0x9b, 0x42, 0x7b, 0x05, 0x4e, 0xeb, 0xe1, 0xf6, 0xb3, 0x7e, 0xf7, 0xfd,
+  0x23, 0xfe, 0xd9, 0xe8, 0x8f, 0x1f, 0x1f, 0xde, 0xb7, 0xe7, 0x29, 0x9b,
+  0xee, 0xa9, 0xfd, 0xcf, 0x7e, 0xf2, 0x25, 0xf9, 0xce, 0x38, 0x97, 0xe4,
+  0xe9, 0x27, 0xc4, 0xcb, 0xb5, 0xb7, 0x1e, 0x6f, 0x7a, 0xd4, 0x6b, 0xa3,
+  0x9f, 0x09, 0xe1, 0x3a, 0x9b, 0xb3, 0xa3, 0xd6, 0x75, 0x35, 0x56, 0xce,
+  0xf4, 0xd9, 0x58, 0x67, 0x76, 0xf8, 0x09, 0xa1, 0xd6, 0x10, 0x61, 0x51,
+  0xa9, 0x3f, 0x8f, 0x54, 0xa0, 0x46, 0x78, 0x5c, 0x76, 0xfc, 0xea, 0xc8,
+  0x3c, 0x23, 0xe3, 0x87, 0xfb, 0xef, 0xf7, 0x8f, 0xd2, 0x83, 0x82, 0x77,
+  0x6a, 0xa7, 0x00, 0x75, 0x17, 0x7a, 0xda, 0xac, 0x3c, 0xa8, 0x61, 0x4a,
+  0x00, 0xd4, 0xdb, 0x6c, 0x8d, 0xb3, 0x3f, 0x48, 0xd7, 0x8c, 0xc6, 0xa9,
+  0x60, 0x86, 0x22, 0x78, 0x72, 0x78, 0x01, 0x8d, 0x50, 0x7f, 0x62, 0xbb,
+  0x99, 0x7d, 0xff, 0x6f, 0x1a, 0xc6, 0xda, 0x8c, 0xaa, 0xbe, 0x57, 0xba,
+  0x68, 0x44, 0x44, 0xa8, 0x02, 0x37, 0x4d, 0x9a, 0xc6, 0x31, 0x44, 0x71,
+  0xdd, 0x9b, 0x6c, 0xb8, 0xe2, 0x53, 0x97, 0xa7, 0x48, 0x09, 0xcd, 0xf1,
+  0x1d, 0x38, 0x64, 0x3b, 0x30, 0x04, 0x52, 0x55, 0x25, 0xa5, 0x22, 0x93,
+  0xce, 0xa8, 0x4c, 0x09, 0x00, 0xc5, 0x01, 0xea, 0xe8, 0x1d, 0x8f, 0x9e,
+  0xe6, 0x57, 0xf5, 0x89, 0x5d, 0x97, 0x26, 0xf0, 0x81, 0x9b, 0x9a, 0x41,
+  0xfd, 0x13, 0x7e, 0x03, 0x4e, 0x70, 0x51, 0x18, 0x26, 0x53, 0xca, 0xb0,
+  0x29, 0x50, 0x9b, 0xd8, 0x1d, 0x6d, 0xa6, 0xe2, 0x57, 0x2a, 0x2d, 0xb3,
+  0xe1, 0x43, 0x81, 0xae, 0xc7, 0x63, 0x21, 0x0d, 0x29, 0x52, 0x8d, 0x4b,
+  0xdf, 0x7d, 0xfb, 0x83, 0x67, 0xf5, 0x19, 0x90, 0xb0, 0x55, 0x99, 0xe8,
+  0xb7, 0x8d, 0xed, 0x08, 0xb0, 0x52, 0x84, 0x21, 0xb1, 0x22, 0x58, 0x4d,
+  0x49, 0xd0, 0x36, 0x1d, 0x30, 0x44, 0x3b, 0xc1, 0x02, 0xec, 0x7e, 0x92,
+  0xa8, 0x93, 0xd9, 0x13, 0x30, 0xc7, 0x4b, 0xe4, 0xec, 0x00, 0x62, 0xc9,
+  0xf4, 0x56, 0x1c, 0x1a, 0x3d, 0x6a, 0x1d, 0x26, 0x2d, 0x65, 0x1a, 0x24,
+  0x31, 0xc9, 0x94, 0x89, 0x8e, 0x4d, 0xcb, 0xe4, 0x7d, 0xb9, 0xfd, 0xf2,
+  0x51, 0xef, 0x9d, 0x49, 0x60, 0xb0, 0xa8, 0x3f, 0xfd, 0x72, 0xb7, 0xa9,
+  0x4d, 0x62, 0x98, 0x4a, 0x36, 0x32, 0x72, 0xc1, 0xbb, 0xb3, 0x3e, 0x58,
+  0xe4, 0x31, 0x25, 0xfd, 0xeb, 0xcf, 0xbf, 0x88, 0x87, 0xdd, 0x39, 0x23,
+  0x78, 0x01, 0xea, 0xe7, 0x27, 0xee, 0x39, 0xee, 0x0b, 0x09, 0xa9, 0x8c,
+  0x40, 0x1b, 0x8c, 0x13, 0x15, 0x08, 0xf0, 0x4b, 0x17, 0x46, 0x61, 0x3a,
+  0x8d, 0xb4, 0x29, 0x8b, 0x95, 0xcb, 0x5e, 0xcd, 0xa1, 0xa6, 0x79, 0x07,
+  0x36, 0xca, 0x11, 0x03, 0xcb, 0xec, 0xc8, 0xbc, 0x3c, 0xc0, 0x78, 0xe2,
+  0x1c, 0x9f, 0x79, 0x9e, 0x8c, 0xee, 0x6d, 0x04, 0x7e, 0x25, 0xd5, 0x23,
+  0x72, 0x25, 0x7f, 0x10, 0x17, 0xa7, 0x68, 0x25, 0x37, 0x54, 0x0f, 0xff,
+  0x70, 0x02, 0xd5, 0x74, 0x1d, 0xc0, 0x32, 0xe0, 0xb5, 0x25, 0x12, 0x61,
+  0x6c, 0x8c, 0xd3, 0x63, 0x18, 0x27, 0x67, 0xc0, 0x83, 0xc1, 0x4d, 0x95,
+  0x6f, 0xa5, 0x25, 0x93, 0xa0, 0x8a, 0xb9, 0x19, 0xd0, 0x5e, 0x77, 0x80,
+  0xa2, 0x8b, 0x81, 0x7f, 0x53, 0x6f, 0xa0, 0x5e, 0x10, 0xdf, 0xbc, 0x51,
+  0xb5, 0xcb, 0x6e, 0xe2, 0x26, 0xa8, 0x41, 0x2a, 0x3c, 0xa4, 0xd1, 0xc4,
+  0x6a, 0x47, 0xf8, 0x01, 0x8e, 0x8f, 0x78, 0xc5, 0x15, 0x0a, 0xe3, 0xd4,
+  0x19, 0x87, 0x71, 0x55, 0x2b, 0x36, 0x20, 0x74, 0x09, 0xb6, 0x7f, 0x0b,
+  0xa4, 0x6d, 0x5d, 0x67, 0x19, 0xfd, 0x99, 0x04, 0xa9, 0xfd, 0x1e, 0x09,
+  0xfb, 0x5c, 0x86, 0x0a, 0x81, 0x55, 0x92, 0xbb, 0x5c, 0x37, 0x3d, 0xed,
+  0x61, 0x88, 0x0f, 0x24, 0xfa, 0x6b, 0x02, 0xc1, 0x09, 0x8f, 0xb4, 0xcd,
+  0x00, 0xa3, 0xf7, 0x38, 0x39, 0x13, 0x31, 0x06, 0x2d, 0x9c, 0x7c, 0x59,
+  0x5d, 0x60, 0x7c, 0x83, 0xf1, 0xec, 0x04, 0xc2, 0x7c, 0x1e, 0xa9, 0x35,
+  0x03, 0x28, 0x00, 0xac, 0x8f, 0xec, 0x87, 0xcd, 0x45, 0xcb, 0x6f, 0x56,
+  0xc4, 0x2b, 0x1b, 0xed, 0x3a, 0x96, 0x0e, 0x6b, 0xd1, 0x64, 0xe1, 0x5d,
+  0xae, 0x41, 0x0b, 0x02, 0x56, 0x9c, 0x0b, 0x27, 0xc6, 0x57, 0x16, 0x49,
+  0x86, 0xdb, 0x69, 0x9c, 0xfb, 0x6e, 0xc7, 0x84, 0x08, 0x4e, 0x16, 0x06,
+  0xeb, 0x85, 0x47, 0x78, 0x9e, 0x23, 0xd2, 0xb1, 0xb2, 0x23, 0x2e, 0x99,
+  0xb4, 0xee, 0x52, 0x35, 0x9f, 0x91, 0xb6, 0x71, 0x29, 0xe8, 0xc3, 0x84,
+  0x9a, 0xe0, 0x69, 0x23, 0x7e, 0x3b, 0x30, 0xff, 0xe0, 0x49, 0x71, 0x85,
+  0xf9, 0x43, 0x5e, 0xa8, 0xba, 0xae, 0x4b, 0x21, 0x87, 0x51, 0xfd, 0xd3,
+  0xa6, 0xaf, 0x58, 0xa3, 0xe1, 0x27, 0x27, 0xa3, 0x2b, 0x16, 0x5b, 0x77,
+  0x96, 0xf7, 0x8b, 0x24, 0xa8, 0x34, 0x80, 0xed, 0xd5, 0x73, 0x36, 0xd8,
+  0xa2, 0x8c, 0x1c, 0xb6, 0x54, 0x59, 0xea, 0x4c, 0x84, 0x35, 0xe1, 0xd2,
+  0x4f, 0x0d, 0x5b, 0x26, 0x85, 0xe2, 0xfc, 0x68, 0x62, 0x7f, 0xe2, 0xbe,
+  0xfe, 0x09, 0xb6, 0x7e, 0x62, 0x63, 0xdc, 0x15, 0xd4, 0x6f, 0x94, 0xb8,
+  0x61, 0x07, 0x7d, 0xa8, 0x5b, 0x5c, 0xa4, 0xc3, 0xbc, 0xf6, 0x7d, 0xe7,
+  0xa6, 0x9e, 0x99, 0x76, 0x37, 0x3f, 0x13, 0x1a, 0x16, 0x71, 0xf1, 0x02,
+  0x1c, 0xb6, 0x8c, 0x9d, 0xb4, 0xde, 0x96, 0x5e, 0xd8, 0xc2, 0xa3, 0x54,
+  0x06, 0xfe, 0xd1, 0x27, 0xa6, 0x6d, 0xfa, 0x50, 0x96, 0x89, 0xa0, 0xc4,
+  0xe7, 0xeb, 0x1e, 0x9f, 0x37, 0x3e, 0xea, 0xe1, 0x7a, 0x26, 0xde, 0x1d,
+  0x2d, 0x3a, 0xa3, 0x22, 0x34, 0x3b, 0xe6, 0x04, 0x30, 0x38, 0xfb, 0xc0,
+  0xb5, 0x4e, 0x2d, 0x3b, 0x20, 0xe7, 0x6c, 0x62, 0x3d, 0x43, 0xc9, 0xdf,
+  0xa0, 0xd5, 0x4d, 0xee, 0x8e, 0xab, 0x35, 0xaf, 0x4a, 0xeb, 0x70, 0xcb,
+  0x81, 0xfc, 0x49, 0xd4, 0x95, 0xe9, 0x4a, 0x7d, 0xcc, 0x84, 0x4e, 0x88,
+  0x42, 0xf3, 0x5b, 0xcc, 0x41, 0x3c, 0x2b, 0x25, 0x85, 0x40, 0xfc, 0x36,
+  0xa6, 0x7c, 0x4d, 0x5c, 0x70, 0xf9, 0xd5, 0xeb, 0xdb, 0x87, 0xcf, 0x75,
+  0xa5, 0x68, 0xb2, 0xa2, 0x4e, 0x68, 0x18, 0x33, 0xb6, 0x0a, 0xc0, 0x6f,
+  0xfa, 0x41, 0xb6, 0x57, 0x78, 0x66, 0xe2, 0x5a, 0xa5, 0x29, 0x15, 0xae,
+  0xe1, 0xf3, 0xab, 0xef, 0xe0, 0xf4, 0x99, 0xa3, 0x7c, 0x8f, 0xc5, 0x63,
+  0x11, 0x35, 0xce, 0xd6, 0x2a, 0x2b, 0x90, 0x19, 0x28, 0x7a, 0x7f, 0xae,
+  0x8d, 0xe0, 0x0b, 0x13, 0xb7, 0x50, 0xe5, 0x94, 0x04, 0x6b, 0xae, 0x56,
+  0xdf, 0xdc, 0x26, 0x97, 0x06, 0x84, 0x25, 0xf0, 0x53, 0xfc, 0x17, 0x53,
+  0x41, 0x23, 0x15, 0xe8, 0xb3, 0x33, 0xf0, 0x31, 0xde, 0xcb, 0x14, 0x08,
+  0xd7, 0x73, 0x0f, 0x49, 0xd0, 0xf6, 0x00, 0x1e, 0x83, 0xc5, 0xe2, 0xb3,
+  0x10, 0xb3, 0xaa, 0xcd, 0xb7, 0x02, 0xe9, 0x72, 0x82, 0x17, 0x21, 0x59,
+  0x7b, 0x52, 0x58, 0x27, 0x35, 0x01, 0x62, 0x44, 0x49, 0x8e, 0x21, 0x25,
+  0xcb, 0xa2, 0xa3, 0xd6, 0x5d, 0xe6, 0xb3, 0xba, 0x28, 0xde, 0x66, 0x7a,
+  0xdb, 0x92, 0x89, 0xee, 0xba, 0x2c, 0x41, 0xd6, 0xfe, 0x04, 0x5d, 0x71,
+  0x9e, 0xc3, 0x85, 0xb7, 0x03, 0xe5, 0xf5, 0x7c, 0xf0, 0x42, 0x55, 0x55,
+  0x7c, 0x14, 0xd5, 0xdd, 0x26, 0xbb, 0xd4, 0x75, 0x71, 0x8e, 0xa8, 0xd2,
+  0x80, 0xc9, 0xe7, 0xff, 0x68, 0xb1, 0x6d, 0xa0, 0x40, 0xe0, 0x8a, 0x7c,
+  0x98, 0x0e, 0x47, 0x05, 0xb3, 0x55, 0x6c, 0x68, 0x09, 0x48, 0x2f, 0x3c,
+  0xb5, 0x61, 0x87, 0x47, 0x33, 0x72, 0x29, 0xfe, 0xb8, 0x7d, 0x78, 0x9c,
+  0x35, 0x0c, 0x33, 0xbc, 0x9a, 0xc5, 0x8f, 0xa9, 0x22, 0x92, 0xa1, 0x94,
+  0xa3, 0xb4, 0x4a, 0x8d, 0xe7, 0x64, 0x95, 0xd3, 0x7a, 0xc8, 0xfd, 0x1b,
+  0x0e, 0xeb, 0xfe, 0xe4, 0x0d, 0x52, 0xf4, 0x3e, 0xf9, 0xc5, 0x11, 0xa6,
+  0xfa, 0x42, 0x61, 0x33, 0x2a, 0xa6, 0xe3, 0x91, 0x92, 0x4e, 0x96, 0x7c,
+  0x5e, 0x2f, 0xd7, 0xea, 0x4f, 0xd5, 0xb8, 0xd1, 0xb2, 0xa8, 0x9d, 0x70,
+  0xfb, 0xa5, 0x73, 0x6e, 0xd1, 0xb0, 0xcf, 0x50, 0x49, 0xcb, 0x75, 0x40,
+  0x44, 0xd3, 0x6e, 0x25, 0x1d, 0xd4, 0x2b, 0xe9, 0xa0, 0xef, 0xef, 0xbf,
+  0x3d, 0x7c, 0xfd, 0xbc, 0x6a, 0xa5, 0xed, 0x08, 0x3d, 0xa2, 0xb0, 0x0b,
+  0xbb, 0x27, 0x91, 0x5d, 0x32, 0x48, 0x78, 0x19, 0xb2, 0xab, 0xb6, 0x3c,
+  0xdf, 0x21, 0x22, 0x99, 0x1e, 0xee, 0xa7, 0xd2, 0xa0, 0x48, 0x6b, 0xd6,
+  0x3a, 0x3d, 0x8d, 0xe4, 0x7b, 0x04, 0xe3, 0x95, 0x0c, 0x80, 0x34, 0xb8,
+  0x08, 0xd6, 0xca, 0x7e, 0x9c, 0x55, 0x0f, 0x72, 0x8c, 0xd8, 0xc7, 0x65,
+  0x67, 0x82, 0xba, 0x0f, 0xb2, 0x82, 0x44, 0x72, 0xf5, 0x3d, 0xe2, 0x48,
+  0x34, 0xb3, 0x7d, 0x63, 0xf0, 0x3d, 0xc8, 0x01, 0xe8, 0x62, 0x95, 0x62,
+  0x45, 0x54, 0x9c, 0xf8, 0xc0, 0x65, 0x25, 0x2b, 0xe1, 0x2f, 0x38, 0xab,
+  0x84, 0x65, 0xe0, 0x78, 0xde, 0xe6, 0x00, 0x4c, 0x6f, 0xc6, 0x72, 0xbd,
+  0x4a, 0xa5, 0x27, 0xda, 0xb5, 0x89, 0xe7, 0xa4, 0xb0, 0x3d, 0x7a, 0xae,
+  0x34, 0x6e, 0x52, 0xf3, 0x0e, 0x92, 0xe1, 0xc3, 0x1d, 0x4a, 0xe3, 0x02,
+  0x75, 0x3d, 0x0d, 0xa9, 0xc7, 0xd4, 0xce, 0xd3, 0xd0, 0xe8, 0x69, 0xa5,
+  0xb0, 0x45, 0x44, 0x8b, 0x96, 0x66, 0x30, 0x45, 0x0d, 0x9c, 0x6c, 0xa2,
+  0x82, 0x59, 0xed, 0xf8, 0x9b, 0x88, 0xe2, 0x46, 0x7f, 0x03, 0x95, 0xf1,
+  0x83, 0x62, 0x68, 0x97, 0xaa, 0x08, 0x39, 0x0f, 0x39, 0x18, 0x97, 0x3b,
+  0xcd, 0xc5, 0x60, 0xd3, 0x0b, 0x26, 0x3b, 0x4b, 0x13, 0x41, 0x0f, 0xf4,
+  0xba, 0x18, 0x51, 0xcf, 0xc6, 0x4d, 0x33, 0x88, 0xc5, 0x5e, 0x26, 0x56,
+  0x98, 0x6c, 0xa0, 0x95, 0x3a, 0xcc, 0x5c, 0xda, 0x4c, 0x73, 0x80, 0x27,
+  0x93, 0xd6, 0x6d, 0x8b, 0x5c, 0x0b, 0xbb, 0xce, 0x08, 0xa6, 0x72, 0x99,
+  0x28, 0xe9, 0x5c, 0xe1, 0x3f, 0xa5, 0x09, 0xe8, 0xf1, 0x2e, 0x05, 0xaf,
+  0xf3, 0x3d, 0x96, 0x69, 0x17, 0xab, 0xca, 0x99, 0xf3, 0xbb, 0xf7, 0x7a,
+  0x05, 0xa6, 0xc9, 0x33, 0xad, 0x92, 0x4b, 0x74, 0x12, 0x8d, 0x57, 0x53,
+  0x86, 0xee, 0x71, 0x76, 0x25, 0x37, 0xec, 0xaa, 0x0c, 0x0b, 0x3d, 0xd4,
+  0x9d, 0x6e, 0xe7, 0xbb, 0xe0, 0xab, 0x8a, 0x2c, 0x4b, 0xf0, 0xed, 0xb9,
+  0xd7, 0x72, 0x11, 0x5a, 0x2f, 0x85, 0x46, 0x42, 0x40, 0xd3, 0xd4, 0x0b,
+  0xef, 0xca, 0x81, 0x7a, 0xe5, 0xa0, 0xec, 0xd6, 0xd5, 0xf4, 0x00, 0xd2,
+  0x79, 0x7c, 0xd8, 0x69, 0x2b, 0xaa, 0x96, 0x82, 0x2c, 0xe3, 0xf0, 0x06,
+  0x74, 0xeb, 0xc1, 0x50, 0x57, 0xa3, 0x77, 0xf5, 0x6a, 0xe8, 0xba, 0x29,
+  0x62, 0x18, 0xca, 0xb2, 0xc5, 0xca, 0x3a, 0x31, 0x83, 0x5f, 0x50, 0x0d,
+  0x6f, 0xdc, 0xb3, 0xc2, 0x88, 0x22, 0x91, 0x81, 0x86, 0xc0, 0xdf, 0x07,
+  0x70, 0x05, 0xb9, 0xa0, 0xba, 0x57, 0x7b, 0xc3, 0x43, 0x5b, 0xaf, 0x48,
+  0x05, 0x63, 0x56, 0x94, 0x69, 0xb9, 0xf9, 0xd6, 0x61, 0x59, 0x5e, 0x95,
+  0x4d, 0xde, 0xab, 0xb2, 0x86, 0xcb, 0x91, 0x3a, 0xbf, 0x55, 0x25, 0xb6,
+  0xad, 0xc3, 0xe4, 0xa4, 0x4b, 0x89, 0x1b, 0x89, 0xa4, 0x30, 0xf1, 0xed,
+  0xa9, 0x11, 0x86, 0xaa, 0x13, 0x36, 0xcb, 0x62, 0x58, 0xf8, 0x0f, 0x92,
+  0xff, 0xf2, 0xf5, 0xa1, 0x32, 0x16, 0x7b, 0x6f, 0x8c, 0x23, 0x30, 0xca,
+  0x4c, 0x95, 0x09, 0x91, 0x88, 0x43, 0x2c, 0x8b, 0x57, 0x26, 0x9e, 0xe4,
+  0xee, 0xd2, 0x8c, 0xcc, 0xbc, 0x27, 0x8a, 0x74, 0xce, 0x8b, 0x85, 0xe1,
+  0x24, 0x1f, 0x74, 0xe6, 0xba, 0xf0, 0xab, 0xaa, 0x3a, 0x8c, 0xb1, 0x4d,
+  0x7a, 0x29, 0x2e, 0x92, 0xb6, 0xe9, 0xc8, 0xea, 0x87, 0xe3, 0x9f, 0x85,
+  0x75, 0x91, 0x77, 0xeb, 0x99, 0x1c, 0x6d, 0xf7, 0x84, 0x15, 0x2b, 0x84,
+  0xdf, 0xb1, 0xb8, 0xe1, 0x9d, 0xc7, 0xea, 0xea, 0x50, 0x10, 0x31, 0x0e,
+  0x6a, 0x8a, 0xfa, 0x54, 0x45, 0x70, 0x1f, 0xc0, 0x84, 0x66, 0x9f, 0xab,
+  0x2c, 0x59, 0x3e, 0x03, 0x0c, 0x81, 0x75, 0x31, 0xac, 0xd7, 0x0c, 0x4b,
+  0xc1, 0xb3, 0x88, 0xde, 0xcb, 0xd2, 0xdd, 0x95, 0xcd, 0x90, 0xda, 0x0e,
+  0xe2, 0x9e, 0x16, 0xd9, 0x5d, 0x58, 0x08, 0xa3, 0x37, 0x7f, 0x19, 0xf0,
+  0x2b, 0x39, 0xee, 0x7b, 0x28, 0x50, 0xfe, 0xd8, 0xc1, 0xd7, 0xf5, 0xa5,
+  0xe0, 0x57, 0xf4, 0x56, 0x05, 0x4d, 0xc9, 0x0a, 0x8e, 0x0e, 0x3c, 0xd7,
+  0x72, 0xf1, 0x09, 0xae, 0x5f, 0x5d, 0x79, 0x16, 0x2a, 0x41, 0x3b, 0xb2,
+  0xe6, 0xab, 0x32, 0xb5, 0xaf, 0x73, 0xad, 0xb0, 0x5b, 0x9e, 0x6d, 0x98,
+  0x52, 0xb3, 0xc1, 0x6d, 0xf2, 0x3b, 0x1d, 0x4c, 0xb7, 0xb0, 0x73, 0x2a,
+  0x9f, 0x7f, 0xca, 0x05, 0xf4, 0x48, 0x36, 0x5e, 0xb5, 0x7e, 0xd9, 0x07,
+  0xe5, 0x42, 0xc8, 0x41, 0x5d, 0x5c, 0x11, 0x4a, 0x19, 0x57, 0xa3, 0xc8,
+  0x1f, 0xa3, 0xe8, 0xb4, 0x32, 0x5e, 0xd8, 0x43, 0xf1, 0x97, 0x0e, 0x8c,
+  0xd5, 0xb1, 0x6e, 0x2f, 0xe1, 0xc4, 0x25, 0x8f, 0xe5, 0xd3, 0xd2, 0xdf,
+  0xd4, 0x02, 0x2a, 0xdc,
+};
+
+struct bench_d {
+  unsigned char* pbSrc;
+  unsigned char* pbDst;
+  size_t cb;
+  unsigned long result;		/* Keeps the compiler from eliding work */
+};
+
+typedef void (*bench_fn) (struct bench_d*);
+
+static volatile unsigned long read_sink; /* Keeps the sum of mapped reads */
+
+static void bench_memcpy (struct bench_d* b)
+{
+  memcpy (b->pbDst, b->pbSrc, b->cb);
+}
+
+static void bench_memset (struct bench_d* b)
+{
+  memset (b->pbDst, b->result & 0xff, b->cb);
+}
+
+static void bench_memcmp (struct bench_d* b)
+{
+  b->result += memcmp (b->pbDst, b->pbSrc, b->cb);
+}
+
+static void bench_crc32 (struct bench_d* b)
+{
+  b->result = compute_crc32 (b->result, b->pbSrc, b->cb);
+}
+
+#if defined (CONFIG_CRC32_LSB)
+static void bench_crc32_lsb (struct bench_d* b)
+{
+  b->result = compute_crc32_lsb (b->result, b->pbSrc, b->cb);
+}
+#endif
+
+static int inflate_setup (z_stream* z)
+{
+  memset (z, 0, sizeof (*z));
+  z->zalloc = zlib_heap_alloc;
+  z->zfree = zlib_heap_free;
+  zlib_heap_reset ();
+  return inflateInit (z);
+}
+
+static void bench_inflate (struct bench_d* b)
+{
+  struct inflate_d inf;
+
+  inflate_init (&inf, b->pbDst, b->cb);
+  inf.next_in = rgbInflate;
+  inf.avail_in = sizeof (rgbInflate);
+  if (inflate_zlib (&inf) == INFLATE_OK)
+    b->result = inf.total_out;
+}
+
+static void bench_inflate_zlib_setup (struct bench_d* b)
+{
+  z_stream z;
+  inflate_setup (&z);
+}
+
+static void bench_inflate_zlib (struct bench_d* b)
+{
+  z_stream z;
+
+  if (inflate_setup (&z) != Z_OK)
+    return;
+  z.next_in = (Bytef*) rgbInflate;
+  z.avail_in = sizeof (rgbInflate);
+  z.next_out = b->pbDst;
+  z.avail_out = b->cb;
+  if (inflate (&z, 0) == Z_STREAM_END)
+    b->result = z.total_out;
+}
+
+/* bench_run
+
+   repeats the test in batches of at least CB_BATCH bytes until
+   MS_BENCH milliseconds have elapsed.  It returns the number of bytes
+   processed and the elapsed time in *pms.
+
+*/
+
+static unsigned long bench_run (bench_fn fn, struct bench_d* b,
+				unsigned long* pms)
+{
+  unsigned long time = timer_read ();
+  unsigned long cBatch = b->cb ? (CB_BATCH + b->cb - 1)/b->cb : 1;
+  unsigned long c = 0;
+
+  do {
+    unsigned long i;
+    for (i = cBatch; i--; )
+      fn (b);
+    c += cBatch;
+  } while ((*pms = timer_delta (time, timer_read ())) < MS_BENCH);
+
+  return c*b->cb;
+}
+
+/* bench_report
+
+   prints the rate for a test and stores it in the variable
+   bench-NAME.  The rate is computed in KiB to stay within 32 bits.
+
+*/
+
+static void bench_report (const char* szName, unsigned long cb,
+			  unsigned long ms)
+{
+  unsigned long rate = ms ? ((cb/1024)*1000/ms)*100/1024 : 0;
+  char szRate[24];
+  char szKey[32];
+
+  snprintf (szRate, sizeof (szRate), "%lu.%02lu", rate/100, rate%100);
+  printf ("  %-16s %10s MiB/s\n", szName, szRate);
+  snprintf (szKey, sizeof (szKey), "bench-%s", szName);
+  variable_set (szKey, szRate);
+}
+
+static void bench (const char* szName, bench_fn fn, struct bench_d* b)
+{
+  unsigned long ms;
+  unsigned long cb = bench_run (fn, b, &ms);
+  bench_report (szName, cb, ms);
+}
+
+static int bench_mem (struct bench_d* b)
+{
+  memset (b->pbSrc, 0x5a, b->cb);
+  bench ("memcpy", bench_memcpy, b);
+  bench ("memset", bench_memset, b);
+  memcpy (b->pbDst, b->pbSrc, b->cb);
+  bench ("memcmp", bench_memcmp, b);
+  return 0;
+}
+
+static int bench_crc (struct bench_d* b)
+{
+  bench ("crc32", bench_crc32, b);
+#if defined (CONFIG_CRC32_LSB)
+  bench ("crc32-lsb", bench_crc32_lsb, b);
+#endif
+  return 0;
+}
+
+static int bench_zlib (struct bench_d* b)
+{
+  unsigned long cb;
+  unsigned long ms;
+  unsigned long cSetup;
+  unsigned long msSetup;
+
+  if (b->cb < CB_INFLATE_OUT)
+    ERROR_RETURN (ERROR_PARAM, "region too small for inflate");
+
+  b->result = 0;
+  bench_inflate (b);
+  if (b->result != CB_INFLATE_OUT
+      || compute_crc32 (0, b->pbDst, CB_INFLATE_OUT) != CRC_INFLATE_OUT)
+    ERROR_RETURN (ERROR_FAILURE, "inflate failed");
+  memset (b->pbDst, 0, CB_INFLATE_OUT);
+  b->result = 0;
+  bench_inflate_zlib (b);
+  if (b->result != CB_INFLATE_OUT
+      || compute_crc32 (0, b->pbDst, CB_INFLATE_OUT) != CRC_INFLATE_OUT)
+    ERROR_RETURN (ERROR_FAILURE, "zlib inflate failed");
+
+  b->cb = CB_INFLATE_OUT;
+  bench ("inflate", bench_inflate, b);
+
+  cb = bench_run (bench_inflate_zlib, b, &ms);
+  cSetup = bench_run (bench_inflate_zlib_setup, b, &msSetup)/CB_INFLATE_OUT;
+
+	/* Remove the time spent in setup from the inflate time */
+  if (cSetup) {
+    unsigned long msExclude = (cb/CB_INFLATE_OUT)*msSetup/cSetup;
+    ms = msExclude < ms ? ms - msExclude : 0;
+  }
+  bench_report ("inflate-zlib", cb, ms);
+  return 0;
+}
+
+static int bench_read (struct descriptor_d* d)
+{
+  size_t cbTransfer = region_transfer_size (d, NULL);
+  unsigned long time = timer_read ();
+  unsigned long cbTotal = 0;
+  unsigned long ms;
+  unsigned long sum = 0;
+
+	/* Each pass rereads the region from the start */
+  if (!driver_can_read (d->driver) || !driver_can_seek (d->driver))
+    ERROR_RETURN (ERROR_UNSUPPORTED, "descriptor cannot be reread");
+
+  do {
+    ssize_t cb;
+    const void* pv;
+
+    d->driver->seek (d, 0, SEEK_SET);
+    while (d->index < d->length) {
+      size_t available = d->length - d->index;
+      if (available > cbTransfer)
+	available = cbTransfer;
+      cb = read_mapped (d, &pv, rgbRegion, available);
+      if (cb < 0)
+	return cb;
+      if (cb == 0)
+	break;
+
+	/* Mapped data hasn't been read yet */
+      if (pv != rgbRegion) {
+	const unsigned long* pl = pv;
+	int i;
+	for (i = cb/sizeof (*pl); i--; )
+	  sum += *pl++;
+      }
+      cbTotal += cb;
+    }
+  } while ((ms = timer_delta (time, timer_read ())) < MS_BENCH);
+
+  read_sink = sum;
+  bench_report ("read", cbTotal, ms);
+  return 0;
+}
+
+static int parse_size (const char* sz, unsigned long* pl)
+{
+  char* pchEnd;
+  unsigned long l = simple_strtoul (sz, &pchEnd, 0);
+
+  if (*pchEnd == 'k' || *pchEnd == 'K') {
+    l *= 1024;
+    ++pchEnd;
+  }
+  else if (*pchEnd == 'm' || *pchEnd == 'M') {
+    l *= 1024*1024;
+    ++pchEnd;
+  }
+  if (*pchEnd || pchEnd == sz)
+    return ERROR_PARAM;
+  *pl = l;
+  return 0;
+}
+
+int cmd_bench (int argc, const char** argv)
+{
+  struct descriptor_d d;
+  struct bench_d b;
+  unsigned long cb = 0;
+  unsigned long offset = 0;
+  int op = 0;
+  int result;
+
+  while (argc > 2 && argv[1][0] == '-') {
+    switch (argv[1][1]) {
+    case 'a':
+      if (parse_size (argv[2], &offset))
+	return ERROR_PARAM;
+      break;
+    case 's':
+      if (parse_size (argv[2], &cb))
+	return ERROR_PARAM;
+      break;
+    default:
+      return ERROR_PARAM;
+    }
+    argc -= 2;
+    argv += 2;
+  }
+
+  if (argc == 3) {
+    if      (PARTIAL_MATCH (argv[1], "m", "em") == 0)
+      op = 'm';
+    else if (PARTIAL_MATCH (argv[1], "c", "rc") == 0)
+      op = 'c';
+    else if (PARTIAL_MATCH (argv[1], "i", "nflate") == 0)
+      op = 'i';
+    else if (PARTIAL_MATCH (argv[1], "r", "ead") == 0)
+      op = 'r';
+    else
+      ERROR_RETURN (ERROR_PARAM, "unrecognized OP");
+    --argc;
+    ++argv;
+  }
+
+  if (argc != 2)
+    return ERROR_PARAM;
+
+  if (   (result = parse_descriptor (argv[1], &d))
+      || (result = open_descriptor (&d))) {
+    printf ("Unable to open '%s'\n", argv[1]);
+    goto fail;
+  }
+
+  if (op == 'r') {
+    result = bench_read (&d);
+    goto fail;
+  }
+
+  if (strcmp (d.driver_name, "memory")) {
+    result = ERROR_UNSUPPORTED;
+    printf ("descriptor must refer to memory\n");
+    goto fail;
+  }
+
+	/* Source in the first half, destination in the second */
+  memset (&b, 0, sizeof (b));
+  b.pbSrc = (unsigned char*) (unsigned long) d.start;
+  b.pbDst = b.pbSrc + d.length/2 + offset;
+  b.cb = d.length/2;
+  if (offset >= b.cb) {
+    result = ERROR_PARAM;
+    goto fail;
+  }
+  b.cb -= offset;
+  if (cb) {
+    if (cb > b.cb) {
+      result = ERROR_PARAM;
+      printf ("size exceeds half the region\n");
+      goto fail;
+    }
+    b.cb = cb;
+  }
+
+  if (!op || op == 'm')
+    result = bench_mem (&b);
+  if (!result && (!op || op == 'c'))
+    result = bench_crc (&b);
+  if (!result && (!op || op == 'i'))
+    result = bench_zlib (&b);
+
+ fail:
+  close_descriptor (&d);
+
+  return result;
+}
+
+static __command struct command_d c_bench = {
+  .command = "bench",
+  .func = cmd_bench,
+  COMMAND_DESCRIPTION ("measure memory, crc, inflate, and read rates")
+  COMMAND_HELP(
+"bench [-s SIZE] [-a OFFSET] [mem|crc|inflate] REGION\n"
+"bench read REGION\n"
+"  Measure throughput in MiB/s.\n"
+"  Without an OP, mem, crc, and inflate are all run.\n"
+"  REGION is scratch memory for all but read.  The source is the\n"
+"  first half of REGION and the destination is the second half.\n"
+"  -s SIZE sets the length of each operation, half the region by\n"
+"  default.  -a OFFSET moves the destination by OFFSET bytes to\n"
+"  measure unaligned transfers.\n"
+"  read reads REGION sequentially from its driver.\n"
+"  Each rate is stored in a variable named bench-TEST.\n"
+"  e.g.  bench 0xc0100000+2m\n"
+"        bench -s 4k -a 1 mem 0xc0100000+1m\n"
+"        bench read nor:0+1m\n"
+  )
+};
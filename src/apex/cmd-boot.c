@@ -29,6 +29,7 @@
 #include <environment.h>
 #include <service.h>
 #include <lookup.h>
+#include <trace.h>
 
 #include <debug_ll.h>
 
@@ -102,6 +103,7 @@ int cmd_boot (int argc, const char** argv)
   commandline_argc = argc - 1;
   commandline_argv = argv + 1;
 
+  TRACE (traceBoot, 0, NULL);
   build_atags ();
 #endif
 
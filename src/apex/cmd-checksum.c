@@ -23,18 +23,43 @@
 #include <driver.h>
 #include <error.h>
 #include <spinner.h>
+#include <linux/string.h>
+#include <linux/kernel.h>
+#include <crc32.h>
 #include "region-checksum.h"
 
-extern unsigned long compute_crc32 (unsigned long crc, const void *pv, int cb);
+/* cmd_checksum
+
+   computes the cksum compatible CRC of a region.  The region is
+   checked in segments that are combined, so a check interrupted with
+   ^C reports the CRC of the part that was done.  Passing that CRC
+   and length back with -r skips the part already checked and
+   combines the saved CRC with the rest.
+
+*/
 
 int cmd_checksum (int argc, const char** argv)
 {
   struct descriptor_d d;
+  struct region_checksum_d ck;
   int result = 0;
-  unsigned long crc = 0;
-  ssize_t cb;
+  uint32_t crc = 0;
+  size_t index;
+
+  region_checksum_init (&ck, regionChecksumLength, 0);
+
+  if (argc == 4 && strcmp (argv[1], "-r") == 0) {
+    char* pch;
+    uint32_t crcSaved = simple_strtoul (argv[2], &pch, 0);
+    if (*pch != '+')
+      return ERROR_PARAM;
+    region_checksum_combine (&ck, crcSaved,
+                             simple_strtoul (pch + 1, NULL, 0));
+    argc -= 2;
+    argv += 2;
+  }
 
-  if (argc < 2)
+  if (argc != 2)
     return ERROR_PARAM;
 
   if (   (result = parse_descriptor (argv[1], &d))
@@ -43,14 +68,30 @@ int cmd_checksum (int argc, const char** argv)
     goto fail;
   }
 
-  cb = d.length - d.index;
+  if (ck.cb > d.length) {
+    result = ERROR_PARAM;
+    goto fail;
+  }
+  d.driver->seek (&d, ck.cb, SEEK_SET);
+  index = d.index;
 
-  result = region_checksum (0, &d, regionChecksumSpinner | regionChecksumLength,
+  result = region_checksum (0, &d, regionChecksumSpinner | regionChecksumBreak,
                             &crc);
-  if (result)
+  if (result && result != ERROR_BREAK)
     goto fail;
 
-  printf ("\rcrc32 0x%lx (%lu) over %d (0x%x) bytes\n", ~crc, ~crc, cb, cb);
+  region_checksum_combine (&ck, crc, d.index - index);
+
+  if (result == ERROR_BREAK) {
+    printf ("\rinterrupted after %d (0x%x) bytes\n"
+            "resume with 'checksum -r 0x%08x+0x%x %s'\n",
+            ck.cb, ck.cb, ck.crc, ck.cb, argv[1]);
+    goto fail;
+  }
+
+  crc = region_checksum_finish (&ck);
+  printf ("\rcrc32 0x%x (%u) over %d (0x%x) bytes\n", ~crc, ~crc,
+          ck.cb, ck.cb);
 
  fail:
   close_descriptor (&d);
@@ -63,9 +104,12 @@ static __command struct command_d c_checksum = {
   .func = cmd_checksum,
   COMMAND_DESCRIPTION ("compute crc32 checksum")
   COMMAND_HELP(
-"checksum REGION\n"
+"checksum [-r CRC+LENGTH] REGION\n"
 "  Calculate a CRC32 checksum over REGION.\n"
 "  The result conforms to the POSIX standard for the cksum command.\n"
+"  The check may be interrupted with ^C.  It reports the partial\n"
+"  CRC and length which, given with -r, resume the check where it\n"
+"  stopped.\n"
   )
 
 };
@@ -81,12 +81,16 @@ int cmd_compare (int argc, const char** argv)
   while (cbCompare < cbTotal && count) {
     char __aligned rgbIn [512];
     char __aligned rgbOut[512];
+    const char* pbIn;
+    const char* pbOut;
     ssize_t cbIn;
     ssize_t cbOut;
     ssize_t cb;
 
-    cbIn  = din.driver ->read (&din,  rgbIn,  sizeof (rgbIn));
-    cbOut = dout.driver->read (&dout, rgbOut, sizeof (rgbOut));
+    cbIn  = read_mapped (&din,  (const void**) &pbIn,  rgbIn,
+                         sizeof (rgbIn));
+    cbOut = read_mapped (&dout, (const void**) &pbOut, rgbOut,
+                         sizeof (rgbOut));
 
     if (cbIn != cbOut) {
       printf ("\rregions not the same length\n");
@@ -95,9 +99,9 @@ int cmd_compare (int argc, const char** argv)
     }
 
     for (cb = 0; cb < cbIn; ++cb) {
-      if (rgbIn[cb] != rgbOut[cb]) {
+      if (pbIn[cb] != pbOut[cb]) {
 	printf ("\rregions differ 0x%02x != 0x%02x at %d (0x%x)\n",
-		rgbIn[cb], rgbOut[cb], cb + cbCompare, cb + cbCompare);
+		pbIn[cb], pbOut[cb], cb + cbCompare, cb + cbCompare);
 	result = ERROR_FALSE;
 	if (--count == 0)
 	  goto fail;
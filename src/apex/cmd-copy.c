@@ -32,10 +32,6 @@ int cmd_copy (int argc, const char** argv)
   struct descriptor_d din;
   struct descriptor_d dout;
   unsigned flags = regionCopySpinner;
-#if defined (USE_COPY_VERIFY)
-  struct descriptor_d din_v;
-  struct descriptor_d dout_v;
-#endif
 
   int result = 0;
 
@@ -75,10 +71,11 @@ int cmd_copy (int argc, const char** argv)
   if (!dout.length)
     dout.length = DRIVER_LENGTH_MAX;
 
-  result = region_copy (&dout, &din, flags);
+  result = region_copy (&dout, &din, flags, NULL);
 
   if (result > 0)
-    printf ("\r%d bytes transferred\n", result);
+    printf ("\r%d bytes transferred%s\n", result,
+            (flags & regionCopyVerify) ? " and verified" : "");
 
  fail:
   close_descriptor (&din);
@@ -88,29 +85,15 @@ int cmd_copy (int argc, const char** argv)
   return result <= 0 ? result : 0;
 }
 
-	/* Work-around for gcc-2.95 */
-#if defined (USE_DIAG)
-# define _USE_COPY_VERIFY(s) s
-#else
-# define _USE_COPY_VERIFY(s)
-#endif
-
-
 static __command struct command_d c_copy = {
   .command = "copy",
   .func = cmd_copy,
   COMMAND_DESCRIPTION ("copy data between devices")
   COMMAND_HELP(
-"copy"
-_USE_COPY_VERIFY(
-" [-v]"
-)
-" [-s] SRC DST\n"
+"copy [-v] [-s] SRC DST\n"
 "  Copy data from SRC region to DST region.\n"
-_USE_COPY_VERIFY(
-"  Adding the -v performs redundant reads of the data to verify that\n"
-"  what is read from SRC is correctly written to DST\n"
-)
+"  Adding the -v computes a CRC of the data as it is written and then\n"
+"  rereads DST once to verify that it matches.\n"
 "  Adding the -s performs full word byte swap.  This is necessary when\n"
 "  copying data stored in the opposite endian orientation from that which\n"
 "  APEX is running.  This option requires that the length be an even\n"
@@ -21,6 +21,7 @@
 #include <command.h>
 #include <driver.h>
 #include <service.h>
+#include <error.h>
 
 static int cmd_drvinfo (int argc, const char** argv)
 {
@@ -28,6 +29,15 @@ static int cmd_drvinfo (int argc, const char** argv)
   extern char APEX_DRIVER_END[];
   struct driver_d* d;
 
+#if defined (CONFIG_DRIVER_STATS)
+  if (argc == 2 && strcmp (argv[1], "-r") == 0) {
+    driver_stats_reset ();
+    return 0;
+  }
+#endif
+  if (argc != 1)
+    return ERROR_PARAM;
+
   for (d = (struct driver_d*) APEX_DRIVER_START;
        d < (struct driver_d*) APEX_DRIVER_END;
        ++d) {
@@ -37,6 +47,10 @@ static int cmd_drvinfo (int argc, const char** argv)
             d->description ? d->description : "?");
   }
 
+#if defined (CONFIG_DRIVER_STATS)
+  printf ("\n");
+  driver_stats_report ();
+#endif
 
   return 0;
 }
@@ -46,7 +60,14 @@ static __command struct command_d c_drvinfo = {
   .func = cmd_drvinfo,
   COMMAND_DESCRIPTION ("list available drivers and services")
   COMMAND_HELP(
+#if defined (CONFIG_DRIVER_STATS)
+"drvinfo [-r]\n"
+"  Lists available drivers and services followed by the I/O counters\n"
+"  of each driver that has been used.\n"
+"  The -r option resets the counters.\n"
+#else
 "drvinfo\n"
 "  Lists available drivers and services\n"
+#endif
   )
 };
@@ -55,7 +55,7 @@ int cmd_fill (int argc, const char** argv)
   if (argc != 3)
     return ERROR_PARAM;
 
-  *(unsigned long*) rgb = simple_strtoul (argv[1], NULL, 0);
+  *(u32*) rgb = simple_strtoul (argv[1], NULL, 0);
 
   if (   (result = parse_descriptor (argv[2], &dout))
       || (result = open_descriptor (&dout))) {
@@ -40,17 +40,36 @@
      marker in the header for each payload.  Thus, when we know the
      lenght of the payload, we also know everything else about it.
 
-   o Overlapping source and destination regions.  There is no support
-     in this image handling code to cope with an image that overlaps
-     the place in memory where a payload is to be copied.  For the
-     most part, this shouldn't be necessary since APEX images can be
-     processed as a stream.  In the event that this does come into
-     play, we may need to relocate the source image before starting
-     the copy. This isn't so simple since we would have to make a map
-     of the memory to be used that would have to be more than a simple
-     range.  Imagine loading one piece of data at the start of RAM and
-     another at the top.  We'd have to be able to relocate to the
-     middle.
+   o Overlapping source and destination regions.  An image in memory
+     may overlap the place where a payload is to be copied.  With
+     IMAGE_PLAN, the load first walks the header to describe each
+     payload to the planner.  If a payload would overwrite image data
+     that has yet to be read, the rest of the image is moved once to
+     a gap in memory that none of the payloads use.  A payload may
+     still overwrite the part of the image that precedes it.  See
+     image-plan.c.
+
+   o Compressed payloads.  A payload with the compression field is a
+     zlib or gzip stream, or an lzop file when LZO is configured.  It
+     is inflated as it is read so that the source is read once and
+     nothing is staged in RAM.  The length field and the payload CRC
+     describe the compressed data.  The inflated length is known only
+     once the stream ends, so the output is bounded by the end of the
+     memory region holding the load address.  Verification of the
+     copy doesn't apply since there is no CRC of the inflated data.
+
+   o Block CRCs.  A payload may carry a table of CRCs, one for each
+     block of the stored data, in fields before its length.  The table
+     may span several fields since a variable length field holds at
+     most 31 CRCs.  A load stops at the first block that fails so
+     that a corrupt image is rejected without reading the rest.  A
+     check reads every block and reports each one that fails so that
+     the damage can be located.  The payload CRC is still checked.
+
+   o Verified image cache.  With IMAGE_CACHE, a load of an image that
+     was checked before and hasn't been written since skips the
+     payload CRCs.  The CRC words and padding are still read so that
+     the descriptor ends in the same place.  See image-cache.c.
 
 */
 
@@ -71,19 +90,26 @@
 #include <driver.h>
 #include "region-copy.h"
 #include "region-checksum.h"
+#include "region-inflate.h"
+#include "image-cache.h"
+#include "image-plan.h"
 #include <simple-time.h>
 #include "cmd-image.h"
 #include <talk.h>
 #include <describe.h>
+#include <trace.h>
 
 #include <debug_ll.h>
 
-extern unsigned long compute_crc32 (unsigned long crc, const void *pv, int cb);
+extern uint32_t compute_crc32 (uint32_t crc, const void *pv, int cb);
 extern uint32_t compute_crc32_length (uint32_t crc, size_t cb);
 
 static const uint8_t signature[] = { 0x41, 0x69, 0x30, 0xb9 };
 static char __xbss(image) g_rgbHeader[(1<<8)*16]; /* Largest possible header */
 static size_t g_cbHeader;
+#if defined (CONFIG_IMAGE_BLOCK_CRC)
+static uint32_t __xbss(image) g_rgcrcBlock[(1<<8)*16/4]; /* Payload block CRCs */
+#endif
 
 enum {
   sizeZero      = 0x3,          // 11b
@@ -101,6 +127,8 @@ enum {
   fieldPayloadType                      = 0x3c | sizeOne,
   fieldPayloadDescription               = 0x40 | sizeVariable,
   fieldPayloadCompression               = 0x44 | sizeZero,
+  fieldPayloadBlockSize                 = 0x48 | sizeFour,
+  fieldPayloadBlockCRC                  = 0x4c | sizeVariable,
   fieldLinuxKernelArchitectureID        = 0x80 | sizeFour,
   fieldNOP                              = 0xfc | sizeZero,
 };
@@ -120,6 +148,9 @@ struct payload_info {
   uint32_t addrEntry;
   size_t length;
   const char* sz;
+  bool compressed;
+  size_t cbBlock;
+  int cBlocks;			/* Entries in g_rgcrcBlock */
 };
 
 static void clear_info (struct payload_info* info)
@@ -129,6 +160,9 @@ static void clear_info (struct payload_info* info)
   info->addrEntry = ~0;
   info->length    =  0;
   info->sz        =  NULL;
+  info->compressed = false;
+  info->cbBlock   =  0;
+  info->cBlocks   =  0;
 }
 
 static inline uint32_t swabl (uint32_t v)
@@ -260,9 +294,12 @@ int handle_report_apex_image (int field,
     printf ("Payload Description:    '%s' (%d bytes)\n", info->szField,
             strlen (info->szField) + 1);
     break;
-//    case fieldPayloadCompression:
-//      printf ("Payload Compression:    gzip\n");
-//      break;
+  case fieldPayloadCompression:
+    printf ("Payload Compression:     zlib, gzip, or lzop\n");
+    break;
+  case fieldPayloadBlockSize:
+    printf ("Payload Block CRC Size:  %s\n", describe_size (info->v));
+    break;
   case fieldLinuxKernelArchitectureID:
     printf ("Linux Kernel Arch ID:    %d (0x%x)\n", info->v, info->v);
     break;
@@ -281,7 +318,11 @@ int handle_report_apex_image (int field,
     architecture ID.  For initrd payloads it sets the environment
     variables for the start address and size of the initrd.  Also, if
     an image has no load address, the payload will be loaded to the
-    default address built into APEX. */
+    default address built into APEX.  Compressed payloads are inflated
+    as they are read, directly to the load address.  The payload CRC
+    covers the compressed data as it is stored in the image, and the
+    initrd size is the size of the inflated data.  When the payload
+    has block CRCs, the load stops at the first bad block. */
 
 int handle_load_apex_image (int field,
                             struct descriptor_d* d, struct image_info* im_info,
@@ -289,49 +330,77 @@ int handle_load_apex_image (int field,
 {
   int result = 0;
   struct descriptor_d dout;
-  unsigned long crc;
-  unsigned long crc_calc = 0;
+  struct region_checksum_d ck;
+  uint32_t crc;
+  uint32_t crc_calc = 0;
   ssize_t cbPadding = 16 - ((info->length + sizeof (crc)) & 0xf);
+  size_t cbLoaded = info->length;
 
   switch (field) {
   case fieldImageDescription:
     printf ("Image '%s'\n", info->szField);
     break;
   case fieldPayloadLength:
-    printf ("# %s mem:0x%08x+0x%08x %s\n",
+    printf ("# %s mem:0x%08x%s0x%08x %s\n",
             describe_apex_image_type (info->type), info->addrLoad,
+            info->compressed ? " <= compressed " : "+",
             info->length, info->sz ? info->sz : "");
 
     if (info->addrLoad == ~0)
       ERROR_RETURN (ERROR_FAILURE, "no load address for payload");
 
-    /* Copy image and check CRC */
+    /* Copy image and compute CRC in a single pass */
     if (im_info->fRegionCanExpand
         && d->length - d->index < info->length + 4 + cbPadding)
       d->length = d->index + info->length + 4 + cbPadding;
 
-    parse_descriptor_simple ("memory", info->addrLoad, info->length, &dout);
-    result = region_copy (&dout, d, regionCopySpinner);
-    if (result >= 0) {
+    TRACE (traceImage, info->type, describe_apex_image_type (info->type));
+    image_plan_source (d);
+    region_checksum_init (&ck, regionChecksumLength, 0);
+#if defined (CONFIG_IMAGE_BLOCK_CRC)
+    if (info->cBlocks && !im_info->fCached)
+      region_checksum_blocks (&ck, info->cbBlock, g_rgcrcBlock, info->cBlocks);
+#endif
+    if (info->compressed) {
+#if defined (CONFIG_IMAGE_INFLATE)
+      parse_descriptor_simple ("memory", info->addrLoad,
+                               image_plan_output (d), &dout);
+      result = region_inflate (&dout, d, info->length,
+                               regionInflateSpinner,
+                               im_info->fCached ? NULL : &ck);
+      cbLoaded = result;
+#else
+      ERROR_RETURN (ERROR_UNSUPPORTED, "compressed payloads not supported");
+#endif
+    }
+    else {
       parse_descriptor_simple ("memory", info->addrLoad, info->length, &dout);
-      result = region_checksum (0, &dout,
-                                regionChecksumSpinner | regionChecksumLength,
-                                &crc_calc);
+      result = region_copy (&dout, d, regionCopySpinner
+                            | (im_info->fVerify ? regionCopyVerify : 0),
+                            im_info->fCached ? NULL : &ck);
     }
+    crc_calc = region_checksum_finish (&ck);
     printf ("\r");
+    if (region_checksum_bad_block (&ck) >= 0) {
+      printf ("Block %d at payload offset 0x%08x has a bad CRC\n",
+              region_checksum_bad_block (&ck),
+              region_checksum_bad_block (&ck)*info->cbBlock);
+      ERROR_RETURN (ERROR_CRCFAILURE, "block CRC error");
+    }
     if (result < 0)
       return result;
     if (d->driver->read (d, &crc, sizeof (crc)) != sizeof (crc))
       ERROR_RETURN (ERROR_IOFAILURE, "payload CRC missing");
     crc = swabl (crc);
-    if (crc != ~crc_calc) {
-      DBG (1, "crc 0x%08lx  crc_calc 0x%08lx\n", crc, ~crc_calc);
+    if (!im_info->fCached && crc != ~crc_calc) {
+      DBG (1, "crc 0x%08x  crc_calc 0x%08x\n", crc, ~crc_calc);
       ERROR_RETURN (ERROR_CRCFAILURE, "payload CRC error");
     }
     while (cbPadding--) {
       if (d->driver->read (d, &crc, 1) != 1)
         ERROR_RETURN (ERROR_IOFAILURE, "payload padding missing");
     }
+    TRACE (traceImage, info->type, "loaded");
 #if defined (CONFIG_VARIABLES)
     if (info->type == typeLinuxKernel && info->addrEntry != ~0) {
       unsigned addr = lookup_variable_or_env_unsigned ("bootaddr", ~0);
@@ -340,8 +409,8 @@ int handle_load_apex_image (int field,
     }
     if (info->type == typeLinuxInitrd) {
       unsigned size = lookup_variable_or_env_unsigned ("ramdisksize", ~0);
-      if (size != info->length)
-        variable_set_hex ("ramdisksize", info->length);
+      if (size != cbLoaded)
+        variable_set_hex ("ramdisksize", cbLoaded);
       if (info->addrLoad != ~0) {
         unsigned addr = lookup_variable_or_env_unsigned ("ramdiskaddr", ~0);
         if (addr != info->addrLoad)
@@ -349,7 +418,11 @@ int handle_load_apex_image (int field,
       }
     }
 #endif
-    printf ("%d bytes transferred\n", info->length);
+    if (info->compressed)
+      printf ("%d bytes inflated from %d", cbLoaded, info->length);
+    else
+      printf ("%d bytes transferred", info->length);
+    printf (im_info->fCached ? ", CRC previously verified\n" : "\n");
     break;
   default:
     break;
@@ -359,18 +432,82 @@ int handle_load_apex_image (int field,
 }
 
 
+#if defined (CONFIG_IMAGE_PLAN)
+
+/** Handle planning the load of APEX image payloads.  It describes
+    each payload to the memory layout planner without reading the
+    payload data. */
+
+int handle_plan_apex_image (int field,
+                            struct descriptor_d* d, struct image_info* im_info,
+                            struct payload_info* info)
+{
+  ssize_t cbPadding = 16 - ((info->length + sizeof (uint32_t)) & 0xf);
+
+  if (field == fieldPayloadLength)
+    image_plan_payload (d, info->length,
+                        info->length + sizeof (uint32_t) + cbPadding,
+                        info->addrLoad, info->compressed);
+  return 0;
+}
+
+#endif
+
+
+#if defined (CONFIG_IMAGE_BLOCK_CRC)
+
+/** Checksum a payload block by block and report each block whose CRC
+    doesn't match the table.  The CRC of the whole payload is returned
+    in crc_calc.  The return value is the number of bad blocks or an
+    error code. */
+
+static int check_apex_blocks (struct descriptor_d* d,
+                              struct payload_info* info, uint32_t* crc_calc)
+{
+  struct region_checksum_d ck;
+  size_t ib = 0;
+  int cBad = 0;
+  int i;
+
+  region_checksum_init (&ck, regionChecksumLength, 0);
+  for (i = 0; i < info->cBlocks; ++i) {
+    size_t cb = info->length - ib;
+    uint32_t crc = 0;
+    int result;
+
+    if (cb > info->cbBlock)
+      cb = info->cbBlock;
+    result = region_checksum (cb, d, regionChecksumSpinner, &crc);
+    if (result < 0)
+      return result;
+    if (crc != g_rgcrcBlock[i]) {
+      printf ("\rBlock %d at payload offset 0x%08x has a bad CRC\n", i, ib);
+      ++cBad;
+    }
+    region_checksum_combine (&ck, crc, cb);
+    ib += cb;
+  }
+  *crc_calc = region_checksum_finish (&ck);
+  return cBad;
+}
+
+#endif
+
+
 /** Handle checking APEX image payloads.  The header must be loaded
     into the global g_rgbHeader and the descriptor must be ready to read
     the first byte of the first payload.  The payload CRCs will be
-    checked without copying the data to the memory. */
+    checked without copying the data to the memory.  A payload with
+    block CRCs is checked block by block and every bad block is
+    reported. */
 
 int handle_check_apex_image (int field,
                              struct descriptor_d* d, struct image_info* im_info,
                              struct payload_info* info)
 {
   int result = 0;
-  unsigned long crc;
-  unsigned long crc_calc = 0;
+  uint32_t crc;
+  uint32_t crc_calc = 0;
   ssize_t cbPadding = 16 - ((info->length + sizeof (crc)) & 0xf);
 
   switch (field) {
@@ -386,9 +523,14 @@ int handle_check_apex_image (int field,
         && d->length - d->index < info->length + 4 + cbPadding)
       d->length = d->index + info->length + 4 + cbPadding;
 
-    result = region_checksum (info->length, d,
-                              regionChecksumSpinner | regionChecksumLength,
-                              &crc_calc);
+#if defined (CONFIG_IMAGE_BLOCK_CRC)
+    if (info->cBlocks)
+      result = check_apex_blocks (d, info, &crc_calc);
+    else
+#endif
+      result = region_checksum (info->length, d,
+                                regionChecksumSpinner | regionChecksumLength,
+                                &crc_calc);
     if (result < 0)
       return result;
     DBG (2, " %d %lx %d %ld\n",
@@ -401,13 +543,15 @@ int handle_check_apex_image (int field,
       if (d->driver->read (d, &b, 1) != 1)
         ERROR_RETURN (ERROR_IOFAILURE, "payload padding missing");
     }
-    printf ("\r%d bytes checked, CRC 0x%08lx ", info->length, crc);
+    printf ("\r%d bytes checked, CRC 0x%08x ", info->length, crc);
     if (crc == ~crc_calc)
       printf ("OK\n");
     else
-      printf ("!= 0x%08lx ERR\n", ~crc_calc);
+      printf ("!= 0x%08x ERR\n", ~crc_calc);
     if (crc != ~crc_calc)
       ERROR_RETURN (ERROR_CRCFAILURE, "payload CRC error");
+    if (result > 0)
+      ERROR_RETURN (ERROR_CRCFAILURE, "block CRC error");
     break;
   case fieldLinuxKernelArchitectureID:
     printf ("Linux Kernel Arch ID:    %d (0x%x)\n", info->v, info->v);
@@ -476,7 +620,15 @@ int apex_image (int (*pfn) (int, struct descriptor_d*,
       if (info.addrLoad == ~0 && info.type == typeLinuxInitrd)
         info.addrLoad = lookup_variable_or_env_int ("ramdiskaddr",
                                                     info.addrLoad);
+      if (info.type == typeLinuxInitrd && im_info->initrd_relocate != ~0)
+        info.addrLoad = im_info->initrd_relocate;
       info.length = info.v;
+#if defined (CONFIG_IMAGE_BLOCK_CRC)
+      if (info.cBlocks
+          && (info.cbBlock == 0
+              || info.cBlocks != (info.length + info.cbBlock - 1)/info.cbBlock))
+        ERROR_RETURN (ERROR_FAILURE, "block CRCs don't match payload length");
+#endif
       break;
     case fieldPayloadLoadAddress:
       info.addrLoad = info.v;
@@ -492,6 +644,26 @@ int apex_image (int (*pfn) (int, struct descriptor_d*,
     case fieldPayloadDescription:
       info.sz = info.szField;
       break;
+    case fieldPayloadCompression:
+      info.compressed = true;
+      break;
+#if defined (CONFIG_IMAGE_BLOCK_CRC)
+    case fieldPayloadBlockSize:
+      info.cbBlock = info.v;
+      break;
+    case fieldPayloadBlockCRC:
+      {
+        const char* pb = info.szField;
+        int c = cbData/sizeof (uint32_t);
+        if (info.cBlocks + c > ARRAY_SIZE (g_rgcrcBlock))
+          ERROR_RETURN (ERROR_FAILURE, "too many block CRCs");
+        for (; c--; pb += sizeof (uint32_t)) {
+          memcpy (&info.v, pb, sizeof (uint32_t));
+          g_rgcrcBlock[info.cBlocks++] = swabl (info.v);
+        }
+      }
+      break;
+#endif
     default:
       break;                    // It's OK to skip unknown tags
     }
@@ -509,6 +681,18 @@ int apex_image (int (*pfn) (int, struct descriptor_d*,
   return 0;
 }
 
+/** Return the header CRC of the image in g_rgbHeader.  It identifies
+    the image, including its payload CRCs, to the verified image
+    cache. */
+
+static inline uint32_t apex_header_crc (void)
+{
+  size_t cbHeader = ((unsigned char) g_rgbHeader[4])*16;
+  uint32_t crc;
+  memcpy (&crc, g_rgbHeader + cbHeader - sizeof (crc), sizeof (crc));
+  return crc;
+}
+
 int handle_apex_image (int op, struct descriptor_d* d,
                        struct image_info* im_info)
 {
@@ -522,6 +706,8 @@ int handle_apex_image (int op, struct descriptor_d* d,
   switch (op) {
   case 'c':
     result = apex_image (handle_check_apex_image, d, im_info);
+    if (result >= 0)
+      image_cache_verified (d, apex_header_crc (), d->index);
     break;
 #if defined (CONFIG_CMD_IMAGE_SHOW)
   case 's':
@@ -529,7 +715,20 @@ int handle_apex_image (int op, struct descriptor_d* d,
     break;
 #endif
   case 'l':
+    im_info->fCached = !im_info->fForceCheck
+      && image_cache_lookup (d, apex_header_crc ());
+#if defined (CONFIG_IMAGE_PLAN)
+    if (image_plan_begin (d)) {
+      result = apex_image (handle_plan_apex_image, d, im_info);
+      if (result >= 0)
+        result = image_plan_resolve (d);
+      if (result < 0)
+        break;
+    }
+#endif
     result = apex_image (handle_load_apex_image, d, im_info);
+    if (result >= 0 && !im_info->fCached)
+      image_cache_verified (d, apex_header_crc (), d->index);
     break;
   }
   return result;
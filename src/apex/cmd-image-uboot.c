@@ -31,11 +31,29 @@
      for all payloads, the data_size field of the header refers to the
      size of all payloads, the is only one entry point, and there is
      only one load address for all payloads.  All payload data is
-     loaded starting at the load address in the header.  When booting
-     Linux, UBOOT interprets the first two payloads of a multi-image
-     as a kernel and initrd.  The load address and length of the
-     initrd will be recorded and passed to the kernel.  APEX performs
-     the same steps.
+     loaded starting at the load address in the header.  Each payload
+     is padded to a four byte boundary, though the last need not be.
+     When booting Linux, UBOOT interprets the first two payloads of a
+     multi-image as a kernel and initrd.  The load address and length
+     of the initrd will be recorded and passed to the kernel.  APEX
+     performs the same steps.
+
+   o Initrd relocation.  The image command's -r option moves the
+     initrd of a multi-image away from the kernel.  Each payload is
+     copied by itself so that the initrd is read directly to the
+     relocation address.  The data CRC is computed over the payloads
+     and padding as they are read, in the same order as before.
+
+   o Compression.  Kernel and ramdisk images made with 'mkimage -C
+     gzip' are inflated while they are read, directly to the load
+     address.  The data CRC in the header covers the compressed data,
+     so it is computed over the bytes as they are read, in the same
+     pass.  The size of the inflated data is only known once the
+     stream ends.  It is bounded by the memory region that holds the
+     load address and becomes ramdisksize for a ramdisk.  Compressed
+     multi-images, bzip2 images, and all compressed images when
+     CONFIG_IMAGE_INFLATE is not set, are copied without
+     decompression as they were before, leaving it to the kernel.
 
 */
 
@@ -56,15 +74,17 @@
 #include <driver.h>
 #include "region-copy.h"
 #include "region-checksum.h"
+#include "region-inflate.h"
+#include "image-cache.h"
 #include <simple-time.h>
 #include "cmd-image.h"
 #include <talk.h>
 #include <describe.h>
+#include <trace.h>
 
 #include <debug_ll.h>
 
-extern unsigned long compute_crc32_lsb (unsigned long crc,
-                                        const void *pv, int cb);
+extern uint32_t compute_crc32_lsb (uint32_t crc, const void *pv, int cb);
 
 
 enum {
@@ -148,6 +168,9 @@ static size_t g_cbHeader;
 static uint32_t __xbss(image) g_rgSizes[32]; /* Multi-image payload sizes */
 static size_t g_cPayloads;
 
+	/* Payloads of a multi-image start on four byte boundaries */
+#define MULTI_ALIGN(cb)	(((cb) + 3) & ~3)
+
 static inline uint32_t swabl (uint32_t v)
 {
   return 0
@@ -200,7 +223,9 @@ int verify_uboot_image (struct descriptor_d* d, struct image_info* info)
     cbNeed = sizeof (g_rgSizes);
     if (info->fRegionCanExpand && d->length - d->index < cbNeed)
       d->length = d->index + cbNeed;
-    for (; cbPayload; ++g_cPayloads) {
+    for (;; ++g_cPayloads) {
+      if (g_cPayloads >= ARRAY_SIZE (g_rgSizes))
+        ERROR_RETURN (ERROR_FAILURE, "too many payloads");
       result = d->driver->read (d, &cbPayload, sizeof (cbPayload));
       if (result != sizeof (cbPayload))
         ERROR_RETURN (ERROR_IOFAILURE, "size array read error");
@@ -343,81 +368,157 @@ int handle_report_uboot_image (struct descriptor_d* d, struct image_info* info,
 #endif
 
 
+/** Load the payloads of a multi-image.  Each payload is copied to
+    its own place in memory.  They follow one another from addrLoad,
+    except for the initrd which is copied to addrLoadInitrd.  The
+    padding after each payload is read and added to the checksum
+    since the data CRC covers it.  The cb parameter is the size of
+    the payload data. */
+
+static int load_uboot_multi (struct descriptor_d* d, struct image_info* info,
+                             uint32_t addrLoad, uint32_t addrLoadInitrd,
+                             size_t cb, struct region_checksum_d* ck)
+{
+  size_t ib = 0;		/* Offset of the payload in the data */
+  int i;
+
+  for (i = 0; i < g_cPayloads; ++i) {
+    struct descriptor_d dout;
+    size_t cbPayload = swabl (g_rgSizes[i]);
+    size_t cbPad = MULTI_ALIGN (cbPayload) - cbPayload;
+    uint32_t addr = (i == 1) ? addrLoadInitrd : addrLoad + ib;
+    char rgb[4];
+    int result;
+
+    if (cbPayload > cb - ib)
+      ERROR_RETURN (ERROR_FAILURE, "inconsistent multi-image sizes");
+    if (cbPad > cb - ib - cbPayload)
+      cbPad = cb - ib - cbPayload; /* The last may be unpadded */
+
+    parse_descriptor_simple ("memory", addr, cbPayload, &dout);
+    result = region_copy (&dout, d, regionCopySpinner
+                          | (info->fVerify ? regionCopyVerify : 0), ck);
+    if (result < 0)
+      return result;
+    if (result != cbPayload) {
+      printf ("Payload %d truncated, %d of %d bytes\n",
+              i, result, (int) cbPayload);
+      ERROR_RETURN (ERROR_FAILURE, "truncated payload");
+    }
+    if (cbPad) {
+      if (d->driver->read (d, rgb, cbPad) != cbPad)
+        ERROR_RETURN (ERROR_IOFAILURE, "payload padding missing");
+      if (ck)
+        region_checksum_update (ck, rgb, cbPad);
+    }
+    ib += cbPayload + cbPad;
+  }
+
+  if (ib != cb)
+    ERROR_RETURN (ERROR_FAILURE, "inconsistent multi-image sizes");
+  return 0;
+}
+
+
 /** Handle loading of UBOOT image payloads.  It loads the payload into
     memory at the load address.  For kernel payloads, it sets
     environment variables for the entry point and Linux kernel
     architecture ID.  For initrd payloads it sets the environment
     variables for the start address and size of the initrd.  Also, if
     an image has no load address, the payload will be loaded to the
-    default address built into APEX. */
+    default address built into APEX.  When CONFIG_IMAGE_INFLATE is
+    set, gzip compressed single images are inflated to the load
+    address.  Other images are copied as they are. */
 
 int handle_load_uboot_image (struct descriptor_d* d, struct image_info* info,
                              struct header* header)
 {
   int result = 0;
   struct descriptor_d dout;
-  unsigned long crc = swabl (header->crc);
-  unsigned long crc_calc = 0;
+  struct region_checksum_d ck;
+  uint32_t crc = swabl (header->crc);
+  uint32_t crc_calc = 0;
   uint32_t addrLoad = swabl (header->load_address);
   uint32_t addrEntry = swabl (header->entry_point);
   uint32_t addrLoadInitrd = ~0;
   size_t cbCheck = swabl (header->size);
   size_t cb = cbCheck;
+  size_t cbLoaded;
+  int fInflate = 0;
 
   if (info->load_address_override != ~0)
     addrLoad = info->load_address_override;
 
+#if defined (CONFIG_IMAGE_INFLATE)
+  fInflate = header->compression == compGZIP
+    && header->image_type != typeMulti;
+#endif
+
   if (header->image_type == typeMulti)
     cb -= (g_cPayloads + 1)*sizeof (*g_rgSizes); /* Correct data_size */
 
-  if (header->image_type == typeMulti && g_cPayloads == 2) {
+  if (header->image_type == typeMulti && g_cPayloads > 1) {
     printf ("# Kernel (%s) mem:0x%08x+0x%08x %s\n",
             describe_uboot_image_type (header->image_type), addrLoad,
             swabl (g_rgSizes[0]), header->image_name);
-    addrLoadInitrd = addrLoad + swabl (g_rgSizes[0]);
-    printf ("# Initrd (%s) mem:0x%08x+0x%08x %s\n",
+    addrLoadInitrd = addrLoad + MULTI_ALIGN (swabl (g_rgSizes[0]));
+    if (info->initrd_relocate != ~0)
+      addrLoadInitrd = info->initrd_relocate;
+    printf ("# Initrd (%s) mem:0x%08x+0x%08x %s%s\n",
             describe_uboot_image_type (header->image_type),
-            addrLoadInitrd, swabl (g_rgSizes[1]), header->image_name);
+            addrLoadInitrd, swabl (g_rgSizes[1]), header->image_name,
+            info->initrd_relocate != ~0 ? " [relocated]" : "");
   }
   else
-    printf ("# %s mem:0x%08x+0x%08x %s\n",
+    printf ("# %s mem:0x%08x%s0x%08x %s\n",
             describe_uboot_image_type (header->image_type), addrLoad,
+            fInflate ? " <= gzip " : "+",
             cb, header->image_name);
 
 
-    /* Copy image and check CRC */
+    /* Copy image and check CRC in a single pass */
   if (info->fRegionCanExpand
       && d->length - d->index < cb)
     d->length = d->index + cb;
 
-  parse_descriptor_simple ("memory", addrLoad, cb, &dout);
-  result = region_copy (&dout, d, regionCopySpinner); /* Perform load */
-  if (result >= 0) {
+  if (header->image_type == typeMulti)
+    crc_calc = compute_crc32_lsb (crc_calc, g_rgSizes,
+                                  (g_cPayloads + 1)*sizeof (*g_rgSizes));
+  region_checksum_init (&ck, regionChecksumLSB, crc_calc);
+
+  TRACE (traceImage, header->image_type,
+         describe_uboot_image_type (header->image_type));
+#if defined (CONFIG_IMAGE_INFLATE)
+  if (fInflate) {
+    parse_descriptor_simple ("memory", addrLoad, 0, &dout);
+    result = region_inflate (&dout, d, cb, regionInflateSpinner,
+                             info->fCached ? NULL : &ck);
+    cbLoaded = result;
+  }
+  else
+#endif
+  if (header->image_type == typeMulti) {
+    result = load_uboot_multi (d, info, addrLoad, addrLoadInitrd, cb,
+                               info->fCached ? NULL : &ck);
+    cbLoaded = cb;
+  }
+  else {
     parse_descriptor_simple ("memory", addrLoad, cb, &dout);
-    if (header->image_type == typeMulti)
-      crc_calc = compute_crc32_lsb (crc_calc, g_rgSizes,
-                                    (g_cPayloads + 1)*sizeof (*g_rgSizes));
-    result = region_checksum (cb, &dout,
-                              regionChecksumSpinner | regionChecksumLSB,
-                              &crc_calc);
+    result = region_copy (&dout, d, regionCopySpinner
+                          | (info->fVerify ? regionCopyVerify : 0),
+                          info->fCached ? NULL : &ck);	/* Perform load */
+    cbLoaded = cb;
   }
+  crc_calc = region_checksum_finish (&ck);
 
   printf ("\r");
   if (result < 0)
     return result;
-  if (crc != crc_calc) {
-    DBG (1, "crc 0x%08lx  crc_calc 0x%08lx\n", crc, crc_calc);
+  if (!info->fCached && crc != crc_calc) {
+    DBG (1, "crc 0x%08x  crc_calc 0x%08x\n", crc, crc_calc);
     ERROR_RETURN (ERROR_CRCFAILURE, "payload CRC error");
   }
-
-  if (addrLoadInitrd != ~0 && info->initrd_relocate != ~0) {
-    printf ("# Initrd (%s) mem:0x%08x+0x%08x [relocation]\n",
-            describe_uboot_image_type (header->image_type),
-            info->initrd_relocate, swabl (g_rgSizes[1]));
-    memcpy ((void*) info->initrd_relocate, (void*) addrLoadInitrd,
-            swabl (g_rgSizes[1]));
-    addrLoadInitrd = info->initrd_relocate;
-  }
+  TRACE (traceImage, header->image_type, "loaded");
 
 #if defined (CONFIG_VARIABLES)
   if (header->image_type == typeKernel && addrEntry != ~0) {
@@ -427,8 +528,8 @@ int handle_load_uboot_image (struct descriptor_d* d, struct image_info* info,
   }
   if (header->image_type == typeRamdisk) {
     size_t size = lookup_variable_or_env_unsigned ("ramdisksize", ~0);
-    if (size != cb)
-      variable_set_hex ("ramdisksize", cb);
+    if (size != cbLoaded)
+      variable_set_hex ("ramdisksize", cbLoaded);
     if (addrLoad != ~0) {
       unsigned addr = lookup_variable_or_env_unsigned ("ramdiskaddr", ~0);
       if (addr != addrLoad)
@@ -450,7 +551,11 @@ int handle_load_uboot_image (struct descriptor_d* d, struct image_info* info,
   }
 #endif
 
-  printf ("%d bytes transferred\n", cb);
+  if (fInflate)
+    printf ("%d bytes inflated from %d", cbLoaded, cb);
+  else
+    printf ("%d bytes transferred", cb);
+  printf (info->fCached ? ", CRC previously verified\n" : "\n");
 
   return 0;
 }
@@ -465,8 +570,8 @@ int handle_check_uboot_image (struct descriptor_d* d, struct image_info* info,
                               struct header* header)
 {
   int result = 0;
-  unsigned long crc = swabl (header->crc);
-  unsigned long crc_calc = 0;
+  uint32_t crc = swabl (header->crc);
+  uint32_t crc_calc = 0;
   size_t cbCheck = swabl (header->size);
   size_t cb = cbCheck;
 
@@ -484,11 +589,11 @@ int handle_check_uboot_image (struct descriptor_d* d, struct image_info* info,
 
   if (result < 0)
     return result;
-  printf ("\r%d bytes checked, CRC 0x%08lx ", cbCheck, crc);
+  printf ("\r%d bytes checked, CRC 0x%08x ", cbCheck, crc);
   if (crc == crc_calc)
     printf ("OK\n");
   else
-    printf ("!= 0x%08lx ERR\n", crc_calc);
+    printf ("!= 0x%08x ERR\n", crc_calc);
   if (crc != crc_calc)
     ERROR_RETURN (ERROR_CRCFAILURE, "payload CRC error");
 
@@ -536,6 +641,9 @@ int handle_uboot_image (int op, struct descriptor_d* d, struct image_info* info)
   switch (op) {
   case 'c':
     result = uboot_image (handle_check_uboot_image, d, info);
+    if (result >= 0)
+      image_cache_verified (d, ((struct header*) g_rgbHeader)->header_crc,
+                            d->index);
     break;
 #if defined (CONFIG_CMD_IMAGE_SHOW)
   case 's':
@@ -543,7 +651,12 @@ int handle_uboot_image (int op, struct descriptor_d* d, struct image_info* info)
     break;
 #endif
   case 'l':
+    info->fCached = !info->fForceCheck
+      && image_cache_lookup (d, ((struct header*) g_rgbHeader)->header_crc);
     result = uboot_image (handle_load_uboot_image, d, info);
+    if (result >= 0 && !info->fCached)
+      image_cache_verified (d, ((struct header*) g_rgbHeader)->header_crc,
+                            d->index);
     break;
   }
   return result;
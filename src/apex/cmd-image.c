@@ -72,6 +72,20 @@ int cmd_image (int argc, const char** argv)
         argv += 2;
         break;
 
+      case 'v':
+        info.fVerify = true;
+        --argc;
+        ++argv;
+        break;
+
+#if defined (CONFIG_IMAGE_CACHE)
+      case 'f':
+        info.fForceCheck = true;
+        --argc;
+        ++argv;
+        break;
+#endif
+
       default:
         return ERROR_PARAM;
       }
@@ -155,8 +169,12 @@ static __command struct command_d c_image = {
 #endif
 "    check    - check the integrity of the image including payload CRCs\n"
 "  Options:\n"
-"    -r ADDR  - Relocate ramdisk to ADDR after load.  Useful for uImages.\n"
+"    -r ADDR  - Load the ramdisk to ADDR.  Useful for uImages.\n"
 "    -l ADDR  - Override load address.  Useful for uImages.\n"
+"    -v       - Verify payloads by rereading them after load.\n"
+#if defined (CONFIG_IMAGE_CACHE)
+"    -f       - Check payload CRCs even if the image was verified before.\n"
+#endif
 "  The -r and -l options are intended for use with UBoot images\n"
 "  because some uImages will not be completely compatible with APEX.  It\n"
 "  is always better to modify images to carry correct parameters instead\n"
@@ -22,6 +22,9 @@
 
 struct image_info {
   bool fRegionCanExpand;
+  bool fVerify;			/* Verify payloads after loading */
+  bool fForceCheck;		/* Ignore the verified image cache */
+  bool fCached;			/* Payload CRCs already verified */
   uint32_t initrd_relocate;
   uint32_t load_address_override;
 };
@@ -0,0 +1,73 @@
+/* cmd-trace.c
+
+   written by agent
+   16 Oct 2026
+
+   Copyright (C) 2026 agent
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   version 2 as published by the Free Software Foundation.
+   Please refer to the file debian/copyright for further details.
+
+   -----------
+   DESCRIPTION
+   -----------
+
+   Shows the boot phase trace ring.
+
+*/
+
+#include <linux/types.h>
+#include <apex.h>
+#include <command.h>
+#include <error.h>
+#include <trace.h>
+
+static const char* describe_trace_type (int type)
+{
+  switch (type) {
+  case traceService:	return "service";
+  case traceCommand:	return "command";
+  case traceOpen:	return "open";
+  case traceImage:	return "image";
+  case traceBoot:	return "boot";
+  default:		return "?";
+  }
+}
+
+static int cmd_trace (int argc, const char** argv)
+{
+  int c = trace_count ();
+  int i;
+  unsigned long timeLast = 0;
+
+  if (argc != 1)
+    return ERROR_PARAM;
+
+  for (i = 0; i < c; ++i) {
+    struct trace_entry entry;
+    trace_get (i, &entry);
+    printf (" %7d ms +%5ld  %-8s %3d %.*s\n",
+	    entry.time, entry.time - timeLast,
+	    describe_trace_type (entry.type), entry.arg,
+	    (int) sizeof (entry.sz), entry.sz);
+    timeLast = entry.time;
+  }
+
+  return 0;
+}
+
+static __command struct command_d c_trace = {
+  .command = "trace",
+  .func = cmd_trace,
+  COMMAND_DESCRIPTION ("show boot phase trace")
+  COMMAND_HELP(
+"trace\n"
+"  Shows the timestamped events recorded while booting, oldest first.\n"
+"  Each line shows the time since the timer started, the time since the\n"
+"  previous event, the event type, an argument, and a label.  Events\n"
+"  that precede the timer show zero.  The same events are passed to the\n"
+"  kernel in an ATAG.\n"
+  )
+};
@@ -40,6 +40,7 @@
 #include <environment.h>
 #include <spinner.h>
 #include <lookup.h>
+#include <trace.h>
 #include <talk.h>
 
 const char* error_description;
@@ -315,6 +316,7 @@ void exec_monitor (void)
 	++pch;
       if (*pch) {
 	printf ("\r# %s\n", pch);
+	TRACE (traceCommand, 0, pch);
 	result = parse_command (pch, &argc, &argv);
 	if (result >= 0 && (call_command (argc, argv) && result != 1))
 	  break;
@@ -322,6 +324,7 @@ void exec_monitor (void)
       pch = (pchEnd ? pchEnd + 1 : 0);
       DBG (1, " pch 0x%p *pch %x\n", pch, pch ? *pch : 0);
     }
+    TRACE (traceCommand, 1, NULL);	/* End of startup */
   }
 
   do {
@@ -0,0 +1,435 @@
+/* image-cache.c
+
+   written by agent
+   16 Oct 2026
+
+   Copyright (C) 2026 agent
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   version 2 as published by the Free Software Foundation.
+   Please refer to the file debian/copyright for further details.
+
+   -----------
+   DESCRIPTION
+   -----------
+
+   Verified image cache.  Once the payload CRCs of an image in flash
+   have been checked, a record of the image location and its header
+   CRC is appended to a small flash region.  Later loads of the same
+   image from the same location may skip computing the payload CRC
+   while the record stands.
+
+   A record is withdrawn when anything in APEX writes or erases flash
+   that overlaps the image.  When the service initializes, it
+   interposes on the write, write_start, and erase methods of every
+   driver that can erase.  The wrappers clear the record's valid word
+   before the driver changes the flash, so an interrupted write
+   leaves no stale record.  Each cached load clears one bit of the
+   record's uses word and, once IMAGE_CACHE_INTERVAL bits are clear,
+   the next load checks the payload CRC again and writes a fresh
+   record.
+
+   The region is a log like the environment.  Records are appended
+   and withdrawn by clearing bits in place, so the region must be in
+   flash that allows it, e.g. NOR.  When the region is full, it is
+   erased and the valid records are written again at its start.
+
+   NOTES
+   -----
+
+   o Writes made outside of APEX, e.g. by Linux, cannot be seen.  The
+     header CRC of an APEX or UBoot image covers the payload CRCs, so
+     a replaced image no longer matches its record.  Corruption of the
+     payload alone is caught by the periodic full check or by the
+     image command's -f option.
+
+   o Erases are rounded out to the erase block size reported by the
+     driver.
+
+   o Only the valid records are kept in RAM.  They are read from the
+     region when first needed and again after the region itself has
+     been written by something other than this code.
+
+*/
+
+#include <config.h>
+#include <apex.h>
+#include <linux/string.h>
+#include <linux/kernel.h>
+#include <driver.h>
+#include <service.h>
+#include <error.h>
+#include <crc32.h>
+#include "image-cache.h"
+
+#define C_DRIVERS_MAX		(64)
+#define C_ENTRIES_MAX		(16)	/* Valid records tracked in RAM */
+#define CB_DRIVER_NAME		(16)
+#define IMAGE_CACHE_MAGIC	(0x494d4331) /* 'IMC1' */
+
+struct image_cache_record {
+  uint32_t magic;
+  uint32_t valid;		/* ~0 until the image location is written */
+  uint32_t uses;		/* One bit cleared by each cached load */
+  char driver[CB_DRIVER_NAME];
+  uint32_t start;
+  uint32_t length;
+  uint32_t header_crc;
+  uint32_t crc;			/* Covers driver through header_crc */
+};
+
+struct image_cache_entry {
+  struct driver_d* driver;
+  unsigned long start;
+  unsigned long length;
+  uint32_t header_crc;
+  uint32_t uses;
+  size_t ib;			/* Offset of the record in the region */
+};
+
+struct image_cache_methods {
+  ssize_t	(*write) (struct descriptor_d*, const void* pv, size_t cb);
+  void		(*erase) (struct descriptor_d*, size_t cb);
+  ssize_t	(*write_start) (struct descriptor_d*, const void* pv, size_t cb);
+};
+
+extern char APEX_DRIVER_START[];
+extern char APEX_DRIVER_END[];
+
+static struct image_cache_methods methods[C_DRIVERS_MAX];
+
+static struct descriptor_d d_cache;
+static int state;		/* 0 unopened, 1 open, <0 unavailable */
+static bool fLoaded;
+static struct image_cache_entry entries[C_ENTRIES_MAX];
+static int cEntries;
+static size_t ibFree;		/* Offset of the first unused record */
+
+static inline struct image_cache_methods* methods_of (struct driver_d* driver)
+{
+  return &methods[driver - (struct driver_d*) APEX_DRIVER_START];
+}
+
+static inline bool is_cacheable (struct descriptor_d* d)
+{
+  return d->driver >= (struct driver_d*) APEX_DRIVER_START
+    && d->driver - (struct driver_d*) APEX_DRIVER_START < C_DRIVERS_MAX
+    && methods_of (d->driver)->erase != NULL;
+}
+
+static inline bool overlaps (unsigned long start, unsigned long length,
+                             unsigned long ib, unsigned long ibEnd)
+{
+  return ib < start + length && ibEnd > start;
+}
+
+static uint32_t record_crc (const struct image_cache_record* rec)
+{
+  return compute_crc32 (0, rec->driver,
+                        (const char*) &rec->crc - rec->driver);
+}
+
+static struct driver_d* find_driver_name (const char* sz)
+{
+  struct driver_d* driver;
+
+  for (driver = (struct driver_d*) APEX_DRIVER_START;
+       driver < (struct driver_d*) APEX_DRIVER_END; ++driver)
+    if (driver->name && strcmp (driver->name, sz) == 0)
+      return driver;
+  return NULL;
+}
+
+
+/* The region is read through the driver and written with the saved
+   methods so that these writes don't withdraw records. */
+
+static ssize_t _cache_read (size_t ib, void* pv, size_t cb)
+{
+  d_cache.driver->seek (&d_cache, ib, SEEK_SET);
+  return d_cache.driver->read (&d_cache, pv, cb);
+}
+
+static ssize_t _cache_write (size_t ib, const void* pv, size_t cb)
+{
+  d_cache.driver->seek (&d_cache, ib, SEEK_SET);
+  return methods_of (d_cache.driver)->write (&d_cache, pv, cb);
+}
+
+static void _cache_drop (int i)
+{
+  uint32_t valid = 0;
+
+  _cache_write (entries[i].ib + offsetof (struct image_cache_record, valid),
+                &valid, sizeof (valid));
+  --cEntries;
+  memmove (&entries[i], &entries[i + 1], (cEntries - i)*sizeof (*entries));
+}
+
+static void _cache_load (void)
+{
+  struct image_cache_record rec;
+  size_t ib;
+
+  cEntries = 0;
+  ibFree = d_cache.length;
+  for (ib = 0; ib + sizeof (rec) <= d_cache.length; ib += sizeof (rec)) {
+    struct driver_d* driver;
+    const uint32_t* pl = (const uint32_t*) &rec;
+    int i;
+
+    if (_cache_read (ib, &rec, sizeof (rec)) != sizeof (rec))
+      break;
+    for (i = 0; i < sizeof (rec)/sizeof (*pl) && pl[i] == ~0; ++i)
+      ;
+    if (i == sizeof (rec)/sizeof (*pl)) {
+      ibFree = ib;		/* End of the log */
+      break;
+    }
+    if (rec.magic != IMAGE_CACHE_MAGIC || rec.valid != ~0
+        || record_crc (&rec) != rec.crc
+        || (driver = find_driver_name (rec.driver)) == NULL)
+      continue;
+
+    if (cEntries == C_ENTRIES_MAX)
+      _cache_drop (0);
+    entries[cEntries].driver = driver;
+    entries[cEntries].start = rec.start;
+    entries[cEntries].length = rec.length;
+    entries[cEntries].header_crc = rec.header_crc;
+    entries[cEntries].uses = rec.uses;
+    entries[cEntries].ib = ib;
+    ++cEntries;
+  }
+  fLoaded = true;
+}
+
+/* _cache_ready opens the cache region, once, and loads the valid
+   records if they aren't already in RAM.  It returns false when the
+   region is unusable. */
+
+static bool _cache_ready (void)
+{
+  if (state == 0) {
+    state = -1;
+    if (parse_descriptor (CONFIG_IMAGE_CACHE_REGION, &d_cache)
+        || open_descriptor (&d_cache))
+      return false;
+    if (!is_cacheable (&d_cache)
+        || d_cache.length
+	   < (C_ENTRIES_MAX + 1)*sizeof (struct image_cache_record)) {
+      close_descriptor (&d_cache);
+      return false;
+    }
+    state = 1;
+  }
+  if (state < 0)
+    return false;
+  if (!fLoaded)
+    _cache_load ();
+  return true;
+}
+
+/* _cache_append writes a record for the entry at the end of the log.
+   When the region is full, it is erased and the records of the
+   entries already in RAM are written first.  The new entry must not
+   yet be counted in cEntries. */
+
+static void _cache_append (struct image_cache_entry* e)
+{
+  struct image_cache_record rec;
+
+  if (ibFree + sizeof (rec) > d_cache.length) {
+    int i;
+    d_cache.driver->seek (&d_cache, 0, SEEK_SET);
+    methods_of (d_cache.driver)->erase (&d_cache, d_cache.length);
+    ibFree = 0;
+    for (i = 0; i < cEntries; ++i)
+      _cache_append (&entries[i]);
+  }
+
+  memset (&rec, 0xff, sizeof (rec));
+  rec.magic = IMAGE_CACHE_MAGIC;
+  rec.uses = e->uses;
+  memset (rec.driver, 0, sizeof (rec.driver));
+  strlcpy (rec.driver, e->driver->name, sizeof (rec.driver));
+  rec.start = e->start;
+  rec.length = e->length;
+  rec.header_crc = e->header_crc;
+  rec.crc = record_crc (&rec);
+
+  e->ib = ibFree;
+  ibFree += sizeof (rec);
+  _cache_write (e->ib, &rec, sizeof (rec));
+}
+
+/* image_cache_withdraw drops the records of images that overlap the
+   bytes from ib to ibEnd of the descriptor's driver. */
+
+static void image_cache_withdraw (struct descriptor_d* d,
+                                  unsigned long ib, unsigned long ibEnd)
+{
+  int i;
+
+  if (state > 0 && d->driver == d_cache.driver
+      && overlaps (d_cache.start, d_cache.length, ib, ibEnd)) {
+    fLoaded = false;		/* Reread after a write to the region */
+    return;
+  }
+
+  if (!_cache_ready ())
+    return;
+
+  for (i = 0; i < cEntries; )
+    if (entries[i].driver == d->driver
+        && overlaps (entries[i].start, entries[i].length, ib, ibEnd))
+      _cache_drop (i);
+    else
+      ++i;
+}
+
+static unsigned long erase_block_size (struct descriptor_d* d, size_t index)
+{
+  unsigned long cb = 0;
+  size_t indexSave = d->index;
+
+  d->index = index;
+  if (descriptor_query (d, QUERY_ERASEBLOCKSIZE, &cb))
+    cb = 0;
+  d->index = indexSave;
+  return cb;
+}
+
+static ssize_t image_cache_write (struct descriptor_d* d,
+                                  const void* pv, size_t cb)
+{
+  unsigned long ib = d->start + d->index;
+
+  image_cache_withdraw (d, ib, ib + cb);
+  return methods_of (d->driver)->write (d, pv, cb);
+}
+
+static ssize_t image_cache_write_start (struct descriptor_d* d,
+                                        const void* pv, size_t cb)
+{
+  unsigned long ib = d->start + d->index;
+
+  image_cache_withdraw (d, ib, ib + cb);
+  return methods_of (d->driver)->write_start (d, pv, cb);
+}
+
+static void image_cache_erase (struct descriptor_d* d, size_t cb)
+{
+  unsigned long ib = d->start + d->index;
+  unsigned long ibEnd = ib + cb;
+  unsigned long cbBlock = erase_block_size (d, d->index);
+  unsigned long cbBlockEnd = cb ? erase_block_size (d, d->index + cb - 1) : 0;
+
+  if (cbBlockEnd > cbBlock)
+    cbBlock = cbBlockEnd;
+  if (cbBlock) {
+    ib &= ~(cbBlock - 1);
+    ibEnd = (ibEnd + cbBlock - 1) & ~(cbBlock - 1);
+  }
+
+  image_cache_withdraw (d, ib, ibEnd);
+  methods_of (d->driver)->erase (d, cb);
+}
+
+
+/** image_cache_lookup returns true when the image with the given
+    header CRC at the start of the descriptor's region has been
+    verified and the location hasn't been written since.  A true
+    return uses one of the record's cached loads.  */
+
+bool image_cache_lookup (struct descriptor_d* d, uint32_t header_crc)
+{
+  int i;
+
+  if (!is_cacheable (d) || !_cache_ready ())
+    return false;
+
+  for (i = 0; i < cEntries; ++i) {
+    struct image_cache_entry* e = &entries[i];
+    uint32_t uses;
+
+    if (e->driver != d->driver || e->start != d->start
+        || e->header_crc != header_crc)
+      continue;
+    if (!(e->uses & (1UL << (CONFIG_IMAGE_CACHE_INTERVAL - 1))))
+      return false;		/* Time for a full check */
+
+    uses = e->uses & (e->uses - 1);
+    _cache_write (e->ib + offsetof (struct image_cache_record, uses),
+                  &uses, sizeof (uses));
+    e->uses = uses;
+    return true;
+  }
+  return false;
+}
+
+
+/** image_cache_verified records that the payloads of the cb byte
+    image at the start of the descriptor's region, having the given
+    header CRC, were checked.  Records for other images at the same
+    location are withdrawn. */
+
+void image_cache_verified (struct descriptor_d* d, uint32_t header_crc,
+                           size_t cb)
+{
+  int i;
+
+  if (!is_cacheable (d) || !_cache_ready ())
+    return;
+
+  for (i = 0; i < cEntries; ) {
+    struct image_cache_entry* e = &entries[i];
+    if (e->driver == d->driver && e->start == d->start && e->length == cb
+        && e->header_crc == header_crc && e->uses == ~0)
+      return;			/* Already fresh */
+    if (e->driver == d->driver && overlaps (e->start, e->length,
+                                            d->start, d->start + cb))
+      _cache_drop (i);
+    else
+      ++i;
+  }
+
+  if (cEntries == C_ENTRIES_MAX)
+    _cache_drop (0);
+  entries[cEntries].driver = d->driver;
+  entries[cEntries].start = d->start;
+  entries[cEntries].length = cb;
+  entries[cEntries].header_crc = header_crc;
+  entries[cEntries].uses = ~0;
+  _cache_append (&entries[cEntries]);
+  ++cEntries;
+}
+
+
+static void image_cache_init (void)
+{
+  struct driver_d* driver;
+
+  for (driver = (struct driver_d*) APEX_DRIVER_START;
+       driver < (struct driver_d*) APEX_DRIVER_END
+	 && driver - (struct driver_d*) APEX_DRIVER_START < C_DRIVERS_MAX;
+       ++driver) {
+    struct image_cache_methods* m = methods_of (driver);
+
+    if (!driver->erase
+        || (driver->flags & (DRIVER_CONSOLE | DRIVER_SERIAL)))
+      continue;
+
+    m->erase = driver->erase;
+    driver->erase = image_cache_erase;
+    if ((m->write = driver->write))
+      driver->write = image_cache_write;
+    if ((m->write_start = driver->write_start))
+      driver->write_start = image_cache_write_start;
+  }
+}
+
+static __service_5 struct service_d image_cache_service = {
+  .init = image_cache_init,
+};
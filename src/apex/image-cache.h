@@ -0,0 +1,40 @@
+/* image-cache.h
+
+   written by agent
+   16 Oct 2026
+
+   Copyright (C) 2026 agent
+
+   -----------
+   DESCRIPTION
+   -----------
+
+*/
+
+#if !defined (__IMAGE_CACHE_H__)
+#    define   __IMAGE_CACHE_H__
+
+/* ----- Includes */
+
+/* ----- Types */
+
+struct descriptor_d;
+
+/* ----- Globals */
+
+/* ----- Prototypes */
+
+#if defined (CONFIG_IMAGE_CACHE)
+
+bool image_cache_lookup (struct descriptor_d* d, uint32_t header_crc);
+void image_cache_verified (struct descriptor_d* d, uint32_t header_crc,
+                           size_t cb);
+
+#else
+
+# define image_cache_lookup(d,c)	(false)
+# define image_cache_verified(d,c,cb)	do { } while (0)
+
+#endif
+
+#endif  /* __IMAGE_CACHE_H__ */
@@ -0,0 +1,318 @@
+/* image-plan.c
+
+   written by agent
+   16 Oct 2026
+
+   Copyright (C) 2026 agent
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   version 2 as published by the Free Software Foundation.
+   Please refer to the file debian/copyright for further details.
+
+   -----------
+   DESCRIPTION
+   -----------
+
+   Memory layout planner for images loaded from memory.  An image
+   that was downloaded to RAM may lie where its own payloads are to
+   be loaded.  Payloads are loaded in the order they appear in the
+   image, so a payload may be written over any part of the image that
+   has already been read, but not over the part that is yet to be
+   read.
+
+   Before the payloads are loaded, the image handler describes each
+   one to the planner: the offset and length of its data in the
+   image, its load address, and how much it writes there.  The
+   planner finds the first payload that would overwrite unread image
+   data.  If there is one, the rest of the image, from that payload
+   to the end, is moved once to a gap in RAM that none of the
+   payloads write, that APEX doesn't use, and that doesn't hold image
+   data still to be read from its original place.  The highest such
+   gap is chosen.  When the load reaches the moved payload, the
+   source descriptor is pointed at the moved copy.
+
+   NOTES
+   -----
+
+   o The inflated length of a gzip or lzop payload is read from the
+     compressed data.  A zlib stream doesn't record it.  The output
+     of a zlib payload is limited to the space below the image data
+     it has yet to read when that space is at least ZLIB_RATIO times
+     the compressed length.  Otherwise, the output may run to the end
+     of its memory region and the image data is moved out of the way.
+     image_plan_output() gives the handler the limit.
+
+   o Only the image data after the header is moved.  The header has
+     already been read into the image handler's buffer.
+
+*/
+
+#include <config.h>
+#include <apex.h>
+#include <linux/string.h>
+#include <driver.h>
+#include <error.h>
+#include <drv-mem.h>
+#include "region-inflate.h"
+#include "image-plan.h"
+
+#define C_PAYLOADS_MAX	(32)
+#define PLAN_ALIGN	(16)
+#define ZLIB_RATIO	(4)	/* Least room left for inflating zlib data */
+
+struct plan_extent {
+  size_t ib;			/* Offset of the payload data in the image */
+  uint32_t addr;		/* Load address, ~0 if there is none */
+  size_t cb;			/* Bytes written at addr, or the least room */
+  bool fUnknown;		/* The length written isn't known */
+};
+
+static struct {
+  bool fActive;
+  size_t ibNext;		/* Offset of the next payload */
+  int c;
+  struct plan_extent rg[C_PAYLOADS_MAX];
+  size_t ibMove;		/* Offset of the first byte moved */
+  unsigned long addrMove;	/* Where it was moved, ~0 if not moved */
+} plan;
+
+extern char APEX_VMA_START[];
+extern char APEX_VMA_END[];
+
+static inline bool overlaps (unsigned long start, unsigned long end,
+                             unsigned long startOther, unsigned long endOther)
+{
+  return start < endOther && end > startOther;
+}
+
+/* bank_end returns the end of the memory region holding addr or zero
+   if addr isn't in memory. */
+
+static unsigned long bank_end (unsigned long addr)
+{
+  int i;
+
+  for (i = 0; i < sizeof (memory_regions)/sizeof (*memory_regions); ++i)
+    if (memory_regions[i].length
+        && addr >= memory_regions[i].start
+        && addr - memory_regions[i].start < memory_regions[i].length)
+      return memory_regions[i].start + memory_regions[i].length;
+  return 0;
+}
+
+static unsigned long apex_end (void)
+{
+  unsigned long end = (unsigned long) APEX_VMA_END;
+#if defined (CONFIG_MMU)
+  extern void* pvAlloc;
+  if ((unsigned long) pvAlloc > end)
+    end = (unsigned long) pvAlloc;
+#endif
+  return end;
+}
+
+/* output_end returns the end of the bytes written by the payload when
+   the image data not yet read lies from unread to end. */
+
+static unsigned long output_end (const struct plan_extent* e,
+                                 unsigned long unread, unsigned long end)
+{
+  unsigned long limit;
+
+  if (!e->fUnknown)
+    return e->addr + e->cb;
+
+  limit = bank_end (e->addr);
+  if (e->addr + e->cb <= unread && unread < limit)
+    limit = unread;
+  return limit ? limit : e->addr;
+}
+
+static bool conflicts (const struct plan_extent* e,
+                       unsigned long unread, unsigned long end)
+{
+  if (e->addr == ~0)
+    return false;
+  return overlaps (e->addr, output_end (e, unread, end), unread, end);
+}
+
+/* fits returns true if the image data from payload k to the end can
+   be moved to addr. */
+
+static bool fits (struct descriptor_d* d, int k, unsigned long addr, size_t cb)
+{
+  unsigned long src = d->start;
+  unsigned long srcEnd = src + plan.ibNext;
+  unsigned long end = bank_end (addr);
+  int i;
+
+  if (!end || end - addr < cb)
+    return false;
+  if (overlaps (addr, addr + cb,
+                (unsigned long) APEX_VMA_START, apex_end ()))
+    return false;
+  if (overlaps (addr, addr + cb, src + d->index, src + plan.rg[k].ib))
+    return false;
+
+  for (i = 0; i < plan.c; ++i) {
+    const struct plan_extent* e = &plan.rg[i];
+    if (e->addr == ~0)
+      continue;
+    if (i < k) {
+      if (overlaps (addr, addr + cb,
+                    e->addr, output_end (e, src + e->ib, srcEnd)))
+        return false;
+    }
+    else if (conflicts (e, addr + e->ib - plan.rg[k].ib, addr + cb))
+      return false;
+  }
+  return true;
+}
+
+static void consider (struct descriptor_d* d, int k, unsigned long top,
+                      size_t cb, unsigned long* paddr)
+{
+  unsigned long addr;
+
+  if (top < cb)
+    return;
+  addr = (top - cb) & ~(PLAN_ALIGN - 1);
+  if ((*paddr == ~0 || addr > *paddr) && fits (d, k, addr, cb))
+    *paddr = addr;
+}
+
+
+/** image_plan_begin starts a plan for loading the image that starts
+    at the beginning of the descriptor's region.  The descriptor must
+    be positioned after the image header.  The return value is true
+    when the source is memory and the image handler should describe
+    the payloads. */
+
+bool image_plan_begin (struct descriptor_d* d)
+{
+  memset (&plan, 0, sizeof (plan));
+  plan.addrMove = ~0;
+  plan.ibNext = d->index;
+  plan.fActive = d->driver->name && strcmp (d->driver->name, "memory") == 0;
+  return plan.fActive;
+}
+
+
+/** image_plan_payload describes the next payload of the image.
+    cbData is the length of its data, cbSource is the length of the
+    data and any CRC and padding that follow it. */
+
+void image_plan_payload (struct descriptor_d* d, size_t cbData,
+                         size_t cbSource, uint32_t addr, bool compressed)
+{
+  struct plan_extent* e;
+
+  if (!plan.fActive)
+    return;
+  if (plan.c >= C_PAYLOADS_MAX) {
+    plan.fActive = false;
+    return;
+  }
+
+  e = &plan.rg[plan.c++];
+  e->ib = plan.ibNext;
+  e->addr = addr;
+  e->cb = cbData;
+  plan.ibNext += cbSource;
+
+  if (compressed) {
+    ssize_t cb = ERROR_UNSUPPORTED;
+#if defined (CONFIG_IMAGE_INFLATE)
+    cb = region_inflate_length ((const void*) (d->start + e->ib), cbData);
+#endif
+    e->cb = cb < 0 ? cbData*ZLIB_RATIO : cb;
+    e->fUnknown = cb < 0;
+  }
+}
+
+
+/** image_plan_resolve checks that the payloads can be loaded in order
+    and moves the image data if they cannot. */
+
+int image_plan_resolve (struct descriptor_d* d)
+{
+  unsigned long src = d->start;
+  unsigned long srcEnd = src + plan.ibNext;
+  unsigned long addr = ~0;
+  size_t cbMove;
+  int k;
+  int i;
+
+  if (!plan.fActive)
+    return 0;
+
+  for (k = 0; k < plan.c; ++k)
+    if (conflicts (&plan.rg[k], src + plan.rg[k].ib, srcEnd))
+      break;
+
+  if (k < plan.c) {
+    cbMove = plan.ibNext - plan.rg[k].ib;
+
+    for (i = 0; i < sizeof (memory_regions)/sizeof (*memory_regions); ++i)
+      if (memory_regions[i].length)
+        consider (d, k, memory_regions[i].start + memory_regions[i].length,
+                  cbMove, &addr);
+    for (i = 0; i < plan.c; ++i)
+      if (plan.rg[i].addr != ~0)
+        consider (d, k, plan.rg[i].addr, cbMove, &addr);
+    consider (d, k, (unsigned long) APEX_VMA_START, cbMove, &addr);
+    consider (d, k, src + d->index, cbMove, &addr);
+
+    if (addr == ~0)
+      ERROR_RETURN (ERROR_OUTOFMEMORY, "no room to move image");
+
+    printf ("# moving image data mem:0x%08lx+0x%08lx to 0x%08lx\n",
+            src + plan.rg[k].ib, (unsigned long) cbMove, addr);
+    memmove ((void*) addr, (const void*) (src + plan.rg[k].ib), cbMove);
+    plan.ibMove = plan.rg[k].ib;
+    plan.addrMove = addr;
+  }
+
+	/* Record the limit of each payload's output */
+  for (i = 0; i < plan.c; ++i) {
+    struct plan_extent* e = &plan.rg[i];
+    if (e->addr == ~0 || !e->fUnknown)
+      continue;
+    if (i < k)
+      e->cb = output_end (e, src + e->ib, srcEnd) - e->addr;
+    else
+      e->cb = output_end (e, addr + e->ib - plan.ibMove,
+                          addr + plan.ibNext - plan.ibMove) - e->addr;
+  }
+
+  return 0;
+}
+
+
+/** image_plan_source points the descriptor at the moved image data
+    when the load reaches it.  It is called before each payload is
+    read. */
+
+void image_plan_source (struct descriptor_d* d)
+{
+  if (plan.fActive && plan.addrMove != ~0 && d->index == plan.ibMove)
+    d->start = plan.addrMove - plan.ibMove;
+}
+
+
+/** image_plan_output returns the number of bytes the payload at the
+    descriptor's index may write at its load address or zero when
+    there is no limit beyond the end of its memory region. */
+
+size_t image_plan_output (struct descriptor_d* d)
+{
+  int i;
+
+  if (!plan.fActive)
+    return 0;
+  for (i = 0; i < plan.c; ++i)
+    if (plan.rg[i].ib == d->index && plan.rg[i].addr != ~0)
+      return plan.rg[i].cb;
+  return 0;
+}
@@ -0,0 +1,46 @@
+/* image-plan.h
+
+   written by agent
+   16 Oct 2026
+
+   Copyright (C) 2026 agent
+
+   -----------
+   DESCRIPTION
+   -----------
+
+*/
+
+#if !defined (__IMAGE_PLAN_H__)
+#    define   __IMAGE_PLAN_H__
+
+/* ----- Includes */
+
+/* ----- Types */
+
+struct descriptor_d;
+
+/* ----- Globals */
+
+/* ----- Prototypes */
+
+#if defined (CONFIG_IMAGE_PLAN)
+
+bool image_plan_begin (struct descriptor_d* d);
+void image_plan_payload (struct descriptor_d* d, size_t cbData,
+                         size_t cbSource, uint32_t addr, bool compressed);
+int image_plan_resolve (struct descriptor_d* d);
+void image_plan_source (struct descriptor_d* d);
+size_t image_plan_output (struct descriptor_d* d);
+
+#else
+
+# define image_plan_begin(d)		(false)
+# define image_plan_payload(d,c,s,a,f)	do { } while (0)
+# define image_plan_resolve(d)		(0)
+# define image_plan_source(d)		do { } while (0)
+# define image_plan_output(d)		(0)
+
+#endif
+
+#endif  /* __IMAGE_PLAN_H__ */
@@ -18,62 +18,213 @@
 #include <driver.h>
 #include <error.h>
 #include <spinner.h>
+#include <console.h>
+#include <crc32.h>
 #include "region-checksum.h"
+#include "region-copy.h"
 #include <talk.h>
 
-extern unsigned long compute_crc32 (unsigned long crc, const void *pv, int cb);
-extern unsigned long compute_crc32_lsb (unsigned long crc,
-                                        const void *pv, int cb);
+#define CB_SEGMENT	(256*1024) /* Bytes checked between break polls */
+
+/** Prepare a streaming checksum accumulator.  The crc parameter is
+    the starting value which allows the caller to prime the CRC with
+    data that precedes the stream, e.g. a U-Boot multi-image length
+    array. */
+
+void region_checksum_init (struct region_checksum_d* ck, unsigned flags,
+                           uint32_t crc)
+{
+  ck->flags = flags;
+  ck->crc = crc;
+  ck->cb = 0;
+#if defined (CONFIG_IMAGE_BLOCK_CRC)
+  ck->rgcrcBlock = NULL;
+  ck->iBlockBad = -1;
+#endif
+}
+
+static inline void checksum_update (struct region_checksum_d* ck,
+                                    const void* pv, size_t cb)
+{
+#if defined (CONFIG_CRC32_LSB)
+  if (ck->flags & regionChecksumLSB)
+    ck->crc = compute_crc32_lsb (ck->crc, pv, cb);
+  else
+#endif
+    ck->crc = compute_crc32 (ck->crc, pv, cb);
+  ck->cb += cb;
+}
+
+#if defined (CONFIG_IMAGE_BLOCK_CRC)
+
+/** Ask a streaming checksum to check the CRC of each block of cbBlock
+    bytes against the table rgcrc as the data is added.  A block CRC
+    is computed from zero over the block alone.  The last block may
+    be short.  The checksum must be empty and it must not use
+    regionChecksumLSB. */
+
+void region_checksum_blocks (struct region_checksum_d* ck, size_t cbBlock,
+                             const uint32_t* rgcrc, int cBlocks)
+{
+  ck->rgcrcBlock = rgcrc;
+  ck->cBlocks = cBlocks;
+  ck->cbBlock = cbBlock;
+  ck->crcBlockStart = ck->crc;
+}
+
+/* check_block compares the CRC of the block that ends at the current
+   position with the table.  The CRC of the stream is linear, so the
+   block CRC is the stream CRC less the CRC at the start of the block
+   shifted by the length of the block. */
+
+static void check_block (struct region_checksum_d* ck, size_t cbInBlock)
+{
+  int i = (ck->cb - cbInBlock)/ck->cbBlock;
+  uint32_t crc = ck->crc ^ crc32_combine (ck->crcBlockStart, 0, cbInBlock);
+
+  if (ck->iBlockBad < 0 && (i >= ck->cBlocks || crc != ck->rgcrcBlock[i]))
+    ck->iBlockBad = i;
+  ck->crcBlockStart = ck->crc;
+}
+
+#endif
+
+/** Add a block of data to a streaming checksum.  The return value is
+    ERROR_CRCFAILURE once a block CRC check has failed so that the
+    caller can stop reading. */
+
+int region_checksum_update (struct region_checksum_d* ck,
+                            const void* pv, size_t cb)
+{
+#if defined (CONFIG_IMAGE_BLOCK_CRC)
+  if (ck->rgcrcBlock) {
+    while (cb) {
+      size_t cbAvailable = ck->cbBlock - ck->cb % ck->cbBlock;
+      if (cbAvailable > cb)
+        cbAvailable = cb;
+      checksum_update (ck, pv, cbAvailable);
+      if (ck->cb % ck->cbBlock == 0)
+        check_block (ck, ck->cbBlock);
+      pv = (const char*) pv + cbAvailable;
+      cb -= cbAvailable;
+    }
+    return ck->iBlockBad < 0 ? 0 : ERROR_CRCFAILURE;
+  }
+#endif
+  checksum_update (ck, pv, cb);
+  return 0;
+}
+
+/** Append the CRC of a block that was checksummed separately.  The
+    crc must have been computed from zero over cb bytes with the same
+    bit order as the accumulator.  The block need not have been
+    checked in order or through the same path as the rest of the
+    stream. */
+
+void region_checksum_combine (struct region_checksum_d* ck,
+                              uint32_t crc, size_t cb)
+{
+#if defined (CONFIG_CRC32_LSB)
+  if (ck->flags & regionChecksumLSB)
+    ck->crc = crc32_combine_lsb (ck->crc, crc, cb);
+  else
+#endif
+    ck->crc = crc32_combine (ck->crc, crc, cb);
+  ck->cb += cb;
+}
+
+/** Complete a streaming checksum, appending the length bytes when
+    regionChecksumLength was requested, and return the CRC.  A short
+    last block is checked here.  The accumulator should not be
+    updated after it is finished. */
+
+uint32_t region_checksum_finish (struct region_checksum_d* ck)
+{
+#if defined (CONFIG_IMAGE_BLOCK_CRC)
+  if (ck->rgcrcBlock && ck->cb % ck->cbBlock)
+    check_block (ck, ck->cb % ck->cbBlock);
+#endif
+  if (ck->flags & regionChecksumLength) {
+    unsigned char b;
+    unsigned long v;
+    for (v = ck->cb; v; v >>= 8) {
+      b = v & 0xff;
+      ck->crc = compute_crc32 (ck->crc, &b, 1);
+    }
+  }
+  return ck->crc;
+}
+
 
 /** Compute the CRC32 checksum for a region.  The flags includes a bit
     to add each byte of the length, in MSB (or LSB) order, as is used
     by the POSIX cksum command.  If the cbCheck parameter is non-zero,
     it will limit the extent of the check to that number of bytes,
     otherwise the whole region will be checked. Note that the crc_result
+    is also the starting value of the CRC.
+
+    The region is checked in segments of CB_SEGMENT bytes, each from
+    zero, and the segment CRCs are combined.  With regionChecksumBreak,
+    ^C on the console stops the check between segments.  The function
+    then returns ERROR_BREAK with the CRC of the segments completed,
+    without the length bytes, in crc_result and the descriptor index
+    at the end of the last segment, so that the check can be resumed
+    later and the two results combined.
 
 */
 
 int region_checksum (size_t cbCheck, struct descriptor_d* d, unsigned flags,
-                     unsigned long* crc)
+                     uint32_t* crc)
 {
   ssize_t extent = d->length - d->index;
   int index = 0;
+  struct region_checksum_d ck;
+  char* rgb = rgbRegion;
+  size_t cbTransfer = region_transfer_size (d, NULL);
 
   if (cbCheck && extent > cbCheck)
     extent = cbCheck;
 
   DBG (2, "%s: av %d\n", __FUNCTION__, cbCheck);
 
+  region_checksum_init (&ck, flags, *crc);
+
   while (index < extent) {
-    char __aligned rgb[512];
-    size_t available = sizeof (rgb);
-    int cb;
-
-    if (available > extent - index)
-      available = extent - index;
-    cb = d->driver->read (d, rgb, available);
-    if (cb < 0)
-      return ERROR_IOFAILURE;
-    if (flags & regionChecksumSpinner)
-      SPINNER_STEP;
-#if defined (CONFIG_CRC32_LSB)
-    if (flags & regionChecksumLSB)
-      *crc = compute_crc32_lsb (*crc, rgb, cb);
-    else
-#endif
-      *crc = compute_crc32 (*crc, rgb, cb);
-    index += cb;
-  }
+    struct region_checksum_d ckSegment;
+    ssize_t end = index + CB_SEGMENT;
+
+    if (end > extent)
+      end = extent;
+
+    region_checksum_init (&ckSegment, flags & regionChecksumLSB, 0);
+    while (index < end) {
+      size_t available = cbTransfer;
+      const void* pv;
+      int cb;
+
+      if (available > end - index)
+        available = end - index;
+      cb = read_mapped (d, &pv, rgb, available);
+      if (cb < 0)
+        return ERROR_IOFAILURE;
+      if (cb == 0)
+        ERROR_RETURN (ERROR_IOFAILURE, "premature end of region");
+      if (flags & regionChecksumSpinner)
+        SPINNER_STEP;
+      region_checksum_update (&ckSegment, pv, cb);
+      index += cb;
+    }
+    region_checksum_combine (&ck, ckSegment.crc, ckSegment.cb);
 
-  /* Add the length to the computation */
-  if (flags & regionChecksumLength) {
-    unsigned char b;
-    unsigned long v;
-    for (v = extent; v; v >>= 8) {
-      b = v & 0xff;
-      *crc = compute_crc32 (*crc, &b, 1);
+    if ((flags & regionChecksumBreak) && index < extent
+        && console->poll (0, 0)) {
+      *crc = ck.crc;
+      return ERROR_BREAK;
     }
   }
 
+  /* Add the length to the computation */
+  *crc = region_checksum_finish (&ck);
+
   return 0;
 }
@@ -18,6 +18,27 @@
 
 /* ----- Types */
 
+/* Streaming checksum accumulator.  The flags come from the enumeration
+   below, though only regionChecksumLength and regionChecksumLSB are
+   meaningful.  The cb field counts the bytes added so that the
+   cksum-style length tail can be appended when the stream ends.
+   With IMAGE_BLOCK_CRC, the accumulator may also check the CRC of
+   each block of cbBlock bytes against a table as the stream goes
+   by. */
+
+struct region_checksum_d {
+  unsigned flags;
+  uint32_t crc;
+  size_t cb;
+#if defined (CONFIG_IMAGE_BLOCK_CRC)
+  const uint32_t* rgcrcBlock;	/* Expected block CRCs or NULL */
+  int cBlocks;
+  size_t cbBlock;
+  uint32_t crcBlockStart;	/* crc at the start of the current block */
+  int iBlockBad;		/* First block that failed or -1 */
+#endif
+};
+
 /* ----- Globals */
 
 /* ----- Prototypes */
@@ -26,10 +47,27 @@ enum {
   regionChecksumSpinner	= (1<<0),
   regionChecksumLength	= (1<<1), /* Add non-zero length bytes, LSB first */
   regionChecksumLSB     = (1<<2), /* UBOOT compatible CRC algorithm */
+  regionChecksumBreak   = (1<<3), /* Stop on ^C between segments */
 };
 
 int region_checksum (size_t cbCheck, struct descriptor_d* din, unsigned flags,
-                     unsigned long* crc_result);
+                     uint32_t* crc_result);
+
+void region_checksum_init (struct region_checksum_d* ck, unsigned flags,
+                           uint32_t crc);
+int region_checksum_update (struct region_checksum_d* ck,
+                            const void* pv, size_t cb);
+void region_checksum_combine (struct region_checksum_d* ck,
+                              uint32_t crc, size_t cb);
+uint32_t region_checksum_finish (struct region_checksum_d* ck);
+
+#if defined (CONFIG_IMAGE_BLOCK_CRC)
+void region_checksum_blocks (struct region_checksum_d* ck, size_t cbBlock,
+                             const uint32_t* rgcrc, int cBlocks);
+# define region_checksum_bad_block(ck) ((ck)->iBlockBad)
+#else
+# define region_checksum_bad_block(ck) (-1)
+#endif
 
 
 #endif  /* __REGION_CHECKSUM_H__ */
@@ -16,31 +16,259 @@
 
 #include <config.h>
 #include <apex.h>
+#include <linux/string.h>
 #include <driver.h>
 #include <error.h>
 #include <spinner.h>
 #include "region-copy.h"
+#include "region-checksum.h"
 #include <asm/byteorder.h>
 
 
-#if !defined (CONFIG_SMALL)
-//# define USE_COPY_VERIFY	/* Define to include verify feature */
+#if defined (CONFIG_REGION_BUFFER_SIZE)
+# define CB_REGION_BUFFER	(CONFIG_REGION_BUFFER_SIZE)
+#else
+# define CB_REGION_BUFFER	(512)
 #endif
 
+char __xbss(region) __aligned rgbRegion[CB_REGION_BUFFER];
+
+#define AVAILABLE(c,s) (((c) < (s)) ? c : s)
+
+
+/** region_transfer_size negotiates the size of each transfer for a
+    pair of descriptors.  Either descriptor may be NULL.  Drivers
+    advertise a preferred unit with QUERY_IOSIZE.  The result is the
+    largest multiple of the largest preferred unit that fits within
+    the transfer buffer.  Drivers that don't answer the query accept
+    any transfer size. */
+
+size_t region_transfer_size (struct descriptor_d* din,
+                             struct descriptor_d* dout)
+{
+  struct descriptor_d* rgd[2] = { din, dout };
+  unsigned long preferred = 0;
+  unsigned long maximum = CB_REGION_BUFFER;
+  int i;
+
+  for (i = 0; i < 2; ++i) {
+    unsigned long v;
+    if (!rgd[i] || !rgd[i]->driver)
+      continue;
+    if (descriptor_query (rgd[i], QUERY_IOSIZE, &v) == 0 && v > preferred)
+      preferred = v;
+  }
+
+  if (!preferred || preferred >= maximum)
+    return maximum;
+  return maximum - maximum%preferred;
+}
+
+
+#if defined (CONFIG_REGION_COPY_PIPELINE)
+
+#define CB_PIPELINE_STEP	(512)	/* Read granularity between polls */
+#define MS_DRAIN_TIMEOUT	(6*1000) /* Longest wait for a write */
+
+/** region_copy_drain waits for the destination to finish an
+    overlapped write.  It returns zero on success, ERROR_TIMEOUT when
+    the device stays busy, or ERROR_FAILURE when the driver reports a
+    failed write. */
+
+static int region_copy_drain (struct descriptor_d* dout)
+{
+  unsigned long time = timer_read ();
+  ssize_t result;
+
+  while ((result = dout->driver->poll (dout, 0)) == 0)
+    if (timer_delta (time, timer_read ()) >= MS_DRAIN_TIMEOUT)
+      return ERROR_RESULT (ERROR_TIMEOUT, "write timed out");
+  return result < 0 ? ERROR_RESULT (ERROR_FAILURE, "write failed") : 0;
+}
+
+
+/** source_device returns the driver of the device that holds the
+    data for descriptor d.  Filesystem drivers that read through
+    another descriptor answer QUERY_DEVICE with that descriptor.  NULL
+    means that the device cannot be determined. */
+
+static struct driver_d* source_device (struct descriptor_d* d)
+{
+  struct descriptor_d* dDevice = NULL;
+
+  if (descriptor_query (d, QUERY_DEVICE, &dDevice) == 0)
+    return dDevice ? source_device (dDevice) : NULL;
+  return (d->driver->flags & DRIVER_DESCRIP_FS) ? NULL : d->driver;
+}
+
+
+/** region_copy_pipeline is the overlapped variant of region_copy.
+    The transfer buffer is split in two.  While one half is being
+    programmed by the destination driver, the next half is read from
+    the source in small steps, polling the destination between steps
+    so that it can start on its next program unit without waiting for
+    the whole read to complete.  Source and destination must be
+    different devices, including the device under a filesystem
+    source. */
+
+static int region_copy_pipeline (struct descriptor_d* dout,
+                                 struct descriptor_d* din,
+                                 unsigned flags,
+                                 struct region_checksum_d* ck,
+                                 ssize_t cbCopy)
+{
+  size_t cbHalf = (region_transfer_size (din, dout)/2) & ~3;
+  char* rgb[2] = { rgbRegion, rgbRegion + cbHalf };
+  int half = 0;
+  ssize_t cbCopied = 0;
+  int result = 0;
+  int result_drain;
+  int report_last = -1;
+  int step = DRIVER_PROGRESS (din, dout);
+  if (step)
+    step += 10;
+
+  while (cbCopy > 0) {
+    size_t available = AVAILABLE (cbCopy, cbHalf);
+    size_t cb = 0;
+    int report;
+
+    while (cb < available) {
+      ssize_t cbRead = din->driver->read
+        (din, rgb[half] + cb, AVAILABLE (available - cb, CB_PIPELINE_STEP));
+      if (cbRead < 0) {
+        result = ERROR_FAILURE;
+        goto drain;
+      }
+      if (cbRead == 0)
+        break;
+      cb += cbRead;
+      if (dout->driver->poll (dout, 0) < 0) {
+        result = ERROR_FAILURE;
+        goto drain;
+      }
+    }
+    if (cb == 0)
+      break;
+
+    if (flags & regionCopySwap) {
+      int i;
+      u32* p = (u32*) rgb[half];
+      for (i = cb/4; i-- > 0; ++p)
+        *p = swab32 (*p);
+    }
+
+    if (ck && region_checksum_update (ck, rgb[half], cb)) {
+      result = ERROR_CRCFAILURE;
+      goto drain;
+    }
+
+    if (flags & regionCopySpinner)
+      SPINNER_STEP;
+    result_drain = region_copy_drain (dout);
+    if (result_drain)
+      return result_drain;
+    if (dout->driver->write_start (dout, rgb[half], cb) != cb)
+      ERROR_RETURN (ERROR_FAILURE, "truncated write");
+
+    cbCopy -= cb;
+    cbCopied += cb;
+    half ^= 1;
+
+    report = cbCopied>>step;
+    if ((flags & regionCopySpinner) && step && report != report_last) {
+      printf ("\r   %d KiB\r", cbCopied/1024);
+      report_last = report;
+    }
+  }
+
+ drain:
+  result_drain = region_copy_drain (dout);
+  if (result_drain)
+    return result_drain;
+  if (result == ERROR_CRCFAILURE)
+    ERROR_RETURN (result, "block CRC error");
+  if (result)
+    ERROR_RETURN (result, "copy overrun");
+
+  return cbCopied;
+}
+
+#endif
+
+
+/** region_copy_verify rereads the destination once and compares its
+    CRC with the CRC accumulated while the data was being written.
+    Destinations that cannot be read cannot be verified. */
+
+static int region_copy_verify (struct descriptor_d* dout, size_t index,
+                               size_t cb, unsigned flags,
+                               uint32_t crcStart, unsigned checksum_flags,
+                               uint32_t crcExpected)
+{
+  struct descriptor_d d;
+  uint32_t crc = crcStart;
+
+  if (!driver_can_read (dout->driver))
+    ERROR_RETURN (ERROR_UNSUPPORTED, "destination cannot be verified");
+
+  memcpy (&d, dout, sizeof (d));
+  d.index = index;
+  d.length = index + cb;
+
+  if (region_checksum (0, &d, checksum_flags
+                       | ((flags & regionCopySpinner)
+                          ? regionChecksumSpinner : 0), &crc))
+    ERROR_RETURN (ERROR_IOFAILURE, "verify reread failed");
+  if (crc != crcExpected) {
+    if (!(flags & regionCopyQuiet))
+      printf ("\rVerify failed: CRC 0x%08x, expected 0x%08x\n",
+              crc, crcExpected);
+    ERROR_RETURN (ERROR_CRCFAILURE, "verify failed");
+  }
+
+  return 0;
+}
+
+
+/* read_source reads the next block of the source for region_copy.
+   The source is only mapped when it isn't on the destination's
+   driver.  While a flash chip is being programmed, reads from its
+   array return status instead of data, so the source must be in the
+   buffer before the write starts. */
+
+static ssize_t read_source (struct descriptor_d* din,
+                            struct descriptor_d* dout,
+                            const void** ppv, void* pv, size_t cb)
+{
+  if (din->driver != dout->driver)
+    return read_mapped (din, ppv, pv, cb);
+  *ppv = pv;
+  return din->driver->read (din, pv, cb);
+}
+
 
 /** region_copy copied from region din to dout.  The regions must
     already be open.  The flags parameter comes from the enumeration
-    in region-copy.h.  Verify requires that the USE_COPY_VERIFY macro
-    be set. */
+    in region-copy.h.  When ck is non-NULL, each block is added to the
+    checksum accumulator as it is written so that the caller doesn't
+    need to reread the destination to compute a CRC.  Sources that
+    can be mapped, and aren't on the destination's driver, are written
+    directly to the destination without a copy through the transfer
+    buffer.  Destinations that can program
+    in the background are handed to region_copy_pipeline ().
+
+    Verification accumulates a CRC of the data as it is written and
+    then reads the destination back once to compare CRCs.  The
+    caller's accumulator is used for this when there is one. */
 
 int region_copy (struct descriptor_d* dout, struct descriptor_d* din,
-                 unsigned flags)
+                 unsigned flags, struct region_checksum_d* ck)
 {
-#if defined (USE_COPY_VERIFY)
-  struct descriptor_d din_v;
-  struct descriptor_d dout_v;
-#endif
   ssize_t cbCopied = 0;
+  size_t indexOut = dout->index;
+  struct region_checksum_d ckVerify;
+  uint32_t crcStart;
 
   /* Make sure we try to copy the no more than either descriptor can
      handle. */
@@ -48,16 +276,23 @@ int region_copy (struct descriptor_d* dout, struct descriptor_d* din,
   if (cbCopy > dout->length - dout->index)
     cbCopy = dout->length - dout->index;
 
-#if defined (USE_COPY_VERIFY)
-  /* Create descriptors for rereading and verification */
-  /* *** FIXME: we ought to perform a dup () */
-  memcpy (&din_v, din, sizeof (*din));
-  memcpy (&dout_v, dout, sizeof (*dout));
-  dout_v.length = din_v.length;
-#endif
+  if ((flags & regionCopyVerify) && !ck) {
+    region_checksum_init (&ckVerify, 0, 0);
+    ck = &ckVerify;
+  }
+  crcStart = ck ? ck->crc : 0;
 
+#if defined (CONFIG_REGION_COPY_PIPELINE)
+  if (driver_can_overlap (dout->driver)
+      && source_device (din)
+      && source_device (din) != dout->driver)
+    cbCopied = region_copy_pipeline (dout, din, flags, ck, cbCopy);
+  else
+#endif
   {
-    char __aligned rgb[512];
+    char* rgb = rgbRegion;
+    const void* pv;		/* Either rgb or mapped source data */
+    size_t cbTransfer = region_transfer_size (din, dout);
     ssize_t cb;
     size_t available;
     int report_last = -1;
@@ -65,76 +300,34 @@ int region_copy (struct descriptor_d* dout, struct descriptor_d* din,
     if (step)
       step += 10;
 
-#define AVAILABLE(c,s) (((c) < (s)) ? c : s)
-
-    for (available = AVAILABLE (cbCopy, sizeof (rgb)) ;
-         (cb = din->driver->read (din, rgb, available)) > 0;
+    for (available = AVAILABLE (cbCopy, cbTransfer) ;
+         (cb = read_source (din, dout, &pv, rgb, available)) > 0;
 	 cbCopy -= cb, cbCopied += cb,
-           available = AVAILABLE (cbCopy, sizeof (rgb))) {
+           available = AVAILABLE (cbCopy, cbTransfer)) {
       int report;
       size_t cbWrote;
       if (cb == 0)
 	ERROR_RETURN (ERROR_FAILURE, "premature end of input");
 
-#if defined (USE_COPY_VERIFY)
-      if (flags & regionCopyVerify) {
-	char __aligned rgbVerify[512];
-	ssize_t cbVerify = din_v.driver->read (&din_v, rgbVerify,
-					       sizeof (rgbVerify));
-	if (cbVerify != cb) {
-          if (!(flags & regionCopyQuiet))
-            printf ("\rVerify failed: reread of input %d, expected %d, at"
-                    " 0x%x+0x%x\n", cbVerify, cb, cbCopied, 512);
-	  return ERROR_FAILURE;
-	}
-	if (memcmp (rgb, rgbVerify, cb)) {
-          if (!(flags & regionCopyQuiet))
-            printf ("\rVerify failed: reread input compare at 0x%x+0x%x\n",
-                    cbCopied, 512);
-	  return ERROR_FAILURE;
-	}
-      }
-#endif
-
       if (flags & regionCopySwap) {
 	int i;
-	unsigned long* p = (unsigned long*) rgb;
+	u32* p = (u32*) rgb;
+	if (pv != rgb)		/* Mapped source data is read-only */
+	  memcpy (rgb, pv, cb);
+	pv = rgb;
 	for (i = cb/4; i-- > 0; ++p)
 	  *p = swab32 (*p);
       }
 
+      if (ck && region_checksum_update (ck, pv, cb))
+        ERROR_RETURN (ERROR_CRCFAILURE, "block CRC error");
+
       if (flags & regionCopySpinner)
         SPINNER_STEP;
-      cbWrote = dout->driver->write (dout, rgb, cb);
+      cbWrote = dout->driver->write (dout, pv, cb);
       if (cbWrote != cb)
 	ERROR_RETURN (ERROR_FAILURE, "truncated write");
 
-#if defined (USE_COPY_VERIFY)
-      if (verify) {
-	char rgbVerify[512];
-	ssize_t cbVerify = dout_v.driver->read (&dout_v, rgbVerify,
-						sizeof (rgbVerify));
-	if (cbVerify != cb) {
-          if (flags & regionCopyReportVerifyErrors)
-            printf ("\rVerify failed: reread of output %d, expected %d, at"
-                    " 0x%x+0x%x\n", cbVerify, cb, cbCopied, 512);
-	  return ERROR_FAILURE;
-	}
-	if (swap) {
-	  int i;
-	  unsigned long* p = (unsigned long*) rgbVerify;
-	  for (i = cb/4; i-- > 0; ++p)
-	    *p = swab32 (*p);
-	}
-	if (memcmp (rgb, rgbVerify, cb)) {
-          if (flags & regionCopyReportVerifyErrors)
-            printf ("\rVerify failed: reread output compare at 0x%x+0x%x\n",
-                    cbCopied, 512);
-	  return ERROR_FAILURE;
-	}
-      }
-#endif
-
       report = cbCopied>>step;
       if ((flags & regionCopySpinner) && step && report != report_last) {
 	printf ("\r   %d KiB\r", cbCopied/1024);
@@ -146,5 +339,13 @@ int region_copy (struct descriptor_d* dout, struct descriptor_d* din,
       ERROR_RETURN (ERROR_FAILURE, "copy overrun");
   }
 
+  if (cbCopied > 0 && (flags & regionCopyVerify)) {
+    int result = region_copy_verify (dout, indexOut, cbCopied, flags,
+                                     crcStart, ck->flags & regionChecksumLSB,
+                                     ck->crc);
+    if (result)
+      return result;
+  }
+
   return cbCopied;
 }
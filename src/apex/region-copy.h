@@ -18,8 +18,12 @@
 
 /* ----- Types */
 
+struct region_checksum_d;
+
 /* ----- Globals */
 
+extern char rgbRegion[];	/* Shared transfer buffer */
+
 /* ----- Prototypes */
 
 enum {
@@ -29,7 +33,9 @@ enum {
   regionCopyQuiet	= (1<<3),
 };
 
+size_t region_transfer_size (struct descriptor_d* din,
+                             struct descriptor_d* dout);
 int region_copy (struct descriptor_d* dout, struct descriptor_d* din,
-                 unsigned flags);
+                 unsigned flags, struct region_checksum_d* ck);
 
 #endif  /* __REGION_COPY_H__ */
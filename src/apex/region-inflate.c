@@ -0,0 +1,534 @@
+/* region-inflate.c
+
+   written by agent
+   16 Oct 2026
+
+   Copyright (C) 2026 agent
+
+   -----------
+   DESCRIPTION
+   -----------
+
+   Streaming decompression of a region into memory.  The compressed
+   data is read from the source in transfer sized pieces, mapped when
+   the source driver allows it, and inflated directly to the
+   destination address.  The inflate engine pulls each piece through
+   a callback and uses the destination as its window.  There is no
+   intermediate copy of the compressed or of the decompressed data.
+
+   Both zlib and gzip streams are accepted.  The format is detected
+   from the first bytes of the stream.  The gzip header is skipped and
+   the deflate data is inflated by inflate_gzip.  The gzip CRC32 and
+   length and the zlib Adler-32 are both checked.  The inflate engine
+   computes each check as it writes the output, so the check doesn't
+   read the decompressed image a second time.  The callers' CRC of
+   the compressed stream doesn't cover a bad decompressor or a store
+   to memory that fails.
+
+   When LZO is configured, lzop files are accepted as well.  An lzop
+   file is a header followed by independently compressed LZO1X
+   blocks of at most 256KiB.  Each block is decompressed in one call,
+   so it must be contiguous.  Blocks are used in place when the
+   source can map them and are otherwise gathered into a block
+   buffer.  The Adler-32 and CRC32 of the decompressed data of each
+   block are checked when the file has them.  The checksums of the
+   compressed data are redundant with the callers' CRC and are
+   skipped.
+
+*/
+
+//#define TALK 2
+
+#include <config.h>
+#include <apex.h>
+#include <linux/string.h>
+#include <driver.h>
+#include <error.h>
+#include <spinner.h>
+#include <inflate.h>
+#include <drv-mem.h>
+#include <lzo.h>
+#include <zlib.h>
+#include <crc32.h>
+#include "region-copy.h"
+#include "region-checksum.h"
+#include "region-inflate.h"
+#include <talk.h>
+
+#define AVAILABLE(c,s) (((c) < (s)) ? c : s)
+
+#define DEFLATED	(8)		/* Compression method in both headers */
+
+enum {
+  gzipHeaderCRC		= (1<<1),
+  gzipExtra		= (1<<2),
+  gzipName		= (1<<3),
+  gzipComment		= (1<<4),
+};
+
+
+/** gzip_header_length returns the length of the gzip member header
+    at the start of pb, zero when the data doesn't start with a gzip
+    signature, or an error code when the header is not a deflate
+    header or it doesn't fit within cb bytes. */
+
+static int gzip_header_length (const unsigned char* pb, size_t cb)
+{
+  size_t ib = 10;
+
+  if (cb < 2 || pb[0] != 0x1f || pb[1] != 0x8b)
+    return 0;
+  if (cb < ib || pb[2] != DEFLATED)
+    return ERROR_UNSUPPORTED;
+
+  if (pb[3] & gzipExtra) {
+    if (cb < ib + 2)
+      return ERROR_FAILURE;
+    ib += 2 + pb[ib] + (pb[ib + 1] << 8);
+  }
+  if (pb[3] & gzipName) {
+    while (ib < cb && pb[ib])
+      ++ib;
+    ++ib;
+  }
+  if (pb[3] & gzipComment) {
+    while (ib < cb && pb[ib])
+      ++ib;
+    ++ib;
+  }
+  if (pb[3] & gzipHeaderCRC)
+    ib += 2;
+
+  return ib <= cb ? ib : ERROR_FAILURE;
+}
+
+
+/** is_zlib_header returns true if the data starts with a valid zlib
+    stream header. */
+
+static int is_zlib_header (const unsigned char* pb, size_t cb)
+{
+  return cb >= 2
+    && (pb[0] & 0xf) == DEFLATED
+    && ((pb[0] << 8) | pb[1]) % 31 == 0;
+}
+
+
+#if defined (CONFIG_LZO)
+
+#define CB_LZO_BLOCK_MAX	(256*1024) /* Largest lzop block */
+
+static unsigned char __xbss(lzo) rgbLzo[CB_LZO_BLOCK_MAX];
+
+static const unsigned char lzop_magic[] = {
+  0x89, 'L', 'Z', 'O', 0x00, 0x0d, 0x0a, 0x1a, 0x0a };
+
+enum {
+  lzopAdler32D		= 0x001,
+  lzopAdler32C		= 0x002,
+  lzopExtraField	= 0x040,
+  lzopCRC32D		= 0x100,
+  lzopCRC32C		= 0x200,
+  lzopFilter		= 0x800,
+};
+
+struct lzop_source {
+  struct descriptor_d* d;
+  size_t cbIn;			/* Bytes not yet read from d */
+  const unsigned char* pb;	/* Unused bytes from the first read */
+  size_t cb;
+  struct region_checksum_d* ck;
+};
+
+static inline unsigned long be32 (const unsigned char* pb)
+{
+  return ((unsigned long) pb[0] << 24) | (pb[1] << 16) | (pb[2] << 8) | pb[3];
+}
+
+
+/** lzop_fetch returns a pointer to the next cb bytes of the stream or
+    NULL if the stream ends first.  The data is used in place when it
+    is left over from the first read or when the source can map it.
+    Otherwise, it is gathered into rgbLzo. */
+
+static const unsigned char* lzop_fetch (struct lzop_source* s, size_t cb)
+{
+  const void* pv;
+  size_t cbHave = s->cb;
+  ssize_t cbRead;
+
+  if (cb <= cbHave) {
+    pv = s->pb;
+    s->pb += cb;
+    s->cb -= cb;
+    return pv;
+  }
+
+  if (cb > sizeof (rgbLzo) || cb - cbHave > s->cbIn)
+    return NULL;
+  cbRead = read_mapped (s->d, &pv, rgbLzo + cbHave, cb - cbHave);
+  if (cbRead != cb - cbHave)
+    return NULL;
+  if (s->ck && region_checksum_update (s->ck, pv, cbRead))
+    return NULL;
+  s->cbIn -= cbRead;
+
+  if (!cbHave)
+    return pv;
+  memcpy (rgbLzo, s->pb, cbHave);
+  if (pv != rgbLzo + cbHave)
+    memcpy (rgbLzo + cbHave, pv, cbRead);
+  s->cb = 0;
+  return rgbLzo;
+}
+
+#define FETCH(cb) \
+  if ((pb = lzop_fetch (s, (cb))) == NULL) goto truncated
+
+
+/** lzop_header reads the lzop file header and returns its flags or an
+    error code. */
+
+static long lzop_header (struct lzop_source* s)
+{
+  const unsigned char* pb;
+  unsigned version;
+  unsigned long lzop_flags;
+
+  FETCH (sizeof (lzop_magic) + 4);
+  version = (pb[9] << 8) | pb[10];
+  if (version >= 0x940)
+    FETCH (2);			/* Version needed to extract */
+  FETCH (1);
+  if (*pb < 1 || *pb > 3)
+    ERROR_RETURN (ERROR_UNSUPPORTED, "lzop method is not LZO1X");
+  if (version >= 0x940)
+    FETCH (1);			/* Level */
+  FETCH (4);
+  lzop_flags = be32 (pb);
+  if (lzop_flags & lzopFilter)
+    ERROR_RETURN (ERROR_UNSUPPORTED, "lzop filters unsupported");
+  FETCH (version >= 0x940 ? 12 : 8); /* Mode and modification time */
+  FETCH (1);
+  FETCH (*pb + 4);		/* Name and header checksum */
+  if (lzop_flags & lzopExtraField) {
+    FETCH (4);
+    FETCH (be32 (pb) + 4);
+  }
+  return lzop_flags;
+
+ truncated:
+  ERROR_RETURN (ERROR_FAILURE, "truncated compressed data");
+}
+
+/** lzop_checks returns the length of the checksums that precede the
+    data of a block. */
+
+static size_t lzop_checks (unsigned long lzop_flags,
+                           size_t cbDst, size_t cbSrc)
+{
+  size_t cb = ((lzop_flags & lzopAdler32D) ? 4 : 0)
+    + ((lzop_flags & lzopCRC32D) ? 4 : 0);
+  if (cbSrc < cbDst)
+    cb += ((lzop_flags & lzopAdler32C) ? 4 : 0)
+      + ((lzop_flags & lzopCRC32C) ? 4 : 0);
+  return cb;
+}
+
+
+/** region_unlzo decompresses an lzop file into the memory region
+    dout.  It is the lzop branch of region_inflate. */
+
+static ssize_t region_unlzo (struct descriptor_d* dout,
+                             struct lzop_source* s, unsigned flags)
+{
+  unsigned char* pbOut = (unsigned char*) (unsigned long)
+    (dout->start + dout->index);
+  size_t cbAvailable = dout->length - dout->index;
+  size_t cbOut = 0;
+  const unsigned char* pb;
+  long lzop_flags;
+  int report_last = -1;
+  int step = DRIVER_PROGRESS (s->d, dout);
+  if (step)
+    step += 10;
+
+  lzop_flags = lzop_header (s);
+  if (lzop_flags < 0)
+    return lzop_flags;
+
+  for (;;) {
+    size_t cbDst;
+    size_t cbSrc;
+    size_t cbChecks;
+    unsigned long adler = 0;
+    unsigned long crc = 0;
+    int report;
+
+    FETCH (4);
+    cbDst = be32 (pb);
+    if (cbDst == 0)
+      break;
+    FETCH (4);
+    cbSrc = be32 (pb);
+    if (cbDst > CB_LZO_BLOCK_MAX || cbSrc > cbDst)
+      ERROR_RETURN (ERROR_FAILURE, "corrupt lzop block header");
+    if (cbDst > cbAvailable - cbOut)
+      ERROR_RETURN (ERROR_OUTOFMEMORY, "inflated data overruns memory");
+
+    cbChecks = lzop_checks (lzop_flags, cbDst, cbSrc);
+    if (cbChecks) {
+      FETCH (cbChecks);
+      if (lzop_flags & lzopAdler32D) {
+        adler = be32 (pb);
+        pb += 4;
+      }
+      if (lzop_flags & lzopCRC32D)
+        crc = be32 (pb);
+    }
+
+    FETCH (cbSrc);
+    if (cbSrc == cbDst)		/* Stored uncompressed */
+      memcpy (pbOut + cbOut, pb, cbDst);
+    else {
+      size_t cb = cbDst;
+      if (lzo1x_decompress (pb, cbSrc, pbOut + cbOut, &cb) != LZO_E_OK
+          || cb != cbDst)
+        ERROR_RETURN (ERROR_FAILURE, "corrupt compressed data");
+    }
+    if (((lzop_flags & lzopAdler32D)
+         && adler32 (1, pbOut + cbOut, cbDst) != adler)
+        || ((lzop_flags & lzopCRC32D)
+            && compute_crc32_lsb (0, pbOut + cbOut, cbDst) != crc))
+      ERROR_RETURN (ERROR_CRCFAILURE, "inflated data CRC error");
+    cbOut += cbDst;
+
+    if (flags & regionInflateSpinner)
+      SPINNER_STEP;
+    report = cbOut>>step;
+    if ((flags & regionInflateSpinner) && step && report != report_last) {
+      printf ("\r   %d KiB\r", (int) (cbOut/1024));
+      report_last = report;
+    }
+  }
+
+	/* Anything after the end marker is only checksummed */
+  s->cb = 0;
+  while (s->cbIn)
+    FETCH (s->cbIn < sizeof (rgbLzo) ? s->cbIn : sizeof (rgbLzo));
+
+  dout->index += cbOut;
+
+  return cbOut;
+
+ truncated:
+  if (s->ck && region_checksum_bad_block (s->ck) >= 0)
+    ERROR_RETURN (ERROR_CRCFAILURE, "block CRC error");
+  ERROR_RETURN (ERROR_FAILURE, "truncated compressed data");
+}
+
+#endif
+
+
+struct inflate_source {
+  struct descriptor_d* din;
+  size_t cbIn;			/* Bytes not yet read from din */
+  size_t cbTransfer;
+  struct region_checksum_d* ck;
+  unsigned flags;
+  int step;
+  int report_last;
+  int result;			/* Error reading din */
+};
+
+
+/** inflate_fill is the input callback for the inflate engine.  It
+    reads the next piece of compressed data, adds it to the checksum,
+    and reports progress. */
+
+static int inflate_fill (struct inflate_d* inf)
+{
+  struct inflate_source* s = inf->context;
+  const void* pv;
+  ssize_t cb;
+
+  if (!s->cbIn)
+    return 0;
+  cb = read_mapped (s->din, &pv, rgbRegion, AVAILABLE (s->cbIn, s->cbTransfer));
+  if (cb <= 0) {
+    s->result = ERROR_IOFAILURE;
+    return 0;
+  }
+  if (s->ck && region_checksum_update (s->ck, pv, cb)) {
+    s->result = ERROR_CRCFAILURE;
+    return 0;
+  }
+  s->cbIn -= cb;
+  inf->next_in = pv;
+  inf->avail_in = cb;
+
+  if (s->flags & regionInflateSpinner) {
+    int report = inf->total_out>>s->step;
+    SPINNER_STEP;
+    if (s->step && report != s->report_last) {
+      printf ("\r   %d KiB\r", (int) (inf->total_out/1024));
+      s->report_last = report;
+    }
+  }
+
+  return cb;
+}
+
+
+/** region_inflate decompresses cbIn bytes of zlib, gzip, or lzop data
+    from din into the memory region dout.  Every byte read from the source,
+    including the gzip header and trailer, is added to the checksum
+    accumulator ck when it is non-NULL so that the caller can check
+    the CRC of the compressed stream.  When the destination length is
+    zero, it is extended to the end of the memory region that holds
+    its start address.  The return value is the number of bytes
+    written to the destination or an error code. */
+
+ssize_t region_inflate (struct descriptor_d* dout, struct descriptor_d* din,
+                        size_t cbIn, unsigned flags,
+                        struct region_checksum_d* ck)
+{
+  struct inflate_d inf;
+  struct inflate_source s;
+  int cbHeader;
+  int result;
+
+  if (strcmp (dout->driver_name, "memory"))
+    ERROR_RETURN (ERROR_UNSUPPORTED, "inflate destination must be memory");
+
+  if (dout->length == 0) {
+    int i;
+    for (i = 0; i < sizeof (memory_regions)/sizeof (*memory_regions); ++i)
+      if (memory_regions[i].length
+          && dout->start >= memory_regions[i].start
+          && dout->start - memory_regions[i].start
+             < memory_regions[i].length)
+        dout->length = memory_regions[i].start + memory_regions[i].length
+          - dout->start;
+    if (dout->length == 0)
+      ERROR_RETURN (ERROR_PARAM, "inflate destination is not in memory");
+  }
+
+  memset (&s, 0, sizeof (s));
+  s.din = din;
+  s.cbIn = cbIn;
+  s.cbTransfer = region_transfer_size (din, NULL);
+  s.ck = ck;
+  s.flags = flags;
+  s.step = DRIVER_PROGRESS (din, dout);
+  if (s.step)
+    s.step += 10;
+  s.report_last = -1;
+
+  inflate_init (&inf, (void*) (unsigned long) (dout->start + dout->index),
+                dout->length - dout->index);
+  inf.fill = inflate_fill;
+  inf.context = &s;
+
+  if (!inflate_fill (&inf))
+    goto input;
+
+#if defined (CONFIG_LZO)
+  if (inf.avail_in >= sizeof (lzop_magic)
+      && memcmp (inf.next_in, lzop_magic, sizeof (lzop_magic)) == 0) {
+    struct lzop_source ls = { din, s.cbIn, inf.next_in, inf.avail_in, ck };
+    return region_unlzo (dout, &ls, flags);
+  }
+#endif
+
+  cbHeader = gzip_header_length (inf.next_in, inf.avail_in);
+  if (cbHeader < 0)
+    ERROR_RETURN (cbHeader, "invalid gzip header");
+  if (cbHeader) {
+    inf.next_in += cbHeader;
+    inf.avail_in -= cbHeader;
+    result = inflate_gzip (&inf);
+  }
+  else if (is_zlib_header (inf.next_in, inf.avail_in))
+    result = inflate_zlib (&inf);
+  else
+    ERROR_RETURN (ERROR_UNSUPPORTED, "unrecognized compression");
+
+  if (s.result)
+    goto input;
+
+  switch (result) {
+  case INFLATE_OK:
+    break;
+  case INFLATE_E_OUTPUT:
+    ERROR_RETURN (ERROR_OUTOFMEMORY, "inflated data overruns memory");
+  case INFLATE_E_INPUT:
+    ERROR_RETURN (ERROR_FAILURE, "truncated compressed data");
+  case INFLATE_E_CHECK:
+    ERROR_RETURN (ERROR_CRCFAILURE, "inflated data CRC error");
+  default:
+    DBG (1, "inflate %d\n", result);
+    ERROR_RETURN (ERROR_FAILURE, "corrupt compressed data");
+  }
+
+	/* Trailing bytes, e.g. padding after the stream, are only checksummed */
+  while (s.cbIn)
+    if (!inflate_fill (&inf))
+      goto input;
+
+  dout->index += inf.total_out;
+
+  return inf.total_out;
+
+ input:
+  if (s.result == ERROR_CRCFAILURE)
+    ERROR_RETURN (s.result, "block CRC error");
+  ERROR_RETURN (ERROR_IOFAILURE, "premature end of input");
+}
+
+
+/** region_inflate_length returns the length of the data that
+    region_inflate will write for the cb bytes of compressed data at
+    pv.  The length is read from the gzip trailer or summed from the
+    lzop block headers.  A zlib stream doesn't record its length, so
+    the return value is ERROR_UNSUPPORTED. */
+
+ssize_t region_inflate_length (const void* pv, size_t cb)
+{
+  const unsigned char* pb = pv;
+
+#if defined (CONFIG_LZO)
+  if (cb >= sizeof (lzop_magic)
+      && memcmp (pb, lzop_magic, sizeof (lzop_magic)) == 0) {
+    struct lzop_source ls = { NULL, 0, pb, cb, NULL };
+    struct lzop_source* s = &ls;
+    size_t cbOut = 0;
+    long lzop_flags = lzop_header (s);
+
+    if (lzop_flags < 0)
+      return lzop_flags;
+    for (;;) {
+      size_t cbDst;
+      size_t cbSrc;
+
+      FETCH (4);
+      cbDst = be32 (pb);
+      if (cbDst == 0)
+        return cbOut;
+      FETCH (4);
+      cbSrc = be32 (pb);
+      FETCH (lzop_checks (lzop_flags, cbDst, cbSrc) + cbSrc);
+      cbOut += cbDst;
+    }
+
+  truncated:
+    ERROR_RETURN (ERROR_FAILURE, "truncated compressed data");
+  }
+#endif
+
+  if (gzip_header_length (pb, cb) > 0 && cb >= 18)
+    return pb[cb - 4] | (pb[cb - 3] << 8) | (pb[cb - 2] << 16)
+      | (pb[cb - 1] << 24);
+
+  return ERROR_UNSUPPORTED;
+}
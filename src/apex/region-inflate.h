@@ -0,0 +1,36 @@
+/* region-inflate.h
+
+   written by agent
+   16 Oct 2026
+
+   Copyright (C) 2026 agent
+
+   -----------
+   DESCRIPTION
+   -----------
+
+*/
+
+#if !defined (__REGION_INFLATE_H__)
+#    define   __REGION_INFLATE_H__
+
+/* ----- Includes */
+
+/* ----- Types */
+
+struct region_checksum_d;
+
+/* ----- Globals */
+
+/* ----- Prototypes */
+
+enum {
+  regionInflateSpinner	= (1<<0),
+};
+
+ssize_t region_inflate (struct descriptor_d* dout, struct descriptor_d* din,
+                        size_t cbIn, unsigned flags,
+                        struct region_checksum_d* ck);
+ssize_t region_inflate_length (const void* pv, size_t cb);
+
+#endif  /* __REGION_INFLATE_H__ */
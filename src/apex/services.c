@@ -25,6 +25,7 @@
 #include <command.h>
 #include <service.h>
 #include <debug_ll.h>
+#include <trace.h>
 
 void init_services (void)
 {
@@ -49,8 +50,10 @@ void init_services (void)
     PUTC_LL ('\r');
     PUTC_LL ('\n');
 
-    if (service->init)
+    if (service->init) {
+      TRACE (traceService, i, service->name);
       service->init ();
+    }
 
     PUTC_LL ('#');
     PUTC_LL ('\r');
@@ -0,0 +1,141 @@
+/* trace.c
+
+   written by agent
+   16 Oct 2026
+
+   Copyright (C) 2026 agent
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   version 2 as published by the Free Software Foundation.
+   Please refer to the file debian/copyright for further details.
+
+   -----------
+   DESCRIPTION
+   -----------
+
+   Boot phase trace ring.  Events are recorded for service
+   initialization, startup commands, descriptor opens, and image load
+   phases.  When the ring is full, the oldest events are overwritten.
+
+   NOTES
+   -----
+
+   o Times are recorded as raw timer ticks and converted to
+     milliseconds when they are shown.  The timebase is taken by a
+     service that follows the timer service.  Events recorded before
+     the timer is running, the first few service initializations,
+     report a time of zero.
+
+   o ATAG.  The ring is passed to the kernel as ATAG_APEX_TRACE.
+     The payload is a count followed by that many entries, oldest
+     first, with the time field converted to milliseconds.  Each
+     entry is a u32 time, a u16 type, a u16 argument, and a
+     CB_TRACE_LABEL byte label that is NUL padded, but not always NUL
+     terminated.  The type values are in include/trace.h.
+
+*/
+
+#include <config.h>
+#include <linux/types.h>
+#include <linux/string.h>
+#include <apex.h>
+#include <trace.h>
+#include <service.h>
+
+#if defined (CONFIG_ATAG)
+# include <atag.h>
+#endif
+
+#define C_TRACE		(CONFIG_BOOT_TRACE_ENTRIES)
+
+#define ATAG_APEX_TRACE	0x41504558	/* 'APEX' */
+
+static struct {
+  unsigned c;			/* Events recorded, ever */
+  unsigned cEarly;		/* Events recorded before the timebase */
+  int fTimebase;		/* Set once the timer is running */
+  unsigned long timebase;
+  struct trace_entry entry[C_TRACE];
+} trace;
+
+void trace_event (int type, int arg, const char* sz)
+{
+  struct trace_entry* entry = &trace.entry[trace.c++%C_TRACE];
+
+  entry->time = trace.fTimebase ? timer_read () : 0;
+  entry->type = type;
+  entry->arg  = arg;
+  memset (entry->sz, 0, sizeof (entry->sz));
+  if (sz)
+    strncpy (entry->sz, sz, sizeof (entry->sz));
+}
+
+
+/** trace_count returns the number of events held in the ring. */
+
+int trace_count (void)
+{
+  return trace.c < C_TRACE ? trace.c : C_TRACE;
+}
+
+
+/** trace_get returns the i'th event held in the ring, oldest
+    first, with the time converted to milliseconds since the timer
+    started. */
+
+void trace_get (int i, struct trace_entry* entry)
+{
+  unsigned first = trace.c < C_TRACE ? 0 : trace.c - C_TRACE;
+
+  *entry = trace.entry[(first + i)%C_TRACE];
+  entry->time = (first + i < trace.cEarly)
+    ? 0 : timer_delta (trace.timebase, entry->time);
+}
+
+
+/* trace_timebase
+
+   starts the clock for the trace.  The service follows the timer
+   service so that timer_read() returns meaningful values.
+
+*/
+
+static void trace_timebase (void)
+{
+  trace.timebase = timer_read ();
+  trace.cEarly = trace.c;
+  trace.fTimebase = 1;
+}
+
+static __service_3 struct service_d trace_service = {
+  .init = trace_timebase,
+};
+
+
+#if defined (CONFIG_ATAG)
+
+struct tag* atag_apex_trace (struct tag* p)
+{
+  int c = trace_count ();
+  int i;
+  u32* pl = (u32*) &p->u;
+  struct trace_entry* entry = (struct trace_entry*) (pl + 1);
+
+  p->hdr.tag = ATAG_APEX_TRACE;
+  p->hdr.size = (sizeof (struct tag_header) + sizeof (u32)
+		 + c*sizeof (struct trace_entry))/4;
+  *pl = c;
+  for (i = 0; i < c; ++i)
+    trace_get (i, entry++);
+
+# if !defined (CONFIG_SMALL)
+  printf ("ATAG_APEX_TRACE: %d events\n", c);
+# endif
+
+  return tag_next (p);
+}
+
+static __atag_6 struct atag_d _atag_apex_trace = { atag_apex_trace };
+
+#endif
@@ -0,0 +1,295 @@
+/* block-cache.c
+
+   written by agent
+   16 Oct 2026
+
+   Copyright (C) 2026 agent
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   version 2 as published by the Free Software Foundation.
+   Please refer to the file debian/copyright for further details.
+
+   -----------
+   DESCRIPTION
+   -----------
+
+   Set associative block cache shared by the filesystem drivers.  The
+   ext2, FAT, and JFFS2 drivers reread the same superblock, FAT,
+   inode, and directory sectors many times while resolving a path.
+   Routing those reads through this cache means that the block device
+   sees each sector once.
+
+   NOTES
+   -----
+
+   o Blocks are keyed by the driver and the block number within the
+     driver's address space, d->start + d->index.  Descriptors opened
+     on different partitions of the same device share the cache.
+
+   o Each set holds CACHE_WAYS blocks and is replaced least recently
+     used first.  The age stamp is a simple counter.
+
+   o Drivers that can map their regions, NOR flash and memory, are
+     not cached since reading them is as fast as reading the cache.
+
+   o There are no writes through the cache.  Drivers drop the blocks
+     for a device whenever the device is reidentified.  When the
+     service initializes, it interposes wrappers on the write, erase
+     and write_start methods of the drivers that can be cached so that
+     any change to a device drops its blocks.
+
+   o Only metadata should be read through the cache.  Bulk file data
+     would evict everything else and is read directly.
+
+*/
+
+#include <config.h>
+#include <apex.h>
+#include <linux/string.h>
+#include <driver.h>
+#include <service.h>
+#include <block-cache.h>
+
+#define CB_BLOCK	(512)
+#define CACHE_WAYS	(4)
+#define C_BLOCKS	(CONFIG_DRIVER_BLOCK_CACHE_BLOCKS)
+#define C_SETS		(C_BLOCKS/CACHE_WAYS)
+#define C_DRIVERS_MAX	(64)
+
+struct block_cache_entry {
+  const struct driver_d* driver; /* NULL when the entry is empty */
+  unsigned long block;
+  unsigned long age;		/* Stamp of most recent use */
+  unsigned short cb;		/* Valid bytes, short at end of device */
+};
+
+static struct {
+  struct block_cache_entry entry[C_SETS*CACHE_WAYS];
+  unsigned long age;
+  unsigned long hits;
+  unsigned long misses;
+} block_cache;
+
+static char __xbss(block_cache) __aligned
+  rgbBlockCache[C_SETS*CACHE_WAYS][CB_BLOCK];
+
+struct block_cache_methods {
+  ssize_t	(*write) (struct descriptor_d*, const void* pv, size_t cb);
+  void		(*erase) (struct descriptor_d*, size_t cb);
+  ssize_t	(*write_start) (struct descriptor_d*, const void* pv, size_t cb);
+};
+
+extern char APEX_DRIVER_START[];
+extern char APEX_DRIVER_END[];
+
+static struct block_cache_methods methods[C_DRIVERS_MAX];
+
+static inline struct block_cache_methods* methods_of (struct driver_d* driver)
+{
+  return &methods[driver - (struct driver_d*) APEX_DRIVER_START];
+}
+
+static inline int block_cache_set (const struct driver_d* driver,
+				   unsigned long block)
+{
+  return (block ^ ((unsigned long) driver >> 4)) % C_SETS;
+}
+
+
+/* block_cache_lookup
+
+   returns the index of the cache entry holding at least the first
+   cbNeeded bytes of the block, filling it from the descriptor when
+   it isn't present.  A block read short at the end of one descriptor
+   serves any read that it covers and is reread when a descriptor
+   needs more of it.  The return value is negative when the block
+   cannot be read.
+
+*/
+
+static int block_cache_lookup (struct descriptor_d* d, unsigned long block,
+			       size_t cbNeeded)
+{
+  int set = block_cache_set (d->driver, block);
+  int i = set*CACHE_WAYS;
+  int iVictim = i;
+  int iEnd = i + CACHE_WAYS;
+  struct block_cache_entry* entry;
+  size_t index;
+  ssize_t cb;
+
+  for (; i < iEnd; ++i) {
+    entry = &block_cache.entry[i];
+    if (entry->driver == d->driver && entry->block == block) {
+      if (entry->cb >= cbNeeded) {
+	++block_cache.hits;
+	entry->age = ++block_cache.age;
+	return i;
+      }
+      iVictim = i;		/* Reread the short block in place */
+      break;
+    }
+    if (!entry->driver
+	|| (block_cache.entry[iVictim].driver
+	    && entry->age < block_cache.entry[iVictim].age))
+      iVictim = i;
+  }
+
+  ++block_cache.misses;
+  entry = &block_cache.entry[iVictim];
+  entry->driver = NULL;
+
+  index = d->index;
+  d->index = block*CB_BLOCK - d->start;
+  cb = d->driver->read (d, rgbBlockCache[iVictim], CB_BLOCK);
+  d->index = index;
+  if (cb <= 0)
+    return -1;
+
+  entry->driver = d->driver;
+  entry->block  = block;
+  entry->cb     = cb;
+  entry->age    = ++block_cache.age;
+  return iVictim;
+}
+
+
+/* block_cache_read
+
+   reads from the descriptor through the cache.  The semantics match
+   the driver's read() method.  Reads that begin before the first
+   whole block of the descriptor are passed to the driver.
+
+*/
+
+ssize_t block_cache_read (struct descriptor_d* d, void* pv, size_t cb)
+{
+  ssize_t cbRead = 0;
+
+  if (driver_can_map (d->driver))
+    return d->driver->read (d, pv, cb);
+
+  if (d->index + cb > d->length)
+    cb = d->length - d->index;
+
+  while (cb) {
+    unsigned long ib = d->start + d->index;
+    unsigned long block = ib/CB_BLOCK;
+    size_t offset = ib%CB_BLOCK;
+    size_t available;
+    int i;
+
+    if (block*CB_BLOCK < d->start) {
+      available = CB_BLOCK - offset;
+      if (available > cb)
+	available = cb;
+      if (d->driver->read (d, pv, available) != available)
+	break;
+    }
+    else {
+      available = CB_BLOCK - offset;
+      if (available > cb)
+	available = cb;
+      if ((i = block_cache_lookup (d, block, offset + available)) < 0
+	  || block_cache.entry[i].cb <= offset)
+	break;
+      if (available > block_cache.entry[i].cb - offset)
+	available = block_cache.entry[i].cb - offset;
+      memcpy (pv, rgbBlockCache[i] + offset, available);
+      d->index += available;
+    }
+    pv += available;
+    cb -= available;
+    cbRead += available;
+  }
+
+  return cbRead;
+}
+
+
+/* block_cache_invalidate
+
+   drops every cached block that belongs to the driver.
+
+*/
+
+void block_cache_invalidate (const struct driver_d* driver)
+{
+  int i;
+  for (i = 0; i < C_SETS*CACHE_WAYS; ++i)
+    if (block_cache.entry[i].driver == driver)
+      block_cache.entry[i].driver = NULL;
+}
+
+
+static ssize_t block_cache_write (struct descriptor_d* d,
+				  const void* pv, size_t cb)
+{
+  block_cache_invalidate (d->driver);
+  return methods_of (d->driver)->write (d, pv, cb);
+}
+
+static ssize_t block_cache_write_start (struct descriptor_d* d,
+					const void* pv, size_t cb)
+{
+  block_cache_invalidate (d->driver);
+  return methods_of (d->driver)->write_start (d, pv, cb);
+}
+
+static void block_cache_erase (struct descriptor_d* d, size_t cb)
+{
+  block_cache_invalidate (d->driver);
+  methods_of (d->driver)->erase (d, cb);
+}
+
+
+/* block_cache_init
+
+   interposes the invalidating wrappers on the drivers whose blocks
+   may be cached.  Drivers that can map are read directly and need no
+   wrappers.
+
+*/
+
+static void block_cache_init (void)
+{
+  struct driver_d* driver;
+
+  for (driver = (struct driver_d*) APEX_DRIVER_START;
+       driver < (struct driver_d*) APEX_DRIVER_END
+	 && driver - (struct driver_d*) APEX_DRIVER_START < C_DRIVERS_MAX;
+       ++driver) {
+    struct block_cache_methods* m = methods_of (driver);
+
+    if (driver_can_map (driver)
+	|| (driver->flags & (DRIVER_CONSOLE | DRIVER_SERIAL)))
+      continue;
+
+    if ((m->write = driver->write))
+      driver->write = block_cache_write;
+    if ((m->erase = driver->erase))
+      driver->erase = block_cache_erase;
+    if ((m->write_start = driver->write_start))
+      driver->write_start = block_cache_write_start;
+  }
+}
+
+
+#if !defined (CONFIG_SMALL)
+static void block_cache_report (void)
+{
+  printf ("  bcache:  %d blocks of %d bytes, %d way  hits %lu  misses %lu\n",
+	  C_SETS*CACHE_WAYS, CB_BLOCK, CACHE_WAYS,
+	  block_cache.hits, block_cache.misses);
+}
+#endif
+
+static __service_6 struct service_d block_cache_service = {
+  .init        = block_cache_init,
+#if !defined (CONFIG_SMALL)
+  .name        = "block-cache",
+  .description = "Shared filesystem block cache",
+  .report      = block_cache_report,
+#endif
+};
@@ -0,0 +1,288 @@
+/* driver-stats.c
+
+   written by agent
+   16 Oct 2026
+
+   Copyright (C) 2026 agent
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   version 2 as published by the Free Software Foundation.
+   Please refer to the file debian/copyright for further details.
+
+   -----------
+   DESCRIPTION
+   -----------
+
+   Per-driver I/O counters.  When the service initializes, it
+   interposes counting wrappers on the read, write, seek, erase, map
+   and write_start methods of every driver.  The wrappers count calls
+   and bytes and accumulate the time spent in the driver.  The
+   drvinfo command shows and resets the counters.
+
+   NOTES
+   -----
+
+   o Console and serial drivers are not instrumented.  Their counts
+     would mostly reflect the output of the report.
+
+   o Time is accumulated in raw timer ticks with timer_delta_ticks(),
+     which knows the direction in which the timer counts, so that
+     calls shorter than a millisecond are charged.  The report
+     converts ticks to milliseconds and throughput using the timer
+     rate, found from timer_delta().  Layered drivers, e.g. ext2 on
+     MMC, count the time of the lower layer in both.
+
+   o Mapped reads are counted as reads.  Overlapped writes are
+     counted when they are started, so the program time that overlaps
+     the next read isn't charged to the writer.
+
+*/
+
+#include <config.h>
+#include <apex.h>
+#include <linux/string.h>
+#include <driver.h>
+#include <service.h>
+#include <asm/div64.h>
+
+#define C_DRIVERS_MAX	(64)
+
+struct driver_stats_d {
+  ssize_t	(*read)  (struct descriptor_d*, void* pv, size_t cb);
+  ssize_t	(*write) (struct descriptor_d*, const void* pv, size_t cb);
+  void		(*erase) (struct descriptor_d*, size_t cb);
+  driver_off_t	(*seek)  (struct descriptor_d*, driver_off_t cb, int whence);
+  ssize_t	(*map)   (struct descriptor_d*, const void** ppv, size_t cb);
+  ssize_t	(*write_start) (struct descriptor_d*, const void* pv, size_t cb);
+
+  unsigned long cReads;
+  unsigned long cWrites;
+  unsigned long cSeeks;
+  unsigned long cErases;
+  unsigned long cbRead;
+  unsigned long cbWritten;
+  unsigned long long ticks;
+};
+
+extern char APEX_DRIVER_START[];
+extern char APEX_DRIVER_END[];
+
+static struct driver_stats_d driver_stats[C_DRIVERS_MAX];
+
+static inline struct driver_stats_d* stats_of (struct descriptor_d* d)
+{
+  return &driver_stats[d->driver - (struct driver_d*) APEX_DRIVER_START];
+}
+
+static ssize_t stats_read (struct descriptor_d* d, void* pv, size_t cb)
+{
+  struct driver_stats_d* s = stats_of (d);
+  unsigned long time = timer_read ();
+  ssize_t result = s->read (d, pv, cb);
+  s->ticks += timer_delta_ticks (time, timer_read ());
+  ++s->cReads;
+  if (result > 0)
+    s->cbRead += result;
+  return result;
+}
+
+static ssize_t stats_write (struct descriptor_d* d, const void* pv, size_t cb)
+{
+  struct driver_stats_d* s = stats_of (d);
+  unsigned long time = timer_read ();
+  ssize_t result = s->write (d, pv, cb);
+  s->ticks += timer_delta_ticks (time, timer_read ());
+  ++s->cWrites;
+  if (result > 0)
+    s->cbWritten += result;
+  return result;
+}
+
+static ssize_t stats_write_start (struct descriptor_d* d,
+				  const void* pv, size_t cb)
+{
+  struct driver_stats_d* s = stats_of (d);
+  unsigned long time = timer_read ();
+  ssize_t result = s->write_start (d, pv, cb);
+  s->ticks += timer_delta_ticks (time, timer_read ());
+  ++s->cWrites;
+  if (result > 0)
+    s->cbWritten += result;
+  return result;
+}
+
+static ssize_t stats_map (struct descriptor_d* d, const void** ppv, size_t cb)
+{
+  struct driver_stats_d* s = stats_of (d);
+  unsigned long time = timer_read ();
+  ssize_t result = s->map (d, ppv, cb);
+  s->ticks += timer_delta_ticks (time, timer_read ());
+  if (result >= 0) {		/* Refused maps fall back to read () */
+    ++s->cReads;
+    s->cbRead += result;
+  }
+  return result;
+}
+
+static void stats_erase (struct descriptor_d* d, size_t cb)
+{
+  struct driver_stats_d* s = stats_of (d);
+  unsigned long time = timer_read ();
+  s->erase (d, cb);
+  s->ticks += timer_delta_ticks (time, timer_read ());
+  ++s->cErases;
+}
+
+static driver_off_t stats_seek (struct descriptor_d* d,
+				driver_off_t offset, int whence)
+{
+  struct driver_stats_d* s = stats_of (d);
+  ++s->cSeeks;
+  return s->seek (d, offset, whence);
+}
+
+
+/** driver_stats_reset clears the counters for all drivers. */
+
+void driver_stats_reset (void)
+{
+  int i;
+  for (i = 0; i < C_DRIVERS_MAX; ++i) {
+    struct driver_stats_d* s = &driver_stats[i];
+    s->cReads = s->cWrites = s->cSeeks = s->cErases = 0;
+    s->cbRead = s->cbWritten = 0;
+    s->ticks = 0;
+  }
+}
+
+
+/* timer_ms
+
+   returns the milliseconds in ticks timer ticks.  timer_delta()
+   takes a pair of timer readings, so the pair is ordered to match
+   the direction of the timer.
+
+*/
+
+static unsigned long timer_ms (unsigned long ticks)
+{
+  return timer_delta_ticks (0, 1) == 1
+    ? timer_delta (0, ticks) : timer_delta (ticks, 0);
+}
+
+
+/* timer_rate
+
+   returns the number of timer ticks in a second.  The search doubles
+   before it bisects so that timers whose timer_delta() scales up
+   aren't given intervals long enough to overflow.
+
+*/
+
+static unsigned long timer_rate (void)
+{
+  static unsigned long rate;
+  unsigned long min;
+
+  if (rate)
+    return rate;
+
+  for (rate = 1; rate < (1UL << 31) && timer_ms (rate) < 1000; rate <<= 1)
+    ;
+  for (min = rate/2; min + 1 < rate; ) {
+    unsigned long mid = min + (rate - min)/2;
+    if (timer_ms (mid) < 1000)
+      min = mid;
+    else
+      rate = mid;
+  }
+  return rate;
+}
+
+
+/** driver_stats_report shows the counters of every driver that has
+    been used since the last reset. */
+
+void driver_stats_report (void)
+{
+  struct driver_d* driver;
+  int fHeader = 0;
+
+  for (driver = (struct driver_d*) APEX_DRIVER_START;
+       driver < (struct driver_d*) APEX_DRIVER_END
+	 && driver - (struct driver_d*) APEX_DRIVER_START < C_DRIVERS_MAX;
+       ++driver) {
+    struct driver_stats_d* s
+      = &driver_stats[driver - (struct driver_d*) APEX_DRIVER_START];
+    unsigned long cb = s->cbRead + s->cbWritten;
+    unsigned long long ticks = s->ticks;
+    unsigned long long ms;
+    unsigned long long rate;
+
+    if (!driver->name
+	|| !(s->cReads || s->cWrites || s->cSeeks || s->cErases))
+      continue;
+
+    ms = ticks*1000;
+    do_div (ms, timer_rate ());
+
+	/* Bytes per second, with the divisor narrowed to 32 bits */
+    rate = (unsigned long long) cb*timer_rate ();
+    for (; ticks >> 32; ticks >>= 1)
+      rate >>= 1;
+    if (ticks)
+      do_div (rate, (unsigned long) ticks);
+
+    if (!fHeader) {
+      printf ("   %-12.12s %7s %8s %7s %8s %6s %6s %7s %7s\n",
+	      "driver", "reads", "KiB", "writes", "KiB",
+	      "seeks", "erases", "ms", "KiB/s");
+      fHeader = 1;
+    }
+    printf ("   %-12.12s %7lu %8lu %7lu %8lu %6lu %6lu %7lu ",
+	    driver->name, s->cReads, s->cbRead/1024,
+	    s->cWrites, s->cbWritten/1024, s->cSeeks, s->cErases,
+	    (unsigned long) ms);
+    if (ticks)
+      printf ("%7lu\n", (unsigned long) (rate >> 10));
+    else
+      printf ("%7s\n", "-");
+  }
+  if (!fHeader)
+    printf ("   no driver I/O recorded\n");
+}
+
+
+static void driver_stats_init (void)
+{
+  struct driver_d* driver;
+
+  for (driver = (struct driver_d*) APEX_DRIVER_START;
+       driver < (struct driver_d*) APEX_DRIVER_END
+	 && driver - (struct driver_d*) APEX_DRIVER_START < C_DRIVERS_MAX;
+       ++driver) {
+    struct driver_stats_d* s
+      = &driver_stats[driver - (struct driver_d*) APEX_DRIVER_START];
+
+    if (driver->flags & (DRIVER_CONSOLE | DRIVER_SERIAL))
+      continue;
+
+    if ((s->read = driver->read))
+      driver->read = stats_read;
+    if ((s->write = driver->write))
+      driver->write = stats_write;
+    if ((s->erase = driver->erase))
+      driver->erase = stats_erase;
+    if ((s->seek = driver->seek))
+      driver->seek = stats_seek;
+    if ((s->map = driver->map))
+      driver->map = stats_map;
+    if ((s->write_start = driver->write_start))
+      driver->write_start = stats_write_start;
+  }
+}
+
+static __service_5 struct service_d driver_stats_service = {
+  .init = driver_stats_init,
+};
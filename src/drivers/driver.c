@@ -30,6 +30,7 @@
 #include <error.h>
 #include <apex.h>
 #include <config.h>
+#include <trace.h>
 #include <talk.h>
 
 #define TOLOWER(c)
@@ -58,16 +59,34 @@ void close_descriptor (struct descriptor_d* d)
 
 int is_descriptor_open (struct descriptor_d* d)
 {
-  return d->driver && d->length;
+  return d && d->driver && d->length;
 }
 
 int open_descriptor (struct descriptor_d* d)
 {
   if (!d->driver || !d->driver->open)
     return ERROR_UNSUPPORTED;
+  TRACE (traceOpen, 0, d->driver->name);
   return d->driver->open (d);
 }
 
+/** read_mapped reads up to cb bytes from the descriptor.  When the
+    driver can map the region, *ppv points to the data in place and
+    pv is untouched.  Otherwise, the data is read into pv and *ppv
+    points there.  Callers must not modify the data through *ppv. */
+
+ssize_t read_mapped (struct descriptor_d* d, const void** ppv,
+                     void* pv, size_t cb)
+{
+  if (d->driver->map) {
+    ssize_t result = d->driver->map (d, ppv, cb);
+    if (result >= 0)
+      return result;
+  }
+  *ppv = pv;
+  return d->driver->read (d, pv, cb);
+}
+
 static int find_driver (struct descriptor_d* d)
 {
   size_t cb = strlen (d->driver_name);
@@ -125,6 +125,7 @@
 #include <spinner.h>
 #include <asm/reg.h>
 #include <error.h>
+#include <block-cache.h>
 #include <command.h>
 
 #include <mach/drv-ata.h>
@@ -295,6 +296,7 @@ struct ata_info {
 };
 
 static struct ata_info ata_d;
+static struct driver_d ata_driver;
 u8 drive_select;
 
 static inline void clear_info (void)
@@ -302,6 +304,7 @@ static inline void clear_info (void)
   memset (&ata_d, 0, sizeof (ata_d));
   ata_d.sector = -1;
   ata_d.speed  = -1;
+  block_cache_invalidate (&ata_driver);
 }
 
 static uint8_t read8 (int reg)
@@ -75,6 +75,7 @@
 #include <spinner.h>
 #include <asm/reg.h>
 #include <error.h>
+#include <block-cache.h>
 
 #include <mach/drv-cf.h>
 
@@ -174,6 +175,7 @@ struct cf_info {
 };
 
 static struct cf_info cf_d;
+static struct driver_d cf_driver;
 u8 drive_select;
 
 static unsigned char read8 (int reg)
@@ -414,6 +416,7 @@ static int cf_identify (void)
   }
 
   cf_d.sector = -1;
+  block_cache_invalidate (&cf_driver);
 
   return 0;
 }
@@ -100,6 +100,7 @@
 #include <config.h>
 #include <apex.h>
 #include <driver.h>
+#include <block-cache.h>
 #include <service.h>
 #include <linux/string.h>
 #include <linux/ctype.h>
@@ -147,8 +148,8 @@ struct partition {
   unsigned char begin_chs[3];
   unsigned char type;
   unsigned char end_chs[3];
-  unsigned long start;
-  unsigned long length;
+  __u32 start;
+  __u32 length;
 };
 
 struct superblock {
@@ -358,7 +359,7 @@ static inline const char* block_driver (void)
 
 static void clear_ok_by_crc (void)
 {
-  extern unsigned long compute_crc32 (unsigned long, const void*, size_t);
+  extern uint32_t compute_crc32 (uint32_t, const void*, int);
   const char* sz = block_driver ();
   u32 crc = compute_crc32 (0, sz, strlen (sz));
   if (ext2.region_crc != crc)
@@ -387,7 +388,7 @@ inline int group_from_inode (struct ext2_info* ext2, int inode)
 
 static inline unsigned long read_block_number (int i)
 {
-  char* pb = &ext2.rgbCache[i*sizeof (long)];
+  unsigned char* pb = (unsigned char*) &ext2.rgbCache[i*sizeof (__u32)];
   return  ((unsigned long) pb[0])
        + (((unsigned long) pb[1]) <<  8)
        + (((unsigned long) pb[2]) << 16)
@@ -412,7 +413,7 @@ static int ext2_block_read (int block, void* pv, size_t cb)
 {
   PRINTF ("%s: %d\n", __FUNCTION__, block);
   ext2.d.driver->seek (&ext2.d, ext2.block_size*block, SEEK_SET);
-  return ext2.d.driver->read (&ext2.d, pv, cb) != cb;
+  return block_cache_read (&ext2.d, pv, cb) != cb;
 }
 
 static int ext2_read_superblock (void)
@@ -423,8 +424,8 @@ static int ext2_read_superblock (void)
 	/* Superblock is 1KiB long, 1KiB from the start of the filesystem */
   ext2.d.driver->seek (&ext2.d, 1024, SEEK_SET);
 
-  if (ext2.d.driver->read (&ext2.d, &ext2.superblock,
-			   sizeof (ext2.superblock))
+  if (block_cache_read (&ext2.d, &ext2.superblock,
+			sizeof (ext2.superblock))
       != sizeof (ext2.superblock)
       || ext2.superblock.s_magic != MAGIC_EXT2)
     return -1;
@@ -434,8 +435,8 @@ static int ext2_read_superblock (void)
   ext2.first_data_block = (1 + ext2.superblock.s_first_data_block)
     *ext2.block_size;
   ext2.rg_blocking[0] = 12;
-  ext2.rg_blocking[1] = ext2.block_size/sizeof (long);
-  ext2.rg_blocking[2] = ext2.rg_blocking[1]*(ext2.block_size/sizeof (long));
+  ext2.rg_blocking[1] = ext2.block_size/sizeof (__u32);
+  ext2.rg_blocking[2] = ext2.rg_blocking[1]*(ext2.block_size/sizeof (__u32));
 
 	/* Make sure the inode_size field is useable */
   if (ext2.superblock.s_rev_level == EXT2_GOOD_OLD_REV)
@@ -476,7 +477,7 @@ static int ext2_update_block_cache (int block_index)
     ext2.blockCache = 0;
     ext2.cCache = ext2.rg_blocking[0];
     memcpy (ext2.rgbCache, &ext2.inode.i_block[0],
-	    ext2.rg_blocking[0]*sizeof (long));
+	    ext2.rg_blocking[0]*sizeof (__u32));
     return 0;
   }
 
@@ -565,7 +566,7 @@ int ext2_find_inode (int inode)
 		       + (sizeof (struct block_group)
 			  *((inode - 1)/ext2.superblock.s_inodes_per_group)),
 		       SEEK_SET);
-  if (ext2.d.driver->read (&ext2.d, &group, sizeof (group))
+  if (block_cache_read (&ext2.d, &group, sizeof (group))
       != sizeof (struct block_group))
     return 1;
 
@@ -579,7 +580,7 @@ int ext2_find_inode (int inode)
 //	  __FUNCTION__, inode,
 //	  ext2.block_size, group.bg_inode_table,
 //	  ext2.d.index, ext2.d.length);
-  if (ext2.d.driver->read (&ext2.d, &ext2.inode, sizeof (struct inode))
+  if (block_cache_read (&ext2.d, &ext2.inode, sizeof (struct inode))
       != sizeof (struct inode))
     return 1;
 
@@ -864,7 +865,7 @@ static int ext2_open (struct descriptor_d* d)
       flush_cache ();
     }
 
-    snprintf (sz, sizeof (sz), "%s%%@%lds+%lds",
+    snprintf (sz, sizeof (sz), "%s%%@%us+%us",
 	      block_driver (),
 	      ext2.partition[partition].start,
 	      ext2.partition[partition].length);
@@ -1052,7 +1053,7 @@ static int ext2_info (struct descriptor_d* d)
       flush_cache ();
     }
 
-    snprintf (sz, sizeof (sz), "%s%%@%lds+%lds",
+    snprintf (sz, sizeof (sz), "%s%%@%us+%us",
 	      block_driver (),
 	      ext2.partition[partition].start,
 	      ext2.partition[partition].length);
@@ -1135,7 +1136,7 @@ static void ext2_report (void)
     if (ext2.partition[i].type || i == 0) {
       if (i != 0)
 	printf ("       ");
-      printf ("   partition %d: %c %02x 0x%08lx 0x%08lx%s",
+      printf ("   partition %d: %c %02x 0x%08x 0x%08x%s",
               i + 1,
 	      ext2.partition[i].boot ? '*' : ' ',
 	      ext2.partition[i].type,
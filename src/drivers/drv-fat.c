@@ -98,6 +98,7 @@
 #include <config.h>
 #include <apex.h>
 #include <driver.h>
+#include <block-cache.h>
 #include <service.h>
 #include <linux/string.h>
 #include <linux/ctype.h>
@@ -132,8 +133,8 @@ struct partition {
   unsigned char begin_chs[3];
   unsigned char type;
   unsigned char end_chs[3];
-  unsigned long start;
-  unsigned long length;
+  u32 start;
+  u32 length;
 };
 
 struct parameter {
@@ -149,12 +150,12 @@ struct parameter {
   unsigned short sectors_per_fat;
   unsigned short sectors_per_track;
   unsigned short heads;
-  unsigned long hidden_sectors;
-  unsigned long large_sectors;
+  u32 hidden_sectors;
+  u32 large_sectors;
   unsigned char logical_drive;
   unsigned char reserved;
   unsigned char signature;	/* Must be 0x29 */
-  unsigned long serial;
+  u32 serial;
   unsigned char volume[11];
   unsigned char type[8];
   char dummy[2];
@@ -170,7 +171,7 @@ struct directory {
   unsigned short time;
   unsigned short date;
   unsigned short cluster;
-  unsigned long length;
+  u32 length;
 } __attribute__ ((packed));
 
 struct fat_info {
@@ -231,7 +232,7 @@ static const char* block_driver (void)
 
 static void clear_ok_by_crc (void)
 {
-  extern unsigned long compute_crc32 (unsigned long, const void*, size_t);
+  extern uint32_t compute_crc32 (uint32_t, const void*, int);
   const char* sz = block_driver ();
   u32 crc = compute_crc32 (0, sz, strlen (sz));
   if (fat.region_crc != crc)
@@ -317,7 +318,7 @@ static unsigned fat_next_cluster (unsigned cluster)
   if (sector != fat.sector_fat) {
     size_t index = fat.d.index;	/* *** FIXME: This is a cheat */
     fat.d.driver->seek (&fat.d, SECTOR_SIZE*sector, SEEK_SET);
-    fat.d.driver->read (&fat.d, &fat.fat, SECTOR_SIZE*3);
+    block_cache_read (&fat.d, &fat.fat, SECTOR_SIZE*3);
     fat.sector_fat = sector;
     fat.d.index = index;	/* *** FIXME: This is a cheat */
   }
@@ -366,7 +367,7 @@ static int fat_find (struct descriptor_d* d)
   for (i = 0; i < fat.parameter.root_entries; ++i) {
     char sz[12];
     int cb;
-    int cbRead = fat.d.driver->read (&fat.d, &fat.file, sizeof (fat.file));
+    int cbRead = block_cache_read (&fat.d, &fat.file, sizeof (fat.file));
     if (cbRead != sizeof (fat.file))
       break;
     if (fat.file.attribute == 0xf) {	/* vfat entry */
@@ -440,7 +441,7 @@ static int fat_open (struct descriptor_d* d)
     if (partition < 0 || partition > 3 || fat.partition[partition].length == 0)
       ERROR_RETURN (ERROR_BADPARTITION, "invalid partition");
 
-    snprintf (sz, sizeof (sz), "%s%%@%lds+%lds",
+    snprintf (sz, sizeof (sz), "%s%%@%us+%us",
 	      block_driver (),
 	      fat.partition[partition].start, fat.partition[partition].length);
   }
@@ -454,7 +455,7 @@ static int fat_open (struct descriptor_d* d)
 
 	/* Read parameter block */
   fat.d.driver->seek (&fat.d, 0, SEEK_SET);
-  fat.d.driver->read (&fat.d, &fat.parameter, sizeof (struct parameter));
+  block_cache_read (&fat.d, &fat.parameter, sizeof (struct parameter));
   fat.index_cluster_2
     = (fat.parameter.reserved_sectors
        + fat.parameter.fats*fat.parameter.sectors_per_fat)
@@ -603,7 +604,7 @@ static int fat_info (struct descriptor_d* d)
     if (partition < 0 || partition > 3 || fat.partition[partition].length == 0)
       ERROR_RETURN (ERROR_BADPARTITION, "invalid partition");
 
-    snprintf (sz, sizeof (sz), "%s%%@%lds+%lds",
+    snprintf (sz, sizeof (sz), "%s%%@%us+%us",
 	      block_driver (),
 	      fat.partition[partition].start, fat.partition[partition].length);
   }
@@ -617,7 +618,7 @@ static int fat_info (struct descriptor_d* d)
 
 	/* Read parameter block */
   fat.d.driver->seek (&fat.d, 0, SEEK_SET);
-  fat.d.driver->read (&fat.d, &fat.parameter, sizeof (struct parameter));
+  block_cache_read (&fat.d, &fat.parameter, sizeof (struct parameter));
   fat.index_cluster_2
     = (fat.parameter.reserved_sectors
        + fat.parameter.fats*fat.parameter.sectors_per_fat)
@@ -675,7 +676,7 @@ static void fat_report (void)
     if (fat.partition[i].type || i == 0) {
       if (i != 0)
 	printf ("      ");
-      printf ("    partition %d: %c %02x 0x%08lx 0x%08lx\n",
+      printf ("    partition %d: %c %02x 0x%08x 0x%08x\n",
               i + 1,
 	      fat.partition[i].boot ? '*' : ' ',
 	      fat.partition[i].type,
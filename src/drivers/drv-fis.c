@@ -150,14 +150,14 @@
 
 struct fis_descriptor {
   char name[16];		/* Image name, null terminated */
-  unsigned long start;		/* Physical memory address of image */
-  unsigned long lma;		/* Load Memory Address for image */
-  unsigned long length;		/* Byte length of partition */
-  unsigned long entry;		/* Image entry point */
-  unsigned long data_length;	/* Byte length of image */
-  unsigned char _pad[256 - 16 - 7*sizeof(unsigned long)];
-  unsigned long cksum_desc;	/* Checksum over descriptor */
-  unsigned long cksum_image;	/* Checksum over image data */
+  u32 start;			/* Physical memory address of image */
+  u32 lma;			/* Load Memory Address for image */
+  u32 length;			/* Byte length of partition */
+  u32 entry;			/* Image entry point */
+  u32 data_length;		/* Byte length of image */
+  unsigned char _pad[256 - 16 - 7*sizeof(u32)];
+  u32 cksum_desc;		/* Checksum over descriptor */
+  u32 cksum_image;		/* Checksum over image data */
 };
 
 static int fis_directory_swap;	/* Set for a byte swapped directory */
@@ -165,8 +165,8 @@ static int fis_directory_entries; /* Computed from the size of the partition */
 
 struct fis_skip_descriptor {
   char magic[4];		/* 's' 'k' 'i' 'p' */
-  unsigned long offset;		/* Offset from partition start */
-  unsigned long length;		/* Size of skip in bytes */
+  u32 offset;			/* Offset from partition start */
+  u32 length;			/* Size of skip in bytes */
 };
 
 static struct fis_skip_descriptor rgskip[4];
@@ -190,7 +190,7 @@ static inline unsigned long swab32(unsigned long l)
 
 static inline const char* block_driver (void)
 {
-  return lookup_alias_or_env ("fis-drv", CONFIG_DRIVER_FIS_BLOCKDEVICE);
+  return lookup_variable_or_env ("fis-drv", CONFIG_DRIVER_FIS_BLOCKDEVICE);
 }
 
 static inline int deleted_entry (struct fis_descriptor* partition)
@@ -281,7 +281,7 @@ static const char* map_region (struct descriptor_d* d,
   unsigned long start = 0;
   descriptor_query (d, QUERY_START, &start);
 
-  snprintf (sz, sizeof (sz), "%s:0x%08lx+0x%08lx",
+  snprintf (sz, sizeof (sz), "%s:0x%08lx+0x%08x",
 	    d->driver_name,
 	    partition->start - start, partition->length);
   return sz;
@@ -525,7 +525,7 @@ static void fis_report (void)
 	skip.offset = swab32 (skip.offset);
 	skip.length = swab32 (skip.length);
       }
-      printf ("             @0x%08lx+0x%08lx  (skip)\n",
+      printf ("             @0x%08x+0x%08x  (skip)\n",
 	      skip.offset, skip.length);
     }
   }
@@ -44,12 +44,13 @@
    reading
    -------
 
-   It is possible that our algorithms are too simple for reading from
-   a file.  We assume that the inodes are in reasonable shape.  The
-   presence of an overlay inode may cause an invalid read.  It's
-   really difficult to know.  The simplest way to handle this would be
-   to perform a fixup on the inode cache that makes it clear where
-   valid file data can be found.
+   The data nodes of a file may overlap when part of the file has
+   been rewritten.  When a file is opened, the driver builds a list
+   of fragments, the extents of the file each supplied by a single
+   node, much as Linux builds its fragtree.  The nodes are applied in
+   order of version so that newer data replaces older.  Extents not
+   covered by any node are holes and read as zeros.  Reads walk the
+   fragment list, so sequential reads don't search the inode cache.
 
    empty blocks
    ------------
@@ -66,6 +67,35 @@
    reducing the cache-load time for a filesystem with lots of empty
    space.
 
+   summaries
+   ---------
+
+   Linux may write a summary node at the end of each eraseblock that
+   lists the nodes in the block.  When the last bytes of a block are
+   a summary marker that points to a valid summary, the cache entries
+   for the block are taken from the summary and the block isn't
+   scanned.  Blocks without a summary, e.g. the one Linux was writing
+   last, are scanned.  Summaries are only found when the underlying
+   driver reports the eraseblock size the filesystem was made with.
+   A summary records the location and version of an inode node, but
+   not the part of the file it holds.  These inode cache entries are
+   completed by resolve_inode() when the inode is first used.
+
+   snapshots
+   ---------
+
+   The sorted caches may be saved to a reserved region, in flash or in
+   RAM that survives a reset, after the filesystem is scanned.  The
+   snapshot carries a fingerprint of each eraseblock: a CRC of the
+   first bytes of the block, where the clean marker and the first node
+   are, and of the bytes just past the last node found in the block.
+   Linux only writes nodes into the free space of a block and erases
+   a block before reusing it, so a change to the filesystem changes
+   the fingerprint of some block.  When every fingerprint matches,
+   the caches are read from the snapshot instead of scanning the
+   filesystem.  Otherwise, the filesystem is scanned and a new
+   snapshot is saved.
+
    crc's
    -----
 
@@ -75,14 +105,16 @@
    compression
    -----------
 
-   Only zlib compression is implemented.  Empirical evidence suggests
-   that none other is used.
+   Zlib compression is always implemented.  LZO compression, the
+   default for some kernel configurations, is implemented when LZO is
+   configured.  Empirical evidence suggests that no others are used.
 
 */
 
 #include <config.h>
 #include <apex.h>
 #include <driver.h>
+#include <block-cache.h>
 #include <service.h>
 #include <linux/string.h>
 #include <linux/ctype.h>
@@ -91,8 +123,8 @@
 #include <error.h>
 #include <sort.h>
 #include <linux/stat.h>
-#include <zlib.h>
-#include <zlib-heap.h>
+#include <inflate.h>
+#include <lzo.h>
 #include <console.h>
 #include <environment.h>
 #include <lookup.h>
@@ -146,6 +178,9 @@ enum {
 #define NODE_DIRENT		(FEATURE_INCOMPAT        | NODE_ACCURATE | 1)
 #define NODE_INODE		(FEATURE_INCOMPAT        | NODE_ACCURATE | 2)
 #define NODE_CLEAN		(FEATURE_RWCOMPAT_DELETE | NODE_ACCURATE | 3)
+#define NODE_SUMMARY		(FEATURE_RWCOMPAT_DELETE | NODE_ACCURATE | 6)
+#define NODE_XATTR		(FEATURE_INCOMPAT        | NODE_ACCURATE | 8)
+#define NODE_XREF		(FEATURE_INCOMPAT        | NODE_ACCURATE | 9)
 //#define NODE_CHECKPOINT	(FEATURE_RWCOMPAT_DELETE | NODE_ACCURATE | 3)
 //#define NODE_OPTIONS		(FEATURE_RWCOMPAT_COPY	 | NODE_ACCURATE | 4)
 //#define NODETYPE_DIRENT_ECC	(FEATURE_INCOMPAT	 | NODE_ACCURATE | 5)
@@ -156,6 +191,17 @@ enum {
 
 #define DIRENT_CACHE_MAX	( 3*1024)
 #define INODE_CACHE_MAX		(10*1024)
+#define DIRENT_HASH_SIZE	( 4*1024) /* Power of two */
+#define FRAGMENT_MAX		( 8*1024)
+
+#define SUMMARY_MAGIC		0x02851885
+
+#define SNAPSHOT_MAGIC		0x4a46534e /* 'JFSN' */
+#define SNAPSHOT_BLOCKS_MAX	(1024)
+#define SNAPSHOT_PROBE		(32)	/* Bytes of fingerprint per probe */
+#define SNAPSHOT_FORMAT		((sizeof (struct dirent_cache) << 16)\
+				 | sizeof (struct inode_cache))
+#define INODE_UNRESOLVED	(~0U)	/* dsize of an entry from a summary */
 
 enum {
   DT_UNKNOWN = 0,
@@ -227,12 +273,58 @@ union node {
 	struct unknown_node u;
 } __attribute__((packed));
 
+struct summary_node
+{
+  u16 marker;
+  u16 node_type;		/* NODE_SUMMARY */
+  u32 length;
+  u32 header_crc;
+  u32 sum_num;			/* Number of records */
+  u32 cln_mkr;			/* Size of the clean marker, 0 if none */
+  u32 padded;			/* Total size of the padding nodes */
+  u32 sum_crc;			/* CRC of the records to the end of block */
+  u32 node_crc;
+  //  records[sum_num], padding, struct summary_marker
+} __attribute__((packed));
+
+struct summary_marker
+{
+  u32 offset;			/* Offset of the summary node in the block */
+  u32 magic;			/* SUMMARY_MAGIC */
+} __attribute__((packed));
+
+struct summary_inode
+{
+  u16 node_type;		/* NODE_INODE */
+  u32 ino;
+  u32 version;
+  u32 offset;			/* Offset of the node in the block */
+  u32 length;
+} __attribute__((packed));
+
+struct summary_dirent
+{
+  u16 node_type;		/* NODE_DIRENT */
+  u32 length;
+  u32 offset;			/* Offset of the node in the block */
+  u32 pino;
+  u32 version;
+  u32 ino;
+  u8 nsize;
+  u8 type;
+  //  u8 name[nsize];
+} __attribute__((packed));
+
+#define SUMMARY_XATTR_LENGTH	18
+#define SUMMARY_XREF_LENGTH	6
+
 struct dirent_cache {
   u32 ino;
   u32 pino;
   u32 version;
   u32 index;			/* Offset to the struct dirent_node */
   u32 nsize;			/* Size of the name field */
+  u32 name_crc;			/* CRC of the name, as in the node */
   u8  type;			/* Cached entry type (DT_) */
 };
 
@@ -243,14 +335,25 @@ struct inode_cache {
   u32 csize;			/* Length of this node's data compressed */
   u32 dsize;			/* Length of this node's data uncompressed */
   u32 index;			/* Offset to the struct inode_node */
+  u8  compr;			/* Compression of the data (COMPRESSION_) */
+};
+
+struct fragment {
+  u32 offset;			/* Offset of the extent in the file */
+  u32 size;
+  s16 node;			/* Index into inode_cache of the data */
 };
 
 struct jffs2_info {
   struct descriptor_d d;	/* Descriptor for underlying driver */
+  unsigned long cbEraseBlock;	/* Eraseblock size of the driver */
 
   int fCached;			/* Set after the caches are loaded */
 
   u32 inode;			/* Open inode */
+  int cFragments;		/* Fragments of the open inode */
+  int iFragment;		/* Fragment of the last read */
+  int iCache;			/* inode_cache index of cached block */
   size_t ibCache;		/* Offset of cached block */
   size_t cbCache;		/* Length of cached block */
   /* *** FIXME: buffers should be in .xbss section */
@@ -267,6 +370,45 @@ static struct inode_cache __attribute__((section(".jffs2.xbss")))
 int cDirentCache;
 int cInodeCache;
 
+	/* Indices into dirent_cache, rebuilt whenever it is loaded */
+static s16 __attribute__((section(".jffs2.xbss")))
+     dirent_hash[DIRENT_HASH_SIZE];	/* Chains by parent and name */
+static s16 __attribute__((section(".jffs2.xbss")))
+     dirent_next[DIRENT_CACHE_MAX];
+static s16 __attribute__((section(".jffs2.xbss")))
+     dirent_ino[DIRENT_CACHE_MAX];	/* Sorted by inode */
+
+static struct fragment __attribute__((section(".jffs2.xbss")))
+     fragments[FRAGMENT_MAX];
+static s16 __attribute__((section(".jffs2.xbss")))
+     fragment_order[INODE_CACHE_MAX];	/* Nodes of a file by version */
+
+#if defined (CONFIG_DRIVER_JFFS2_SNAPSHOT)
+
+struct snapshot_header {
+  u32 magic;			/* SNAPSHOT_MAGIC */
+  u32 format;			/* SNAPSHOT_FORMAT */
+  u32 start;			/* Filesystem region of the driver */
+  u32 length;
+  u32 cbBlock;			/* Eraseblock size */
+  u32 cBlocks;
+  u32 cDirent;
+  u32 cInode;
+  u32 data_crc;			/* Fingerprints and both caches */
+  u32 header_crc;
+};
+
+struct snapshot_block {
+  u32 ibUsed;			/* End of the last node in the block */
+  u32 crc;			/* Fingerprint of the block */
+};
+
+static struct snapshot_block __attribute__((section(".jffs2.xbss")))
+     snapshot_blocks[SNAPSHOT_BLOCKS_MAX];
+static int cSnapshotBlocks;
+
+#endif
+
 #if defined (CONFIG_ENV)
 static __env struct env_d e_jffs2_drv = {
   .key = "jffs2-drv",
@@ -277,7 +419,7 @@ static __env struct env_d e_jffs2_drv = {
 
 static inline const char* block_driver (void)
 {
-  return lookup_alias_or_env ("jffs2-drv", CONFIG_DRIVER_JFFS2_BLOCKDEVICE);
+  return lookup_variable_or_env ("jffs2-drv", CONFIG_DRIVER_JFFS2_BLOCKDEVICE);
 }
 
 static inline void read_node (void* pv, size_t ib, size_t cb)
@@ -288,7 +430,7 @@ static inline void read_node (void* pv, size_t ib, size_t cb)
 //  PRINTF ("%s: %d %d -> %d\n", __FUNCTION__, ib, cb, cbRead);
 }
 
-extern unsigned long compute_crc32 (unsigned long crc, const void *pv, int cb);
+extern uint32_t compute_crc32 (uint32_t crc, const void *pv, int cb);
 
 static int verify_header_crc (struct unknown_node* node)
 {
@@ -353,28 +495,111 @@ static int find_cached_inode (u32 inode, size_t ib)
   return (inode_cache[min].ino == inode) ? min : -1;
 }
 
+/* first_cached_inode
+
+   returns the index of the first cached inode record for the inode
+   number, or the index where it would be if there are none.
+
+*/
+
+static int first_cached_inode (u32 inode)
+{
+  int min = 0;
+  int max = cInodeCache;
+
+  while (min < max) {
+    int mid = (min + max)/2;
+    if (inode_cache[mid].ino < inode)
+      min = mid + 1;
+    else
+      max = mid;
+  }
+  return min;
+}
+
+
+static inline int dirent_hash_key (u32 pino, u32 name_crc)
+{
+  return ((pino << 7) ^ pino ^ name_crc) & (DIRENT_HASH_SIZE - 1);
+}
 
 /* find_cached_directory_node
 
-   searches for an inode in the dirent cache.  This array is sorted by
-   parent inodes, so this search has to be an O(n) scan of the
-   array...for now.
+   searches for an inode in the dirent cache.  The dirent_ino index is
+   sorted by inode and, for each inode, by descending version so the
+   result is the most recent entry for the inode.
 
 */
 
 static int find_cached_directory_inode (u32 inode)
 {
+  int min = 0;
   int max = cDirentCache;
-  int i;
 
   ENTRY (0);
 
-  for (i = 0; i < max; ++i)
-    if (dirent_cache[i].ino == inode)
-      return i;
-  return -1;
+  while (min < max) {
+    int mid = (min + max)/2;
+    if (dirent_cache[dirent_ino[mid]].ino < inode)
+      min = mid + 1;
+    else
+      max = mid;
+  }
+
+  return (min < cDirentCache && dirent_cache[dirent_ino[min]].ino == inode)
+    ? dirent_ino[min] : -1;
 }
 
+/* find_cached_dirent
+
+   searches for the most recent directory entry with the given name in
+   the directory pino.  The name hash index gives the candidates and
+   only the best of them is read from flash to confirm the name.  The
+   return value is the index of the entry or -1 if there is none.  An
+   entry with an inode of zero records that the name was removed.
+
+*/
+
+static int find_cached_dirent (u32 pino, const char* sz, int cb)
+{
+  u32 name_crc = ~compute_crc32 (~0, sz, cb);
+  u32 version = ~0;
+
+  ENTRY (0);
+
+  while (1) {
+    char __aligned rgb[sizeof (struct dirent_node) + NAME_LENGTH_MAX];
+    struct dirent_node* dirent = (struct dirent_node*) rgb;
+    int best = -1;
+    int i;
+
+    for (i = dirent_hash[dirent_hash_key (pino, name_crc)]; i != -1;
+	 i = dirent_next[i])
+      if (dirent_cache[i].pino == pino
+	  && dirent_cache[i].name_crc == name_crc
+	  && dirent_cache[i].nsize == cb
+	  && dirent_cache[i].version < version
+	  && (best == -1
+	      || dirent_cache[i].version > dirent_cache[best].version))
+	best = i;
+
+    if (best == -1)
+      return -1;
+
+    jffs2.d.driver->seek (&jffs2.d, dirent_cache[best].index, SEEK_SET);
+    block_cache_read (&jffs2.d, dirent, sizeof (struct dirent_node) + cb);
+    if (dirent->nsize == cb
+	&& verify_crc (dirent->name, dirent->nsize, dirent->name_crc)
+		/* memcmp OK because we know the strings are the same length */
+	&& memcmp (sz, (const char*) dirent->name, cb) == 0)
+      return best;
+
+    version = dirent_cache[best].version; /* Collision, try an older one */
+  }
+}
+
+#if defined (CONFIG_CMD_INFO)
+
 static int find_cached_parent_inode (u32 inode)
 {
   int min = 0;
@@ -404,6 +629,8 @@ static int find_cached_parent_inode (u32 inode)
   return (dirent_cache[min].pino == inode) ? min : -1;
 }
 
+#endif
+
 int compare_dirent_cache (const void* _a, const void* _b)
 {
   struct dirent_cache* a = (struct dirent_cache*) _a;
@@ -417,6 +644,40 @@ int compare_dirent_cache (const void* _a, const void* _b)
   return a->pino - b->pino;
 }
 
+static int compare_dirent_ino (const void* _a, const void* _b)
+{
+  struct dirent_cache* a = &dirent_cache[*(const s16*) _a];
+  struct dirent_cache* b = &dirent_cache[*(const s16*) _b];
+
+  if (a->ino == b->ino)
+    return b->version - a->version;
+  return a->ino - b->ino;
+}
+
+/* index_dirents
+
+   builds the name hash chains and the inode index for the dirent
+   cache.  Chains list entries in the order of the cache.
+
+*/
+
+static void index_dirents (void)
+{
+  int i;
+
+  for (i = 0; i < DIRENT_HASH_SIZE; ++i)
+    dirent_hash[i] = -1;
+  for (i = cDirentCache; i-- > 0; ) {
+    int key = dirent_hash_key (dirent_cache[i].pino,
+			       dirent_cache[i].name_crc);
+    dirent_next[i] = dirent_hash[key];
+    dirent_hash[key] = i;
+    dirent_ino[i] = i;
+  }
+  sort (dirent_ino, cDirentCache, sizeof (*dirent_ino),
+	compare_dirent_ino, NULL);
+}
+
 int compare_inode_cache (const void* _a, const void* _b)
 {
   struct inode_cache* a = (struct inode_cache*) _a;
@@ -431,6 +692,58 @@ int compare_inode_cache (const void* _a, const void* _b)
 }
 
 
+#if defined (CONFIG_DRIVER_JFFS2_SUMMARY)
+
+/* resolve_inode
+
+   completes the inode cache entries for an inode that were taken
+   from eraseblock summaries.  The node headers are read for the file
+   offset and data sizes, entries for invalid nodes are dropped, and
+   the entries for the inode are sorted again.
+
+*/
+
+static void resolve_inode (u32 inode)
+{
+  int min = first_cached_inode (inode);
+  int i;
+  int fResolved = 0;
+
+  for (i = min; i < cInodeCache && inode_cache[i].ino == inode; ) {
+    struct inode_node node;
+
+    if (inode_cache[i].dsize != INODE_UNRESOLVED) {
+      ++i;
+      continue;
+    }
+
+    read_node (&node, inode_cache[i].index, sizeof (node));
+    if (node.marker != MARKER_JFFS2 || node.node_type != NODE_INODE
+	|| node.ino != inode || !verify_inode_crc (&node)) {
+      memmove (&inode_cache[i], &inode_cache[i + 1],
+	       (cInodeCache - i - 1)*sizeof (struct inode_cache));
+      --cInodeCache;
+      continue;
+    }
+
+    inode_cache[i].offset = node.offset;
+    inode_cache[i].csize  = node.csize;
+    inode_cache[i].dsize  = node.dsize;
+    inode_cache[i].compr  = node.compr;
+    fResolved = 1;
+    ++i;
+  }
+
+  if (fResolved)
+    sort (&inode_cache[min], i - min, sizeof (struct inode_cache),
+	  compare_inode_cache, NULL);
+}
+
+#else
+# define resolve_inode(i) ((void) 0)
+#endif
+
+
 /* summarize_inode
 
    returns the inode record that is most recent.  This is helpful for
@@ -440,21 +753,519 @@ int compare_inode_cache (const void* _a, const void* _b)
 
 void summarize_inode (u32 inode, union node* node)
 {
-  int i = find_cached_inode (inode, 0);
-  u32 version = 0;
+  int i;
+  int iNewest = -1;
+
+  resolve_inode (inode);
+
+  for (i = first_cached_inode (inode);
+       i < cInodeCache && inode_cache[i].ino == inode; ++i)
+    if (iNewest == -1
+	|| inode_cache[i].version >= inode_cache[iNewest].version)
+      iNewest = i;
+
+  if (iNewest == -1)
+    return;
+
+  PRINTF ("summarizing %d ver %d at %d(%x)\n",
+	  inode, inode_cache[iNewest].version,
+	  inode_cache[iNewest].index, inode_cache[iNewest].index);
+  read_node (node, inode_cache[iNewest].index, sizeof (struct inode_node));
+}
+
+
+/* add_fragment
+
+   lays the size bytes of node data at offset over the fragments of
+   the open file.  Parts of older fragments that the data covers are
+   trimmed or dropped.
+
+*/
+
+static int add_fragment (u32 offset, u32 size, int node)
+{
+  u32 end = offset + size;
+  int min = 0;
+  int max = jffs2.cFragments;
+  int i;
+  int j;
+
+  if (size == 0)
+    return 0;
+
+  while (min < max) {		/* First fragment ending after offset */
+    int mid = (min + max)/2;
+    if (fragments[mid].offset + fragments[mid].size <= offset)
+      min = mid + 1;
+    else
+      max = mid;
+  }
+  i = min;
+
+	/* New data within a single fragment splits it */
+  if (i < jffs2.cFragments && fragments[i].offset < offset
+      && fragments[i].offset + fragments[i].size > end) {
+    if (jffs2.cFragments + 2 > FRAGMENT_MAX)
+      return ERROR_OUTOFMEMORY;
+    memmove (&fragments[i + 2], &fragments[i],
+	     (jffs2.cFragments - i)*sizeof (struct fragment));
+    jffs2.cFragments += 2;
+    fragments[i].size = offset - fragments[i].offset;
+    fragments[i + 2].size -= end - fragments[i + 2].offset;
+    fragments[i + 2].offset = end;
+    ++i;
+  }
+  else {
+    if (i < jffs2.cFragments && fragments[i].offset < offset) {
+      fragments[i].size = offset - fragments[i].offset;
+      ++i;
+    }
+    for (j = i; j < jffs2.cFragments
+	   && fragments[j].offset + fragments[j].size <= end; ++j)
+      ;
+    if (j < jffs2.cFragments && fragments[j].offset < end) {
+      fragments[j].size -= end - fragments[j].offset;
+      fragments[j].offset = end;
+    }
+
+	/* Fragments i through j - 1 are replaced by the new one */
+    if (j == i) {
+      if (jffs2.cFragments + 1 > FRAGMENT_MAX)
+	return ERROR_OUTOFMEMORY;
+      memmove (&fragments[i + 1], &fragments[i],
+	       (jffs2.cFragments - i)*sizeof (struct fragment));
+      ++jffs2.cFragments;
+    }
+    else if (j > i + 1) {
+      memmove (&fragments[i + 1], &fragments[j],
+	       (jffs2.cFragments - j)*sizeof (struct fragment));
+      jffs2.cFragments -= j - i - 1;
+    }
+  }
+
+  fragments[i].offset = offset;
+  fragments[i].size = size;
+  fragments[i].node = node;
+  return 0;
+}
+
+static int compare_fragment_order (const void* _a, const void* _b)
+{
+  struct inode_cache* a = &inode_cache[*(const s16*) _a];
+  struct inode_cache* b = &inode_cache[*(const s16*) _b];
+
+  return a->version < b->version ? -1 : (a->version > b->version);
+}
+
+/* load_fragments
+
+   builds the fragment list for the inode from its data nodes.
+
+*/
+
+static int load_fragments (u32 inode)
+{
+  int c = 0;
+  int i;
+
+  jffs2.cFragments = 0;
+  jffs2.iFragment = 0;
+
+  for (i = first_cached_inode (inode);
+       i < cInodeCache && inode_cache[i].ino == inode; ++i)
+    fragment_order[c++] = i;
+  sort (fragment_order, c, sizeof (*fragment_order),
+	compare_fragment_order, NULL);
+
+  for (i = 0; i < c; ++i) {
+    int result = add_fragment (inode_cache[fragment_order[i]].offset,
+			       inode_cache[fragment_order[i]].dsize,
+			       fragment_order[i]);
+    if (result)
+      ERROR_RETURN (result, "too many jffs2 fragments");
+  }
+
+  PRINTF ("%s: %d nodes %d fragments\n", __FUNCTION__, c, jffs2.cFragments);
+  return 0;
+}
+
+/* find_fragment
+
+   returns the index of the first fragment of the open file that ends
+   after the file offset ib.  Sequential reads find it at or just
+   after the fragment of the last read.
+
+*/
+
+static int find_fragment (size_t ib)
+{
+  int min = 0;
+  int max = jffs2.cFragments;
+  int i;
+
+  for (i = jffs2.iFragment; i < jffs2.iFragment + 2; ++i)
+    if (i < jffs2.cFragments
+	&& fragments[i].offset + fragments[i].size > ib
+	&& (i == 0 || fragments[i - 1].offset + fragments[i - 1].size <= ib))
+      return i;
+
+  while (min < max) {
+    int mid = (min + max)/2;
+    if (fragments[mid].offset + fragments[mid].size <= ib)
+      min = mid + 1;
+    else
+      max = mid;
+  }
+  return min;
+}
+
+
+#if defined (CONFIG_DRIVER_JFFS2_SUMMARY)
+
+/* jffs2_load_summary
+
+   caches the nodes of the eraseblock at ibBlock from its summary
+   node.  The return value is non-zero when the block has a valid
+   summary.  Otherwise, no entries are added and the block must be
+   scanned.
+
+*/
+
+static int jffs2_load_summary (size_t ibBlock, size_t cbBlock)
+{
+  struct summary_marker marker;
+  struct summary_node sum;
+  size_t ib;
+  size_t ibEnd = ibBlock + cbBlock - sizeof (marker);
+  u32 crc = ~0;
+  int cDirent = cDirentCache;
+  int cInode = cInodeCache;
+  int i;
+
+  jffs2.d.driver->seek (&jffs2.d, ibEnd, SEEK_SET);
+  block_cache_read (&jffs2.d, &marker, sizeof (marker));
+  if (marker.magic != SUMMARY_MAGIC
+      || marker.offset + sizeof (sum) > cbBlock - sizeof (marker))
+    return 0;
+
+  ib = ibBlock + marker.offset;
+  jffs2.d.driver->seek (&jffs2.d, ib, SEEK_SET);
+  block_cache_read (&jffs2.d, &sum, sizeof (sum));
+  if (sum.marker != MARKER_JFFS2 || sum.node_type != NODE_SUMMARY
+      || !verify_header_crc ((struct unknown_node*) &sum)
+      || sum.node_crc != ~compute_crc32 (~0, &sum, sizeof (sum) - 8)
+      || sum.length != cbBlock - marker.offset)
+    return 0;
+  ib += sizeof (sum);
+
+	/* Records follow the summary node header, one after another */
+  for (i = 0; i < sum.sum_num; ++i) {
+    char __aligned rgb[sizeof (struct summary_dirent) + NAME_LENGTH_MAX];
+    struct summary_inode* inode = (struct summary_inode*) rgb;
+    struct summary_dirent* dirent = (struct summary_dirent*) rgb;
+    size_t cb = sizeof (u16);
 
-  for (; i < cInodeCache; ++i) {
-    if (inode_cache[i].ino != inode)
+    if (ib + cb > ibEnd)
+      goto invalid;
+    block_cache_read (&jffs2.d, rgb, cb);
+
+    switch (inode->node_type) {
+    case NODE_INODE:
+      cb = sizeof (*inode);
       break;
-    if (inode_cache[i].version < version)
-      continue;
-    version = inode_cache[i].version;
-    PRINTF ("summarizing %d ver %d at %d(%x)\n",
-	    inode, version, inode_cache[i].index, inode_cache[i].index);
-    read_node (node, inode_cache[i].index, sizeof (struct inode_node));
+    case NODE_DIRENT:
+      cb = sizeof (*dirent);
+      break;
+    case NODE_XATTR:
+      cb = SUMMARY_XATTR_LENGTH;
+      break;
+    case NODE_XREF:
+      cb = SUMMARY_XREF_LENGTH;
+      break;
+    default:
+      goto invalid;
+    }
+    if (ib + cb > ibEnd)
+      goto invalid;
+    block_cache_read (&jffs2.d, rgb + sizeof (u16), cb - sizeof (u16));
+    if (inode->node_type == NODE_DIRENT) {
+      if (ib + cb + dirent->nsize > ibEnd)
+	goto invalid;
+      block_cache_read (&jffs2.d, rgb + cb, dirent->nsize);
+      cb += dirent->nsize;
+    }
+    crc = compute_crc32 (crc, rgb, cb);
+    ib += cb;
+
+    switch (inode->node_type) {
+    case NODE_DIRENT:
+      if (cDirentCache >= DIRENT_CACHE_MAX)
+	goto invalid;
+      dirent_cache[cDirentCache].ino     = dirent->ino;
+      dirent_cache[cDirentCache].pino    = dirent->pino;
+      dirent_cache[cDirentCache].version = dirent->version;
+      dirent_cache[cDirentCache].index   = ibBlock + dirent->offset;
+      dirent_cache[cDirentCache].nsize   = dirent->nsize;
+      dirent_cache[cDirentCache].name_crc
+	= ~compute_crc32 (~0, rgb + sizeof (*dirent), dirent->nsize);
+      dirent_cache[cDirentCache].type    = dirent->type;
+      ++cDirentCache;
+      break;
+
+    case NODE_INODE:
+      if (cInodeCache >= INODE_CACHE_MAX)
+	goto invalid;
+      inode_cache[cInodeCache].ino       = inode->ino;
+      inode_cache[cInodeCache].offset    = 0;
+      inode_cache[cInodeCache].csize     = 0;
+      inode_cache[cInodeCache].dsize     = INODE_UNRESOLVED;
+      inode_cache[cInodeCache].compr     = 0;
+      inode_cache[cInodeCache].version   = inode->version;
+      inode_cache[cInodeCache].index     = ibBlock + inode->offset;
+      ++cInodeCache;
+      break;
+    }
+  }
+
+	/* The CRC covers the padding and the marker as well */
+  while (ib < ibEnd + sizeof (marker)) {
+    char __aligned rgb[256];
+    size_t cb = ibEnd + sizeof (marker) - ib;
+    if (cb > sizeof (rgb))
+      cb = sizeof (rgb);
+    block_cache_read (&jffs2.d, rgb, cb);
+    crc = compute_crc32 (crc, rgb, cb);
+    ib += cb;
+  }
+  if (sum.sum_crc != ~crc)
+    goto invalid;
+
+  return 1;
+
+ invalid:
+  cDirentCache = cDirent;
+  cInodeCache = cInode;
+  return 0;
+}
+
+#endif
+
+
+#if defined (CONFIG_DRIVER_JFFS2_SNAPSHOT)
+
+/* snapshot_begin
+
+   clears the fingerprint blocks before the filesystem is scanned.
+   Snapshots are disabled for a filesystem with too many eraseblocks.
+
+*/
+
+static void snapshot_begin (void)
+{
+  int i;
+
+  cSnapshotBlocks = (jffs2.d.length + jffs2.cbEraseBlock - 1)
+    /jffs2.cbEraseBlock;
+  if (cSnapshotBlocks > SNAPSHOT_BLOCKS_MAX)
+    cSnapshotBlocks = 0;
+  for (i = 0; i < cSnapshotBlocks; ++i) {
+    snapshot_blocks[i].ibUsed = i*jffs2.cbEraseBlock;
+    snapshot_blocks[i].crc = 0;
+  }
+}
+
+/* snapshot_used
+
+   records that a node occupies cb bytes at ib.
+
+*/
+
+static void snapshot_used (size_t ib, size_t cb)
+{
+  int i = ib/jffs2.cbEraseBlock;
+
+  if (i < cSnapshotBlocks && ib + cb > snapshot_blocks[i].ibUsed)
+    snapshot_blocks[i].ibUsed = ib + cb;
+}
+
+/* snapshot_fingerprint
+
+   returns the fingerprint of eraseblock i from the flash.
+
+*/
+
+static u32 snapshot_fingerprint (int i)
+{
+  char __aligned rgb[SNAPSHOT_PROBE];
+  size_t ib = i*jffs2.cbEraseBlock;
+  size_t ibEnd = ib + jffs2.cbEraseBlock;
+  size_t ibUsed = snapshot_blocks[i].ibUsed;
+  u32 crc;
+
+  if (ibEnd > jffs2.d.length)
+    ibEnd = jffs2.d.length;
+
+  read_node (rgb, ib, sizeof (rgb));
+  crc = compute_crc32 (~0, rgb, sizeof (rgb));
+  if (ibUsed > ib && ibUsed < ibEnd) {
+    if (ibUsed + sizeof (rgb) > ibEnd)
+      ibUsed = ibEnd - sizeof (rgb);
+    read_node (rgb, ibUsed, sizeof (rgb));
+    crc = compute_crc32 (crc, rgb, sizeof (rgb));
   }
+  return crc;
 }
 
+static u32 snapshot_data_crc (void)
+{
+  u32 crc = ~0;
+
+  crc = compute_crc32 (crc, snapshot_blocks,
+		       cSnapshotBlocks*sizeof (struct snapshot_block));
+  crc = compute_crc32 (crc, dirent_cache,
+		       cDirentCache*sizeof (struct dirent_cache));
+  crc = compute_crc32 (crc, inode_cache,
+		       cInodeCache*sizeof (struct inode_cache));
+  return crc;
+}
+
+/* jffs2_load_snapshot
+
+   loads the caches from the snapshot region when the snapshot was
+   made from this filesystem and the fingerprint of every eraseblock
+   still matches.  The return value is non-zero when the caches were
+   loaded.
+
+*/
+
+static int jffs2_load_snapshot (void)
+{
+  struct descriptor_d d;
+  struct snapshot_header header;
+  int i;
+  int result = 0;
+
+  ENTRY (0);
+
+  if (parse_descriptor (CONFIG_DRIVER_JFFS2_SNAPSHOT_REGION, &d)
+      || open_descriptor (&d))
+    return 0;
+
+  d.driver->seek (&d, 0, SEEK_SET);
+  if (d.driver->read (&d, &header, sizeof (header)) != sizeof (header)
+      || header.magic != SNAPSHOT_MAGIC
+      || header.header_crc
+	 != compute_crc32 (~0, &header, sizeof (header) - 4)
+      || header.format != SNAPSHOT_FORMAT
+      || header.start != jffs2.d.start
+      || header.length != jffs2.d.length
+      || header.cbBlock != jffs2.cbEraseBlock
+      || header.cBlocks > SNAPSHOT_BLOCKS_MAX
+      || header.cBlocks
+	 != (jffs2.d.length + jffs2.cbEraseBlock - 1)/jffs2.cbEraseBlock
+      || header.cDirent > DIRENT_CACHE_MAX
+      || header.cInode > INODE_CACHE_MAX
+      || sizeof (header)
+	 + header.cBlocks*sizeof (struct snapshot_block)
+	 + header.cDirent*sizeof (struct dirent_cache)
+	 + header.cInode*sizeof (struct inode_cache) > d.length)
+    goto exit;
+
+	/* Check the filesystem before reading the caches */
+  cSnapshotBlocks = header.cBlocks;
+  d.driver->read (&d, snapshot_blocks,
+		  cSnapshotBlocks*sizeof (struct snapshot_block));
+  for (i = 0; i < cSnapshotBlocks; ++i)
+    if (snapshot_fingerprint (i) != snapshot_blocks[i].crc)
+      goto exit;
+
+  cDirentCache = header.cDirent;
+  cInodeCache = header.cInode;
+  d.driver->read (&d, dirent_cache,
+		  cDirentCache*sizeof (struct dirent_cache));
+  d.driver->read (&d, inode_cache,
+		  cInodeCache*sizeof (struct inode_cache));
+  if (snapshot_data_crc () != header.data_crc) {
+    cDirentCache = 0;
+    cInodeCache = 0;
+    goto exit;
+  }
+
+  printf ("Loaded jffs2 snapshot, %d directory nodes %d inodes nodes\n",
+	  cDirentCache, cInodeCache);
+  result = 1;
+
+ exit:
+  close_descriptor (&d);
+  return result;
+}
+
+/* jffs2_save_snapshot
+
+   writes the caches and the fingerprint of every eraseblock to the
+   snapshot region.  Nothing is written when the region is too small.
+
+*/
+
+static void jffs2_save_snapshot (void)
+{
+  struct descriptor_d d;
+  struct snapshot_header header;
+  int i;
+
+  ENTRY (0);
+
+  if (cSnapshotBlocks == 0
+      || parse_descriptor (CONFIG_DRIVER_JFFS2_SNAPSHOT_REGION, &d)
+      || open_descriptor (&d))
+    return;
+
+  if (!d.driver->write
+      || sizeof (header)
+	 + cSnapshotBlocks*sizeof (struct snapshot_block)
+	 + cDirentCache*sizeof (struct dirent_cache)
+	 + cInodeCache*sizeof (struct inode_cache) > d.length)
+    goto exit;
+
+  for (i = 0; i < cSnapshotBlocks; ++i)
+    snapshot_blocks[i].crc = snapshot_fingerprint (i);
+
+  memset (&header, 0, sizeof (header));
+  header.magic    = SNAPSHOT_MAGIC;
+  header.format   = SNAPSHOT_FORMAT;
+  header.start    = jffs2.d.start;
+  header.length   = jffs2.d.length;
+  header.cbBlock  = jffs2.cbEraseBlock;
+  header.cBlocks  = cSnapshotBlocks;
+  header.cDirent  = cDirentCache;
+  header.cInode   = cInodeCache;
+  header.data_crc = snapshot_data_crc ();
+  header.header_crc = compute_crc32 (~0, &header, sizeof (header) - 4);
+
+  if (d.driver->erase) {
+    d.driver->seek (&d, 0, SEEK_SET);
+    d.driver->erase (&d, d.length);
+  }
+  d.driver->seek (&d, 0, SEEK_SET);
+  d.driver->write (&d, &header, sizeof (header));
+  d.driver->write (&d, snapshot_blocks,
+		   cSnapshotBlocks*sizeof (struct snapshot_block));
+  d.driver->write (&d, dirent_cache,
+		   cDirentCache*sizeof (struct dirent_cache));
+  d.driver->write (&d, inode_cache,
+		   cInodeCache*sizeof (struct inode_cache));
+
+ exit:
+  close_descriptor (&d);
+}
+
+#else
+# define snapshot_begin()		do { } while (0)
+# define snapshot_used(ib,cb)		do { } while (0)
+# define jffs2_load_snapshot()		(0)
+# define jffs2_save_snapshot()		do { } while (0)
+#endif
+
 
 /* jffs2_load_cache
 
@@ -466,6 +1277,8 @@ void summarize_inode (u32 inode, union node* node)
    means we cannot save pointers into flash.  Instead, we save
    offsets.
 
+   An eraseblock with a summary is cached from the summary alone.
+
 */
 
 static int jffs2_load_cache (void)
@@ -483,6 +1296,8 @@ static int jffs2_load_cache (void)
   cDirentCache = 0;		/* Reset cache in case we were cancelled */
   cInodeCache = 0;
 
+  snapshot_begin ();
+
   for (ib = 0; ib < jffs2.d.length; ib = (ib + cbNode + 3) & ~3) {
 
     if (console->poll (0, 0)) {	/* Check for ^C */
@@ -500,8 +1315,19 @@ static int jffs2_load_cache (void)
        *** machine starts.  */
     SPINNER_STEP;
 
+#if defined (CONFIG_DRIVER_JFFS2_SUMMARY)
+    if (ib % jffs2.cbEraseBlock == 0
+	&& ib + jffs2.cbEraseBlock <= jffs2.d.length
+	&& jffs2_load_summary (ib, jffs2.cbEraseBlock)) {
+      cEmpties = 0;
+      cbNode = jffs2.cbEraseBlock;
+      snapshot_used (ib, cbNode);
+      continue;
+    }
+#endif
+
     jffs2.d.driver->seek (&jffs2.d, ib, SEEK_SET);
-    jffs2.d.driver->read (&jffs2.d, &node, sizeof (node));
+    block_cache_read (&jffs2.d, &node, sizeof (node));
 
     if (node.u.marker != MARKER_JFFS2 || !verify_header_crc (&node.u)) {
       cbNode = 4;
@@ -526,6 +1352,7 @@ static int jffs2_load_cache (void)
     cEmpties = 0;
 
     cbNode = (node.u.length + 3) & ~3;
+    snapshot_used (ib, cbNode);
 
     switch (node.u.node_type) {
     case NODE_DIRENT:
@@ -537,6 +1364,7 @@ static int jffs2_load_cache (void)
       dirent_cache[cDirentCache].version = node.d.version;
       dirent_cache[cDirentCache].index   = ib;
       dirent_cache[cDirentCache].nsize   = node.d.nsize;
+      dirent_cache[cDirentCache].name_crc = node.d.name_crc;
       dirent_cache[cDirentCache].type    = node.d.type;
       ++cDirentCache;
       break;
@@ -549,6 +1377,7 @@ static int jffs2_load_cache (void)
       inode_cache[cInodeCache].offset    = node.i.offset;
       inode_cache[cInodeCache].csize     = node.i.csize;
       inode_cache[cInodeCache].dsize     = node.i.dsize;
+      inode_cache[cInodeCache].compr     = node.i.compr;
       inode_cache[cInodeCache].version   = node.i.version;
       inode_cache[cInodeCache].index     = ib;
       ++cInodeCache;
@@ -574,38 +1403,41 @@ static int jffs2_load_cache (void)
 }
 
 
-/* jffs2_decompress_node
+/* jffs2_node_data
 
-   copies the given node, references by inode_cache index, to the
-   single node cache which is limited to 4KiB.
-
-   *** FIXME: we could do some optimizations for when a) the node is
-   *** zero and b) when the node is uncompressed.  For the time being,
-   *** we'll leave it at this.
+   copies or decompresses the data of the given node, referenced by
+   inode_cache index, to pv.  The destination must have room for the
+   node's data, no more than BLOCK_SIZE_MAX bytes.  Uncompressed data
+   is read from flash directly to the destination and compressed data
+   is inflated there, so there are no intermediate copies.  Nodes
+   that are larger than a block, or whose data doesn't decode to
+   exactly dsize bytes, are rejected.
 
 */
 
-static int jffs2_decompress_node (int index)
+static int jffs2_node_data (int index, void* pv)
 {
   char __aligned rgb[BLOCK_SIZE_MAX + sizeof (struct inode_node)];
   struct inode_node* node = (struct inode_node*) rgb;
+  size_t ibData = inode_cache[index].index + sizeof (struct inode_node);
   size_t dsize;
   size_t csize;
 
   ENTRY (0);
 
-  read_node (rgb, inode_cache[index].index,
-	     sizeof (struct inode_node) + inode_cache[index].csize);
-
-  if (!verify_crc (node + 1, node->csize, node->data_crc))
-    return ERROR_CRCFAILURE;
+  read_node (rgb, inode_cache[index].index, sizeof (struct inode_node));
 
   dsize = node->dsize;
-  if (dsize > BLOCK_SIZE_MAX)
-    dsize = BLOCK_SIZE_MAX;
   csize = node->csize;
-  if (csize > BLOCK_SIZE_MAX)
-    csize = BLOCK_SIZE_MAX;
+  if (node->compr == COMPRESSION_ZERO) {
+    if (dsize > BLOCK_SIZE_MAX)	/* Holes may be longer than a block */
+      dsize = BLOCK_SIZE_MAX;
+  }
+  else if (csize > BLOCK_SIZE_MAX || dsize > BLOCK_SIZE_MAX) {
+    PRINTF ("%s: node too large cs %d  ds %d\n", __FUNCTION__,
+	    csize, dsize);
+    return ERROR_FAILURE;
+  }
 
   PRINTF ("%s: %d of %d  cs %d  ds %d\n", __FUNCTION__,
 	  index,
@@ -618,61 +1450,100 @@ static int jffs2_decompress_node (int index)
   switch (node->compr) {
 
   case COMPRESSION_NONE:
-    memcpy (jffs2.rgbCache, node + 1, dsize);
-    jffs2.ibCache = node->offset;
-    jffs2.cbCache = dsize;
+    if (csize != dsize)
+      return ERROR_FAILURE;
+    read_node (pv, ibData, dsize);
+    if (!verify_crc (pv, csize, node->data_crc))
+      return ERROR_CRCFAILURE;
     break;
 
   case COMPRESSION_ZERO:
-    memset (jffs2.rgbCache, 0, dsize);
-    jffs2.ibCache = node->offset;
-    jffs2.cbCache = dsize;
+    memset (pv, 0, dsize);
     break;
 
   case COMPRESSION_ZLIB:
     {
-      z_stream z;
+      struct inflate_d inf;
       int result;
 
-      memset (&z, 0, sizeof (z));
-      z.zalloc = zlib_heap_alloc;
-      z.zfree = zlib_heap_free;
-      zlib_heap_reset ();
-      result = inflateInit (&z);
-      if (result != Z_OK) {
-	PRINTF ("%s: inflateInit %d\n", __FUNCTION__, result);
-	return ERROR_FAILURE;
-      }
-      z.next_in = (Bytef*) (node + 1);
-      z.avail_in = csize;
-      z.next_out = (Bytef*) jffs2.rgbCache;
-      z.avail_out = BLOCK_SIZE_MAX;
-      result = inflate (&z, 0);
-      if (result)
-	PRINTF ("%s: inflate %d\n", __FUNCTION__, result);
-      jffs2.ibCache = node->offset;
-      jffs2.cbCache = (result >= 0) ? dsize : 0;
-      return (result >= 0) ? 0 : ERROR_FAILURE;
+      read_node (node + 1, ibData, csize);
+      if (!verify_crc (node + 1, csize, node->data_crc))
+	return ERROR_CRCFAILURE;
+
+      inflate_init (&inf, pv, dsize);
+      inf.next_in = (const unsigned char*) (node + 1);
+      inf.avail_in = csize;
+      result = inflate_zlib (&inf);
+      if (result != INFLATE_OK || inf.total_out != dsize)
+	PRINTF ("%s: inflate %d  %d of %d\n", __FUNCTION__, result,
+		inf.total_out, dsize);
+      return (result == INFLATE_OK && inf.total_out == dsize)
+	? 0 : ERROR_FAILURE;
     }
     break;
 
+#if defined (CONFIG_LZO)
+  case COMPRESSION_LZO:
+    {
+      size_t cb = dsize;
+      int result;
+
+      read_node (node + 1, ibData, csize);
+      if (!verify_crc (node + 1, csize, node->data_crc))
+	return ERROR_CRCFAILURE;
+
+      result = lzo1x_decompress (node + 1, csize, pv, &cb);
+      if (result != LZO_E_OK || cb != dsize)
+	PRINTF ("%s: lzo1x_decompress %d  %d of %d\n", __FUNCTION__,
+		result, cb, dsize);
+      return (result == LZO_E_OK && cb == dsize) ? 0 : ERROR_FAILURE;
+    }
+    break;
+#endif
+
   case COMPRESSION_RTIME:
   case COMPRESSION_RUBINMIPS:
   case COMPRESSION_COPY:
   case COMPRESSION_DYNRUBIN:
+#if !defined (CONFIG_LZO)
   case COMPRESSION_LZO:
+#endif
   case COMPRESSION_LZARI:
   default:
     PRINTF ("%s: unsupported compression mode %d\n", __FUNCTION__,
 	    node->compr);
-    jffs2.ibCache = 0;
-    jffs2.cbCache = 0;
     return ERROR_UNSUPPORTED;
   }
 
   return 0;
 }
 
+
+/* jffs2_decompress_node
+
+   copies the given node, references by inode_cache index, to the
+   single node cache which is limited to 4KiB.
+
+*/
+
+static int jffs2_decompress_node (int index)
+{
+  int result;
+
+  jffs2.iCache = -1;
+  jffs2.cbCache = 0;
+  result = jffs2_node_data (index, jffs2.rgbCache);
+  if (result)
+    return result;
+
+  jffs2.ibCache = inode_cache[index].offset;
+  jffs2.cbCache = inode_cache[index].dsize;
+  if (jffs2.cbCache > BLOCK_SIZE_MAX)
+    jffs2.cbCache = BLOCK_SIZE_MAX;
+  jffs2.iCache = index;
+  return 0;
+}
+
 /* jffs2_find_file
 
    finds a file given the parent inode number and the path.
@@ -709,67 +1580,41 @@ static int jffs2_path_to_inode (int inode, struct descriptor_d* d)
       continue;
     }
 
-    index = find_cached_parent_inode (inode);
-    if (index == -1)
+    index = find_cached_dirent (inode, d->pb[i], length);
+    if (index == -1 || dirent_cache[index].ino == 0)
       return 0;			/* Path not found */
 
     PRINTF ("%s: index %d\n", __FUNCTION__, index);
 
-    for (; index < cDirentCache; ++index) {
-		/* Short-circuit for name length mismatch */
-      char __aligned rgb[512];
-      size_t cbNode;
-      struct dirent_node* dirent = (struct dirent_node*) rgb;
-
-      if (dirent_cache[index].nsize != length)
-	continue;
-
-      cbNode = sizeof (struct dirent_node) + dirent_cache[index].nsize;
-      if (cbNode > sizeof (rgb))
-	cbNode = sizeof (rgb);
-
-      jffs2.d.driver->seek (&jffs2.d, dirent_cache[index].index,
-			    SEEK_SET);
-      jffs2.d.driver->read (&jffs2.d, dirent, cbNode);
-
-      if (!verify_crc (dirent->name, dirent->nsize, dirent->name_crc))
-	continue;		/* Simply ignore invalid names */
-
-		/* memcmp OK because we know the strings are the same length */
-      if (memcmp (d->pb[i], (const char*) dirent->name, dirent->nsize))
-	continue;
-
-      inode = dirent->ino;
-
-      if (dirent->type == DT_LNK) {
-	int pino = dirent->pino;
-	while (1) {
-	  int i = find_cached_inode (inode, 0);
-	  int cbDriver;
-	  char sz[32 + inode_cache[i].dsize];
-	  struct descriptor_d d2;
-	  union node node;
-
-	  jffs2_decompress_node (i); /* One and only one */
-
-	  strcpy (sz, DRIVER_NAME);
-	  cbDriver = strlen (sz); sz[cbDriver++] = ':';
-	  memcpy (sz + cbDriver, jffs2.rgbCache, inode_cache[i].dsize);
-	  sz[cbDriver + inode_cache[i].dsize] = 0;
-	  PRINTF ("%s: chasing symlink '%s'\n", __FUNCTION__, sz);
-	  if (parse_descriptor (sz, &d2))
-	    return 0;		/* Unable to chase link */
-	  inode = jffs2_path_to_inode (pino, &d2);
-	  summarize_inode (inode, &node);
-	  if (!S_ISLNK (node.i.mode))
-	    break;
-	  i = find_cached_directory_inode (inode);
-	  pino = dirent_cache[i].pino;
-	}
-	jffs2.cbCache = 0;	/* Invalidate cached data  */
+    inode = dirent_cache[index].ino;
+
+    if (dirent_cache[index].type == DT_LNK) {
+      int pino = dirent_cache[index].pino;
+      while (1) {
+	int i = (resolve_inode (inode), find_cached_inode (inode, 0));
+	int cbDriver;
+	char sz[32 + inode_cache[i].dsize];
+	struct descriptor_d d2;
+	union node node;
+
+	jffs2_decompress_node (i); /* One and only one */
+
+	strcpy (sz, DRIVER_NAME);
+	cbDriver = strlen (sz); sz[cbDriver++] = ':';
+	memcpy (sz + cbDriver, jffs2.rgbCache, inode_cache[i].dsize);
+	sz[cbDriver + inode_cache[i].dsize] = 0;
+	PRINTF ("%s: chasing symlink '%s'\n", __FUNCTION__, sz);
+	if (parse_descriptor (sz, &d2))
+	  return 0;		/* Unable to chase link */
+	inode = jffs2_path_to_inode (pino, &d2);
+	summarize_inode (inode, &node);
+	if (!S_ISLNK (node.i.mode))
+	  break;
+	i = find_cached_directory_inode (inode);
+	pino = dirent_cache[i].pino;
       }
-
-      break;
+      jffs2.iCache = -1;	/* Invalidate cached data  */
+      jffs2.cbCache = 0;
     }
 
 //    inode = dotdot ? node->d.pino : node->d.ino;
@@ -800,9 +1645,19 @@ static int jffs2_identify (void)
     return result;
 
   jffs2.d = d;
-  result = jffs2_load_cache ();
-  if (result)
-    return result;
+  jffs2.cbEraseBlock = 0;
+  jffs2.d.driver->seek (&jffs2.d, 0, SEEK_SET);
+  if (descriptor_query (&jffs2.d, QUERY_ERASEBLOCKSIZE, &jffs2.cbEraseBlock)
+      || jffs2.cbEraseBlock == 0)
+    jffs2.cbEraseBlock = ERASEBLOCK_SIZE;
+
+  if (!jffs2_load_snapshot ()) {
+    result = jffs2_load_cache ();
+    if (result)
+      return result;
+    jffs2_save_snapshot ();
+  }
+  index_dirents ();
 
   jffs2.fCached = 1;
   return 0;
@@ -824,6 +1679,11 @@ static int jffs2_open (struct descriptor_d* d)
     return ERROR_FILENOTFOUND;
 
   summarize_inode (jffs2.inode, &node);
+  jffs2.iCache = -1;		/* Data cached for another file is stale */
+  jffs2.cbCache = 0;
+  if ((result = load_fragments (jffs2.inode)))
+    return result;
+
   if (!d->length)		/* Default length is whole file */
     d->length = node.i.isize;
 
@@ -855,25 +1715,20 @@ static ssize_t jffs2_read (struct descriptor_d* d, void* pv, size_t cb)
   if (d->index >= d->length)
     return cbRead;
 
-  /* Need to keep a couple of things in mind here.  If the request is
-     within an existing cached block, satisfy it and return.  If the
-     request is in another block, scan the inode data for the record
-     and either copy it to the cache (if compressed) or read directly
-     from source.  That should be it, actually.
-
-     The truth is that we aren't that smart.  We read from flash and
-     either copy or decompress the data.  We don't do anything smart
-     if the data isn't compressed.  It's easier this way and the
-     performance is reasonable.
-
- */
+  /* The fragment list gives the node that holds the data at each
+     offset of the file.  When the request covers all of a node, the
+     node's data is read or decompressed straight to the caller's
+     buffer.  Otherwise, the node goes to the cache block and the
+     request is satisfied from there as long as it holds the node of
+     the fragment being read.  Holes, both gaps between fragments and
+     zero nodes of any length, read as zeros. */
 
   while (cb) {
     size_t index = d->start + d->index;
     size_t remain = d->length - d->index; /* total remaining */
+    size_t available;
+    struct fragment* f;
     int i;
-    int state = 0;
-    int result;
 
     PRINTF ("%s: index %d  cb %d  ibCache %d  cbCache %d  cbRead %d\n",
 	    __FUNCTION__, index, cb, jffs2.ibCache, jffs2.cbCache, cbRead);
@@ -881,53 +1736,77 @@ static ssize_t jffs2_read (struct descriptor_d* d, void* pv, size_t cb)
     if (remain <= 0)
       return cbRead;
 
-	/* Read from the cache */
-    if (index >= jffs2.ibCache && index < jffs2.ibCache + jffs2.cbCache) {
-      size_t offset = index - jffs2.ibCache;
-      size_t available = jffs2.cbCache - offset; /* available in the cache */
-      PRINTF ("%s: offset %d  available %d  remain %d  cb %d\n",
-	      __FUNCTION__, offset, available, remain, cb);
+    i = find_fragment (index);
+    f = &fragments[i];
+
+    if (i == jffs2.cFragments || f->offset > index) {
+      available = (i == jffs2.cFragments) ? remain : f->offset - index;
       if (available > cb)
 	available = cb;
       if (available > remain)
 	available = remain;
-      PRINTF ("%s: available %d  offset %d\n",
-	      __FUNCTION__, available, offset);
-      memcpy (pv, &jffs2.rgbCache[offset], available);
-      cb -= available;
-      pv += available;
-      d->index += available;
-      cbRead += available;
-      state = 0;
-      continue;
+      memset (pv, 0, available);
     }
+    else if (inode_cache[f->node].compr == COMPRESSION_ZERO) {
+      jffs2.iFragment = i;
+      available = f->offset + f->size - index;
+      if (available > cb)
+	available = cb;
+      if (available > remain)
+	available = remain;
+      memset (pv, 0, available);
+    }
+    else if (f->offset == index && f->size <= cb && f->size <= remain
+	     && f->offset == inode_cache[f->node].offset
+	     && f->size == inode_cache[f->node].dsize
+	     && f->size <= BLOCK_SIZE_MAX
+	     && jffs2.iCache != f->node) {
+      int result;
 
-    for (i = find_cached_inode (jffs2.inode, index); i < cInodeCache; ++i) {
-      PRINTF ("%s: inode %d  i %d  offset %d  version %d  dsize %d\n",
-	      __FUNCTION__, jffs2.inode, i, inode_cache[i].offset,
-	      inode_cache[i].version, inode_cache[i].dsize);
-
-		/* *** FIXME: we may be able to simplify these checks
-			      since enhancing find_cached_inode (). */
-      if (inode_cache[i].ino != jffs2.inode)
-	return cbRead;		/* End of the file */
-      if (index < inode_cache[i].offset)
-	return cbRead;		/* Peculiar error condition, a hole? */
-      if (index >= inode_cache[i].offset + inode_cache[i].dsize)
-	continue;
+		/* Whole node requested, no need for the cache block */
+      jffs2.iFragment = i;
+      PRINTF ("%s: direct %d for index %d\n", __FUNCTION__, f->node, index);
+      result = jffs2_node_data (f->node, pv);
+      if (result)
+	return cbRead ? cbRead : result;
+      available = f->size;
+    }
+    else {
+      size_t offset;
 
-      PRINTF ("%s: decom'ing %d for index %d  offset %d\n",
-	      __FUNCTION__, i, index, inode_cache[i].offset);
+      jffs2.iFragment = i;
+      if (jffs2.iCache != f->node) {
+	int result;
 
-      result = jffs2_decompress_node (i); /* Decompress into the cache block */
-      if (result)
-	PRINTF ("%s: decompression returned %d\n", __FUNCTION__, result);
-      ++state;
-      break;
+	PRINTF ("%s: decom'ing %d for index %d  offset %d\n",
+		__FUNCTION__, f->node, index, inode_cache[f->node].offset);
+
+	result = jffs2_decompress_node (f->node);
+	if (result) {
+	  PRINTF ("%s: decompression returned %d\n", __FUNCTION__, result);
+	  return cbRead ? cbRead : result;
+	}
+      }
+
+      offset = index - jffs2.ibCache;
+      if (offset >= jffs2.cbCache)
+	return cbRead ? cbRead : ERROR_FAILURE;
+      available = f->offset + f->size - index;
+      if (available > jffs2.cbCache - offset)
+	available = jffs2.cbCache - offset;
+      if (available > cb)
+	available = cb;
+      if (available > remain)
+	available = remain;
+      PRINTF ("%s: available %d  offset %d\n",
+	      __FUNCTION__, available, offset);
+      memcpy (pv, &jffs2.rgbCache[offset], available);
     }
 
-    if (state == 0)
-      return ERROR_FAILURE;
+    cb -= available;
+    pv += available;
+    d->index += available;
+    cbRead += available;
   }
 
   return cbRead;
@@ -1002,6 +1881,22 @@ static int jffs2_info (struct descriptor_d* d)
 }
 #endif
 
+static int jffs2_query (struct descriptor_d* d, int index, void* pv)
+{
+  switch (index) {
+  default:
+    return ERROR_UNSUPPORTED;
+  case QUERY_IOSIZE:		/* Whole nodes read without the cache block */
+    *(unsigned long*) pv = BLOCK_SIZE_MAX;
+    break;
+  case QUERY_DEVICE:
+    *(struct descriptor_d**) pv = jffs2.fCached ? &jffs2.d : NULL;
+    break;
+  }
+
+  return 0;
+}
+
 static void jffs2_report (void)
 {
 }
@@ -1014,6 +1909,7 @@ static __driver_6 struct driver_d jffs2_driver = {
   .close = jffs2_close,
   .read = jffs2_read,
   .seek = seek_helper,
+  .query = jffs2_query,
 #if defined (CONFIG_CMD_INFO)
   .info = jffs2_info,
 #endif
@@ -218,7 +218,7 @@ static ssize_t memory_read (struct descriptor_d* d, void* pv, size_t cb)
      chip select must toggle for every access.  This is a lowest
      common denominator, and will tend to be pretty slow. */
     {
-      unsigned char* pbSrc = (unsigned char*) (unsigned) (d->start + d->index);
+      unsigned char* pbSrc = (unsigned char*) (unsigned long) (d->start + d->index);
       int i = cb;
       while (i--)
 	*(unsigned char*) pv = *pbSrc++, ++pv;
@@ -229,19 +229,19 @@ static ssize_t memory_read (struct descriptor_d* d, void* pv, size_t cb)
   case 2:
 //  case 4:
     /* memcpy performs an optimal copy, probably at machine word width */
-    memcpy (pv, (void*) (unsigned) (d->start + d->index), cb);
+    memcpy (pv, (void*) (unsigned long) (d->start + d->index), cb);
     break;
 
   case 4:
     if (((d->start + d->index) & 3)
 	|| ((unsigned long) pv & 3)
 	|| (cb & 3))
-      memcpy (pv, (void*) (unsigned) (d->start + d->index), cb);
+      memcpy (pv, (void*) (unsigned long) (d->start + d->index), cb);
     else {
-      unsigned long* plSrc = (unsigned long*) (unsigned) (d->start + d->index);
+      u32* plSrc = (u32*) (unsigned long) (d->start + d->index);
       int i = cb/4;
       while (i--)
-	*(unsigned long*) pv = *plSrc++, pv += 4;
+	*(u32*) pv = *plSrc++, pv += 4;
     }
     break;
   }
@@ -252,6 +252,25 @@ static ssize_t memory_read (struct descriptor_d* d, void* pv, size_t cb)
 }
 
 
+/** Map a memory region for direct access by the caller.  Descriptors
+    that request a specific access width are not mapped since the
+    caller cannot honor the width. */
+
+static ssize_t memory_map (struct descriptor_d* d, const void** ppv, size_t cb)
+{
+  if (d->width == 1 || d->width == 4)
+    return ERROR_UNSUPPORTED;
+
+  if (d->index + cb > d->length)
+    cb = d->length - d->index;
+
+  *ppv = (const void*) (unsigned long) (d->start + d->index);
+  d->index += cb;
+
+  return cb;
+}
+
+
 /** Write from a buffer into a memory region.  There are special cases
     for single byte, single aligned short, and single aligned word
     accesses.  Ideally, the width of the memory descriptor would
@@ -284,17 +303,17 @@ static ssize_t memory_write (struct descriptor_d* d, const void* pv, size_t cb)
 
   switch (cb) {
   case 1:
-    *(char*)           (unsigned) (d->start + d->index) = *(char*)           pv;
+    *(char*)           (unsigned long) (d->start + d->index) = *(char*)           pv;
     break;
   case 2:
-    *(unsigned short*) (unsigned) (d->start + d->index) = *(unsigned short*) pv;
+    *(unsigned short*) (unsigned long) (d->start + d->index) = *(unsigned short*) pv;
     break;
   case 4:
-    *(unsigned long*)  (unsigned) (d->start + d->index) = *(unsigned long*)  pv;
+    *(u32*)            (unsigned long) (d->start + d->index) = *(u32*)            pv;
     break;
   default:
   nonaligned:
-    memcpy ((void*) (unsigned) (d->start + d->index), pv, cb);
+    memcpy ((void*) (unsigned long) (d->start + d->index), pv, cb);
     break;
   }
 
@@ -312,6 +331,7 @@ static __driver_1 struct driver_d memory_driver = {
   .read        = memory_read,
   .write       = memory_write,
   .seek        = seek_helper,
+  .map         = memory_map,
 };
 
 static __service_4 struct service_d memory_service = {
@@ -39,11 +39,14 @@
 
    o Consecutive page writes.  The datasheet specifies that a page can
      only be partially written four times before requiring an erase.
-     Due to the fact that our buffer size is 512 bytes, we do exactly
-     this when we write to the array.  It may be desirable to up the
-     copy buffer size to 2k in order to minimize this stress on NAND
-     arrays.  Alternatively, a flush command could be added to the
-     driver to allow write-back behavior.
+     When the copy buffer was fixed at 512 bytes, we did exactly this
+     when we wrote to the array.  The driver now reports the page size
+     through QUERY_IOSIZE so that the copy code writes whole pages.
+
+   o Overlapped writes.  nand_write_start() loads the first page and
+     starts programming without waiting for the device.  nand_poll()
+     checks for completion and starts the next page.  This lets the
+     copy code read the next block of data while the array is busy.
 
 */
 
@@ -114,7 +117,8 @@ inline void nand_read_setup (unsigned long page, int index)
 
    writes data to the NAND array.  In this case, we don't use the tail
    argument because we don't need to write 0xff's through to the end
-   of the block to guarantee that those bytes won't be modified.
+   of the block to guarantee that those bytes won't be modified.  The
+   caller must wait for the program operation to complete.
 
 */
 
@@ -134,8 +138,6 @@ inline void nand_sequential_input (unsigned long page, unsigned long index,
     NAND_DATA = *((char*) pv++);
 
   NAND_CLE = NAND_PageProgramConfirm;
-
-  wait_on_busy ();
 }
 
 #endif
@@ -186,8 +188,6 @@ inline void nand_sequential_input (unsigned long page, unsigned long index,
     NAND_DATA = 0xff;
 
   NAND_CLE = NAND_AutoProgram;
-
-  wait_on_busy ();
 }
 
 #endif
@@ -339,6 +339,40 @@ static ssize_t nand_read (struct descriptor_d* d, void* pv, size_t cb)
   return cbRead;
 }
 
+/* nand_program
+
+   loads the data for one page, or the part of a page, at offset and
+   starts the program operation.  It returns the number of bytes
+   loaded.  The caller must wait for the device to finish programming
+   and check the status.
+
+*/
+
+static int nand_program (unsigned long offset, const void* pv, size_t cb)
+{
+  unsigned long page  = offset/chip->page_size;
+  unsigned long index = offset%chip->page_size;
+  int available = chip->page_size - index;
+  int tail;
+
+  if (available > cb)
+    available = cb;
+  /* A previous version of this code wrote to the end of the page,
+     including the auxiliary region.  This is no longer the case.
+     Now, we only write to the end of the data area.  */
+//  tail = 528 - index - available;
+  tail = chip->page_size - index - available;
+
+	/* Reset and read to perform I/O on the data region  */
+  NAND_CLE = NAND_Reset;
+  wait_on_busy ();
+
+//  printf ("seq %ld %ld %d %d\n", page, index, available, tail);
+  nand_sequential_input (page, index, available, tail, pv);
+
+  return available;
+}
+
 static ssize_t nand_write (struct descriptor_d* d, const void* pv, size_t cb)
 {
   int cbWrote = 0;
@@ -355,26 +389,11 @@ static ssize_t nand_write (struct descriptor_d* d, const void* pv, size_t cb)
   SPINNER_STEP;
 
   while (cb) {
-    unsigned long page  = (d->start + d->index)/chip->page_size;
-    unsigned long index = (d->start + d->index)%chip->page_size;
-    int available = chip->page_size - index;
-    int tail;
+    unsigned long offset = d->start + d->index;
+    int available = nand_program (offset, pv, cb);
 
-    if (available > cb)
-      available = cb;
-    /* A previous version of this code wrote to the end of the page,
-       including the auxiliary region.  This is no longer the case.
-       Now, we only write to the end of the data area.  */
-//    tail = 528 - index - available;
-    tail = chip->page_size - index - available;
-
-	/* Reset and read to perform I/O on the data region  */
-    NAND_CLE = NAND_Reset;
     wait_on_busy ();
 
-//    printf ("seq %ld %ld %d %d\n", page, index, available, tail);
-    nand_sequential_input (page, index, available, tail, pv);
-
     pv += available;
     d->index += available;
     cb -= available;
@@ -384,7 +403,7 @@ static ssize_t nand_write (struct descriptor_d* d, const void* pv, size_t cb)
 
     NAND_CLE = NAND_Status;
     if (NAND_DATA & NAND_Fail) {
-      printf ("Write failed at page %ld\n", page);
+      printf ("Write failed at page %ld\n", offset/chip->page_size);
       goto exit;
     }
   }
@@ -396,6 +415,98 @@ static ssize_t nand_write (struct descriptor_d* d, const void* pv, size_t cb)
   return cbWrote;
 }
 
+#if defined (CONFIG_REGION_COPY_PIPELINE)
+
+static struct {
+  const char* pv;		/* Data for the page being programmed */
+  unsigned long offset;		/* Device offset of the page */
+  size_t cb;			/* Bytes remaining, including this page */
+  int available;		/* Bytes in the page being programmed */
+} nand_pending;
+
+/* nand_write_start
+
+   starts an overlapped write.  The whole request is accepted and the
+   descriptor index advanced, but only the first page is programmed.
+   The caller must leave the data untouched and call nand_poll() until
+   it reports that the write is complete.
+
+*/
+
+static ssize_t nand_write_start (struct descriptor_d* d,
+                                 const void* pv, size_t cb)
+{
+  if (!chip)
+    return 0;
+
+  if (d->index + cb > d->length)
+    cb = d->length - d->index;
+  if (!cb)
+    return 0;
+
+  nand_pending.pv     = pv;
+  nand_pending.offset = d->start + d->index;
+  nand_pending.cb     = cb;
+  d->index += cb;
+
+  NAND_CS_ENABLE;
+  NAND_WP_DISABLE;
+  nand_pending.available = nand_program (nand_pending.offset, pv, cb);
+  NAND_CS_DISABLE;
+
+  return cb;
+}
+
+/* nand_poll
+
+   returns zero while an overlapped write is in progress and non-zero
+   when the device is ready for another write.  When one page
+   finishes, the next is started.
+
+*/
+
+static ssize_t nand_poll (struct descriptor_d* d, size_t cb)
+{
+  ssize_t result = 0;
+  unsigned char status;
+
+  if (!nand_pending.available)
+    return 1;
+
+  NAND_CS_ENABLE;
+  NAND_CLE = NAND_Status;
+  status = NAND_DATA;
+  if (!(status & NAND_Ready))
+    goto exit;
+
+  if (status & NAND_Fail) {
+    printf ("Write failed at page %ld\n", nand_pending.offset/chip->page_size);
+    nand_pending.available = 0;
+    NAND_WP_ENABLE;
+    result = ERROR_FAILURE;
+    goto exit;
+  }
+
+  nand_pending.pv     += nand_pending.available;
+  nand_pending.offset += nand_pending.available;
+  nand_pending.cb     -= nand_pending.available;
+  nand_pending.available = 0;
+
+  if (nand_pending.cb)
+    nand_pending.available = nand_program (nand_pending.offset,
+                                           nand_pending.pv, nand_pending.cb);
+  else {
+    NAND_WP_ENABLE;
+    result = 1;
+  }
+
+ exit:
+  NAND_CS_DISABLE;
+  return result;
+}
+
+#endif
+
 static void nand_erase (struct descriptor_d* d, size_t cb)
 {
   if (!chip)
@@ -479,6 +590,25 @@ static void nand_report (void)
 
 #endif
 
+static int nand_query (struct descriptor_d* d, int index, void* pv)
+{
+  if (!chip)
+    return ERROR_UNSUPPORTED;
+
+  switch (index) {
+  default:
+    return ERROR_UNSUPPORTED;
+  case QUERY_ERASEBLOCKSIZE:
+    *(unsigned long*)pv = chip->erase_size;
+    break;
+  case QUERY_IOSIZE:		/* Avoid partial page programming */
+    *(unsigned long*)pv = chip->page_size;
+    break;
+  }
+
+  return 0;
+}
+
 static __driver_3 struct driver_d nand_driver = {
   .name = "nand",
   .description = "NAND flash driver",
@@ -489,6 +619,11 @@ static __driver_3 struct driver_d nand_driver = {
   .write = nand_write,
   .erase = nand_erase,
   .seek = seek_helper,
+  .query = nand_query,
+#if defined (CONFIG_REGION_COPY_PIPELINE)
+  .write_start = nand_write_start,
+  .poll = nand_poll,
+#endif
 };
 
 static __service_6 struct service_d nand_service = {
@@ -125,6 +125,11 @@
      seen whether or not all type 2 flash will accept it.  This is the
      same behavior as we see in the Linux kernel driver.
 
+   o Mapped reads.  When neither USE_CACHE nor byte swapping is in
+     effect, the driver implements map() so that callers such as the
+     copy and checksum code can read the array in place.  This saves
+     a copy through a bounce buffer for every byte read from flash.
+
    o TopBoot/BottomBoot. Based on the Linux kernel driver, AMD PRI
      v1.0 doesn't report the location of the boot blocks.  This is
      important because the order of the reported erase regions does
@@ -156,6 +161,13 @@
 
 #define USE_DETECT_ENDIAN_MISMATCH
 
+/* Direct mapping of the array is only possible when reads need
+   neither the cache dance nor byte swapping. */
+#if !defined (USE_CACHE)\
+  && !(defined (NOR_BIGENDIAN) && defined (CONFIG_LITTLEENDIAN))
+# define USE_MAP
+#endif
+
 //#define TALK
 //#define NOISY                   /* Use when CFI not detecting properly */
 
@@ -856,132 +868,198 @@ static ssize_t nor_read (struct descriptor_d* d, void* pv, size_t cb)
 }
 
 
-#if defined (USE_BUFFERED_WRITE)
+#if defined (USE_MAP)
 
-/* nor_write
+/* nor_map
 
-   performs a buffered write to the flash device.  The unbuffered
-   write, below, is adequate but this version is much faster.  Like
-   the single short write method below, we fuss a bit with the
-   alignment so that we emit the data efficiently.  Moreover, we make
-   an attempt to align the write buffer to a write buffer aligned
-   boundary.
+   returns a pointer into the flash array so that the caller can read
+   it in place.  The window stops at the end of the first bank since
+   the banks need not be contiguous in the physical address space.
 
 */
 
-static ssize_t nor_write (struct descriptor_d* d, const void* pv, size_t cb)
+static ssize_t nor_map (struct descriptor_d* d, const void** ppv, size_t cb)
 {
-  size_t cbWrote = 0;
-  unsigned long pageLast = ~0;
-
-  if (!chip->writebuffer_size)
-    ERROR_RETURN (ERROR_UNSUPPORTED,
-		  "flash chip doesn't support buffered writes");
+  unsigned long index = d->start + d->index;
 
   if (d->index + cb > d->length)
     cb = d->length - d->index;
+  if (index < chip->total_size && index + cb > chip->total_size)
+    cb = chip->total_size - index;
+#if defined (NOR_1_PHYS)
+  if (index < NOR_0_LENGTH && index + cb > NOR_0_LENGTH)
+    cb = NOR_0_LENGTH - index;
+#endif
 
-  while (cb > 0) {
-    unsigned long index = d->start + d->index;
-    unsigned long page = index & ~ (nor_region (index)->size - 1);
-    unsigned short status;
-    int available
-      = chip->writebuffer_size - (index & (chip->writebuffer_size - 1));
+  index = phys_from_index (index);
+  WRITE_ONE (index, CMD (ReadArray));
+  *ppv = (const void*) index;
+  d->index += cb;
 
-    if (available > cb)
-      available = cb;
+  return cb;
+}
 
-    index = phys_from_index (index);
+#endif
 
-    PRINTF ("nor write: 0x%p 0x%08lx %d\n", pv, index, available);
 
-    vpen_enable ();
+#if defined (USE_BUFFERED_WRITE)
+
+/* nor_write_buffer
+
+   loads one write buffer's worth of data at the given index and
+   confirms the program operation.  It returns the number of bytes
+   sent to the device or an error if the device refused the program
+   command.  The caller waits for the program operation to complete
+   and must call vpen_disable () when it does.  Like the single short
+   write method below, we fuss a bit with the alignment so that we
+   emit the data efficiently.  Moreover, we make an attempt to align
+   the write buffer to a write buffer aligned boundary.
+
+*/
+
+static ssize_t nor_write_buffer (unsigned long index, const void* pv,
+				 size_t cb, unsigned long* pageLast)
+{
+  unsigned long page = index & ~ (nor_region (index)->size - 1);
+  unsigned short status;
+  int available
+    = chip->writebuffer_size - (index & (chip->writebuffer_size - 1));
+
+  if (available > cb)
+    available = cb;
+
+  index = phys_from_index (index);
+
+  PRINTF ("nor write: 0x%p 0x%08lx %d\n", pv, index, available);
+
+  vpen_enable ();
 
 #if !defined (NO_WRITE)
-    if (page != pageLast) {
-      status = nor_unlock_page (index);
-      if (status & (ProgramError | VPEN_Low | DeviceProtected))
-	goto fail;
-      pageLast = page;
-    }
+  if (page != *pageLast) {
+    status = nor_unlock_page (index);
+    if (status & (ProgramError | VPEN_Low | DeviceProtected))
+      goto fail;
+    *pageLast = page;
+  }
 #endif
 
 	/* === Initiate buffer write */
 
 #if defined (NO_WRITE)
-    printf ("  available %d  cb %d\n", available, cb);
-    printf ("0x%lx <= 0x%x\n", index & ~(NOR_BUS_WIDTH/8 - 1), ProgramBuffered);
+  printf ("  available %d  cb %d\n", available, cb);
+  printf ("0x%lx <= 0x%x\n", index & ~(NOR_BUS_WIDTH/8 - 1), ProgramBuffered);
 #else
-    WRITE_ONE (index & ~(NOR_BUS_WIDTH/8 - 1), ProgramBuffered);
+  WRITE_ONE (index & ~(NOR_BUS_WIDTH/8 - 1), ProgramBuffered);
 #endif
 
 #if !defined (NO_WRITE)
-    status = nor_status (index & ~(NOR_BUS_WIDTH/8 - 1));
-    if (!(status & Ready)) {
-      PRINTF ("nor_write failed program start 0x%lx (0x%x)\n",
-	      index & ~(NOR_BUS_WIDTH/8 - 1), status);
-      goto fail;
-    }
+  status = nor_status (index & ~(NOR_BUS_WIDTH/8 - 1));
+  if (!(status & Ready)) {
+    PRINTF ("nor_write failed program start 0x%lx (0x%x)\n",
+	    index & ~(NOR_BUS_WIDTH/8 - 1), status);
+    goto fail;
+  }
 #endif
 
 	/* === Send the extent of the write.  We optimize (though I
 	   don't really know why) if we don't need to write a whole
 	   full buffer. */
-    {
-      int av = available + (index & (NOR_BUS_WIDTH/8 - 1));
+  {
+    int av = available + (index & (NOR_BUS_WIDTH/8 - 1));
 #if defined (NO_WRITE)
-      printf ("0x%lx <= 0x%02x\n", index & ~(NOR_BUS_WIDTH/8 - 1),
-	      /* *** FIXME for 32 bit  */
-	      av - av/2 - 1);
+    printf ("0x%lx <= 0x%02x\n", index & ~(NOR_BUS_WIDTH/8 - 1),
+	    /* *** FIXME for 32 bit  */
+	    av - av/2 - 1);
 #else
-      WRITE_ONE (index & ~(NOR_BUS_WIDTH/8 - 1),
-	      /* *** FIXME for 32 bit  */
-		 av - av/2 - 1);
+    WRITE_ONE (index & ~(NOR_BUS_WIDTH/8 - 1),
+	       /* *** FIXME for 32 bit  */
+	       av - av/2 - 1);
 #endif
-    }
+  }
 
 	/* === Either write the data, because we're aligned (first
 	   case), or construct a buffer we can write because we're
 	   not. */
 
-    if (available == chip->writebuffer_size && ((unsigned long) pv & 1) == 0) {
-      int i;
-      for (i = 0; i < available; i += NOR_BUS_WIDTH/8) {
+  if (available == chip->writebuffer_size && ((unsigned long) pv & 1) == 0) {
+    int i;
+    for (i = 0; i < available; i += NOR_BUS_WIDTH/8) {
 #if defined (NO_WRITE)
-	printf ("0x%lx := 0x%04x\n", index + i,
-                ((nor_t*)pv)[i/(NOR_BUS_WIDTH/8)]);
+      printf ("0x%lx := 0x%04x\n", index + i,
+	      ((nor_t*)pv)[i/(NOR_BUS_WIDTH/8)]);
 #else
-	nor_t v = SWAP_ONE (((nor_t*)pv)[i/(NOR_BUS_WIDTH/8)]);
-	WRITE_ONE (index + i, v);
+      nor_t v = SWAP_ONE (((nor_t*)pv)[i/(NOR_BUS_WIDTH/8)]);
+      WRITE_ONE (index + i, v);
 #endif
-      }
     }
-    else {
-      int i;
-      char __aligned rgb[chip->writebuffer_size];
-		     /* Fill with FFs to mask the unwritten bytes */
-      memset (rgb, 0xff, chip->writebuffer_size);
-//      rgb[0] = 0xff;						/* First */
-//      rgb[((available + (index & 1) + 1)&~1) - 1] = 0xff;	/* Last */
-//      printf ("  last %ld\n", ((available + (index & 1) + 1)&~1) - 1);
-      memcpy (rgb + (index & (NOR_BUS_WIDTH/8 - 1)), pv, available);
-      for (i = 0; i < available + (index & 1); i += NOR_BUS_WIDTH/8) {
+  }
+  else {
+    int i;
+    char __aligned rgb[chip->writebuffer_size];
+		   /* Fill with FFs to mask the unwritten bytes */
+    memset (rgb, 0xff, chip->writebuffer_size);
+//    rgb[0] = 0xff;						/* First */
+//    rgb[((available + (index & 1) + 1)&~1) - 1] = 0xff;	/* Last */
+//    printf ("  last %ld\n", ((available + (index & 1) + 1)&~1) - 1);
+    memcpy (rgb + (index & (NOR_BUS_WIDTH/8 - 1)), pv, available);
+    for (i = 0; i < available + (index & 1); i += NOR_BUS_WIDTH/8) {
 #if defined (NO_WRITE)
-	printf ("0x%lx #= 0x%04x\n",
-		(index & ~(NOR_BUS_WIDTH/8 - 1)) + i,
-		((nor_t*)rgb)[i/(NOR_BUS_WIDTH/8)]);
+      printf ("0x%lx #= 0x%04x\n",
+	      (index & ~(NOR_BUS_WIDTH/8 - 1)) + i,
+	      ((nor_t*)rgb)[i/(NOR_BUS_WIDTH/8)]);
 #else
-	nor_t v = SWAP_ONE (((nor_t*)rgb)[i/(NOR_BUS_WIDTH/8)]);
-	WRITE_ONE ((index & ~(NOR_BUS_WIDTH/8 - 1)) + i, v);
+      nor_t v = SWAP_ONE (((nor_t*)rgb)[i/(NOR_BUS_WIDTH/8)]);
+      WRITE_ONE ((index & ~(NOR_BUS_WIDTH/8 - 1)) + i, v);
 #endif
-      }
     }
+  }
 
 #if defined (NO_WRITE)
-    printf ("0x%lx <= 0x%x\n", index & ~(NOR_BUS_WIDTH/8 - 1), ProgramConfirm);
+  printf ("0x%lx <= 0x%x\n", index & ~(NOR_BUS_WIDTH/8 - 1), ProgramConfirm);
 #else
-    WRITE_ONE (index & ~(NOR_BUS_WIDTH/8 - 1), ProgramConfirm);
+  WRITE_ONE (index & ~(NOR_BUS_WIDTH/8 - 1), ProgramConfirm);
+#endif
+
+  return available;
+
+#if !defined (NO_WRITE)
+ fail:
+  printf ("Program failed at 0x%p (%x)\n", (void*) index, status);
+  CLEAR_STATUS (index);
+  vpen_disable ();
+  return ERROR_FAILURE;
 #endif
+}
+
+
+/* nor_write
+
+   performs a buffered write to the flash device.  The unbuffered
+   write, below, is adequate but this version is much faster.
+
+*/
+
+static ssize_t nor_write (struct descriptor_d* d, const void* pv, size_t cb)
+{
+  size_t cbWrote = 0;
+  unsigned long pageLast = ~0;
+
+  if (!chip->writebuffer_size)
+    ERROR_RETURN (ERROR_UNSUPPORTED,
+		  "flash chip doesn't support buffered writes");
+
+  if (d->index + cb > d->length)
+    cb = d->length - d->index;
+
+  while (cb > 0) {
+    unsigned long index = phys_from_index (d->start + d->index);
+    unsigned short status;
+    ssize_t available = nor_write_buffer (d->start + d->index, pv, cb,
+					  &pageLast);
+
+    if (available < 0)
+      return cbWrote;
+
     SPINNER_STEP;
     status = nor_status (index);
 
@@ -991,7 +1069,6 @@ static ssize_t nor_write (struct descriptor_d* d, const void* pv, size_t cb)
 
 #if !defined (NO_WRITE)
     if (status & (ProgramError | VPEN_Low | DeviceProtected)) {
-    fail:
       printf ("Program failed at 0x%p (%x)\n", (void*) index, status);
       CLEAR_STATUS (index);
       return cbWrote;
@@ -1008,6 +1085,106 @@ static ssize_t nor_write (struct descriptor_d* d, const void* pv, size_t cb)
   return cbWrote;
 }
 
+#if defined (CONFIG_REGION_COPY_PIPELINE)
+
+static struct {
+  const char* pv;		/* Data for the buffer being programmed */
+  unsigned long index;		/* Index of the buffer */
+  size_t cb;			/* Bytes remaining, including this buffer */
+  ssize_t available;		/* Bytes in the buffer being programmed */
+  unsigned long pageLast;
+} nor_pending;
+
+/* nor_write_start
+
+   starts an overlapped write.  The whole request is accepted and the
+   descriptor index advanced, but only the first write buffer is sent
+   to the device.  nor_poll () sends the rest, one buffer at a time,
+   as the device becomes ready.
+
+*/
+
+static ssize_t nor_write_start (struct descriptor_d* d,
+				const void* pv, size_t cb)
+{
+  if (!chip->writebuffer_size)
+    ERROR_RETURN (ERROR_UNSUPPORTED,
+		  "flash chip doesn't support buffered writes");
+
+  if (d->index + cb > d->length)
+    cb = d->length - d->index;
+  if (!cb)
+    return 0;
+
+  nor_pending.pv       = pv;
+  nor_pending.index    = d->start + d->index;
+  nor_pending.cb       = cb;
+  nor_pending.pageLast = ~0;
+  nor_pending.available = nor_write_buffer (nor_pending.index, pv, cb,
+					    &nor_pending.pageLast);
+  if (nor_pending.available < 0) {
+    nor_pending.available = 0;
+    return ERROR_FAILURE;
+  }
+  d->index += cb;
+
+  return cb;
+}
+
+/* nor_poll
+
+   returns zero while an overlapped write is in progress and non-zero
+   when the device is ready for another write.  Each call that finds
+   the device ready sends the next write buffer.
+
+*/
+
+static ssize_t nor_poll (struct descriptor_d* d, size_t cb)
+{
+  unsigned long index;
+  unsigned long status;
+
+  if (!nor_pending.available)
+    return 1;
+
+  index = phys_from_index (nor_pending.index);
+  status = READ_ONE (index);
+  if ((status & STAT (Ready)) != STAT (Ready))
+    return 0;
+
+  vpen_disable ();
+
+#if !defined (NO_WRITE)
+  if (status & STAT (ProgramError | VPEN_Low | DeviceProtected)) {
+    printf ("Program failed at 0x%p (%lx)\n", (void*) index, status);
+    CLEAR_STATUS (index);
+    nor_pending.available = 0;
+    return ERROR_FAILURE;
+  }
+#endif
+
+  nor_pending.pv    += nor_pending.available;
+  nor_pending.index += nor_pending.available;
+  nor_pending.cb    -= nor_pending.available;
+  nor_pending.available = 0;
+
+  if (!nor_pending.cb)
+    return 1;
+
+  SPINNER_STEP;
+  nor_pending.available = nor_write_buffer (nor_pending.index,
+					    nor_pending.pv, nor_pending.cb,
+					    &nor_pending.pageLast);
+  if (nor_pending.available < 0) {
+    nor_pending.available = 0;
+    return ERROR_FAILURE;
+  }
+
+  return 0;
+}
+
+#endif
+
 #else
 
 /* nor_write
@@ -1159,6 +1336,11 @@ int nor_query (struct descriptor_d* d, int index, void* pv)
   case QUERY_ERASEBLOCKSIZE:
     *(unsigned long*)pv = nor_region (d->start + d->index)->size;
     break;
+#if defined (USE_BUFFERED_WRITE)
+  case QUERY_IOSIZE:
+    *(unsigned long*)pv = chip->writebuffer_size;
+    break;
+#endif
   }
 
   return 0;
@@ -1262,6 +1444,13 @@ static __driver_3 struct driver_d nor_driver = {
   .erase = nor_erase,
   .seek = seek_helper,
   .query = nor_query,
+#if defined (USE_MAP)
+  .map = nor_map,
+#endif
+#if defined (USE_BUFFERED_WRITE) && defined (CONFIG_REGION_COPY_PIPELINE)
+  .write_start = nor_write_start,
+  .poll = nor_poll,
+#endif
 };
 
 static __service_6 struct service_d cfi_nor_service = {
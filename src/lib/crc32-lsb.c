@@ -16,6 +16,12 @@
    the way that UBOOT performs the computation.  This version is built
    into the program when necessary.
 
+   Like compute_crc32, the table implementations use tables generated
+   at build time and fold aligned words into the CRC with
+   slicing-by-4 or slicing-by-8.  Words are read in little-endian
+   order since the LSB of the CRC corresponds to the first byte of
+   the data.
+
 */
 
 #undef  TALK
@@ -25,6 +31,15 @@
 #include <linux/types.h>
 #include <apex.h>
 #include <talk.h>
+#include <asm/byteorder.h>
+#include <crc32.h>
+
+#define IPOLY		(0xedb88320)
+
+#if CRC32_TABLE_ROWS > 0
+# include "crc32table-lsb.h"
+# define T(k,i)	(crc32table_lsb[k][i])
+#endif
 
 /** Compute CRC for UBOOT images.  UBOOT uses an LSB ordered CRC
     computation that is incompatible with the CRC calculations used
@@ -34,15 +49,49 @@
 
 uint32_t compute_crc32_lsb (uint32_t crc, const void* pv, int cb)
 {
-#define IPOLY		(0xedb88320)
-  unsigned char* pb = (unsigned char*) pv;
+  const unsigned char* pb = (const unsigned char*) pv;
+#if CRC32_TABLE_ROWS == 0
   uint32_t poly = IPOLY;	// Hack to get a register allocated
+#endif
 
   //  dumpw (pv, cb < 128 ? cb : 128, 0, 0);
   DBG (2, "%s: 0x%x * 0x%p + %d", __FUNCTION__, crc, pv, cb);
 
   crc = ~crc;                   // Invert because we're continuing
 
+#if CRC32_TABLE_ROWS > 1
+  for (; cb > 0 && ((unsigned long) pb & 3); --cb)
+    crc = T(0, (crc ^ *pb++) & 0xff) ^ (crc >> 8);
+
+  {
+    const uint32_t* pl = (const uint32_t*) pb;
+
+#if CRC32_TABLE_ROWS >= 8
+    for (; cb >= 8; cb -= 8) {
+      uint32_t a = crc ^ le32_to_cpu (pl[0]);
+      uint32_t b = le32_to_cpu (pl[1]);
+      pl += 2;
+      crc = T(7, a & 0xff) ^ T(6, (a >> 8) & 0xff)
+	^ T(5, (a >> 16) & 0xff) ^ T(4, a >> 24)
+	^ T(3, b & 0xff) ^ T(2, (b >> 8) & 0xff)
+	^ T(1, (b >> 16) & 0xff) ^ T(0, b >> 24);
+    }
+#endif
+
+    for (; cb >= 4; cb -= 4) {
+      crc ^= le32_to_cpu (*pl++);
+      crc = T(3, crc & 0xff) ^ T(2, (crc >> 8) & 0xff)
+	^ T(1, (crc >> 16) & 0xff) ^ T(0, crc >> 24);
+    }
+    pb = (const unsigned char*) pl;
+  }
+#endif
+
+#if CRC32_TABLE_ROWS > 0
+  while (cb-- > 0)
+    crc = T(0, (crc ^ *pb++) & 0xff) ^ (crc >> 8);
+#else
+
 #define DO_CRC\
   if (crc & 1) { crc >>= 1; crc ^= poly; }\
   else	       { crc >>= 1; }
@@ -59,9 +108,49 @@ uint32_t compute_crc32_lsb (uint32_t crc, const void* pv, int cb)
     DO_CRC;
     DO_CRC;
   }
+#endif
 
   DBG (2, " -> 0x%08x\n", ~crc);
 
   return ~crc;
 }
 
+/* multiply
+
+   returns the product of two polynomials modulo the CRC polynomial.
+   The bit order is reflected, bit 31 holds the coefficient of x^0.
+
+*/
+
+static uint32_t multiply (uint32_t a, uint32_t b)
+{
+  uint32_t p = 0;
+  uint32_t m;
+
+  for (m = 1U << 31; m; m >>= 1) {
+    if (a & m)
+      p ^= b;
+    b = (b & 1) ? (b >> 1) ^ IPOLY : b >> 1;
+  }
+  return p;
+}
+
+/** Combine LSB order CRCs.  Given crc1 over a first sequence and
+    crc2 over a second sequence of cb2 bytes, both computed with
+    compute_crc32_lsb starting from zero, return the CRC of the two
+    sequences concatenated.  The pre and post inversion cancel, so
+    this is the same shift of crc1 by x^(8*cb2) used for the MSB
+    CRC. */
+
+uint32_t crc32_combine_lsb (uint32_t crc1, uint32_t crc2, size_t cb2)
+{
+  uint32_t x = 1U << (31 - 8);	/* x^8, a one byte shift */
+  uint32_t shift = 1U << 31;	/* x^0 */
+
+  for (; cb2; cb2 >>= 1) {
+    if (cb2 & 1)
+      shift = multiply (shift, x);
+    x = multiply (x, x);
+  }
+  return multiply (crc1, shift) ^ crc2;
+}
@@ -116,8 +116,8 @@ extern char APEX_ENV_END[];
 #define ENV_ID(m)	((int)((m) & 0x7f))
 #define ENV_END		(0xff)
 #define ENV_IS_DELETED(m) (((m) & ENV_MASK_DELETED) == ENV_VAL_DELETED)
-#define C_ENV_KEYS	(((unsigned int) APEX_ENV_END \
-			- (unsigned int) APEX_ENV_START)\
+#define C_ENV_KEYS	(((unsigned long) APEX_ENV_END \
+			- (unsigned long) APEX_ENV_START)\
 			/sizeof (struct env_d))
 #define ENVLIST(i)	(((struct env_d*) APEX_ENV_START)[i])
 
@@ -391,7 +391,7 @@ static int _env_fetch (const char* szKey, const char** pszValue)
 void* env_enumerate (void* pv, const char** pszKey,
 		     const char** pszValue, int* pfDefault)
 {
-  int i = (int) pv + 1;
+  int i = (unsigned long) pv + 1;
 
   if (i - 1 >= C_ENV_KEYS)
     return 0;
@@ -405,7 +405,7 @@ void* env_enumerate (void* pv, const char** pszKey,
   else
     *pfDefault = 0;
 
-  return (void*) i;
+  return (void*) (unsigned long) i;
 }
 
 
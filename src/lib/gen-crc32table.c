@@ -0,0 +1,110 @@
+/* gen-crc32table.c
+
+   written by agent
+   16 Oct 2026
+
+   Copyright (C) 2026 agent
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   version 2 as published by the Free Software Foundation.
+   Please refer to the file debian/copyright for further details.
+
+   -----------
+   DESCRIPTION
+   -----------
+
+   Host program that writes the CRC32 lookup tables to stdout as a C
+   header.  The argument selects the bit order, msb for the cksum
+   compatible forward CRC in crc32.c or lsb for the reflected CRC in
+   crc32-lsb.c.
+
+   Eight rows are written.  Row zero is the ordinary byte table.  Row
+   k gives the CRC contribution of a byte followed by k zero bytes so
+   that several bytes can be folded into the CRC at once.  The
+   including file defines CRC32_TABLE_ROWS to keep only the rows it
+   uses.
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#define POLY		(0x04c11db7)
+#define IPOLY		(0xedb88320)
+#define ROWS		(8)
+
+static unsigned int table[ROWS][256];
+
+static void generate_msb (void)
+{
+  int i;
+  int k;
+
+  for (i = 0; i < 256; ++i) {
+    unsigned int crc = i << 24;
+    int bit;
+    for (bit = 8; bit--; )
+      crc = (crc & 0x80000000) ? (crc << 1) ^ POLY : crc << 1;
+    table[0][i] = crc;
+  }
+
+  for (k = 1; k < ROWS; ++k)
+    for (i = 0; i < 256; ++i)
+      table[k][i] = (table[k - 1][i] << 8)
+	^ table[0][table[k - 1][i] >> 24];
+}
+
+static void generate_lsb (void)
+{
+  int i;
+  int k;
+
+  for (i = 0; i < 256; ++i) {
+    unsigned int crc = i;
+    int bit;
+    for (bit = 8; bit--; )
+      crc = (crc & 1) ? (crc >> 1) ^ IPOLY : crc >> 1;
+    table[0][i] = crc;
+  }
+
+  for (k = 1; k < ROWS; ++k)
+    for (i = 0; i < 256; ++i)
+      table[k][i] = (table[k - 1][i] >> 8)
+	^ table[0][table[k - 1][i] & 0xff];
+}
+
+int main (int argc, char** argv)
+{
+  const char* szOrder = argc > 1 ? argv[1] : "";
+  int i;
+  int k;
+
+  if (strcmp (szOrder, "msb") == 0)
+    generate_msb ();
+  else if (strcmp (szOrder, "lsb") == 0)
+    generate_lsb ();
+  else {
+    fprintf (stderr, "usage: gen-crc32table msb|lsb\n");
+    return 1;
+  }
+
+  printf ("/* crc32table-%s.h\n\n"
+	  "   Generated by gen-crc32table.  Do not edit.\n\n*/\n\n",
+	  szOrder);
+  printf ("static const uint32_t crc32table_%s[CRC32_TABLE_ROWS][256] = {\n",
+	  szOrder);
+  for (k = 0; k < ROWS; ++k) {
+    if (k)
+      printf ("#if CRC32_TABLE_ROWS > %d\n", k);
+    printf ("  {");
+    for (i = 0; i < 256; ++i)
+      printf ("%s0x%08x,", (i%6) ? " " : "\n    ", table[k][i]);
+    printf ("\n  },\n");
+    if (k)
+      printf ("#endif\n");
+  }
+  printf ("};\n");
+
+  return 0;
+}
@@ -0,0 +1,771 @@
+/* inflate.c
+
+   written by agent
+   16 Oct 2026
+
+   Copyright (C) 2026 agent
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   version 2 as published by the Free Software Foundation.
+   Please refer to the file debian/copyright for further details.
+
+   -----------
+   DESCRIPTION
+   -----------
+
+   Deflate decompression, RFC 1951, into a contiguous buffer.
+
+   o Window
+
+     Back references are copied from the output buffer itself.  There
+     is no sliding window and no copy of the output.  This is why the
+     whole stream must be inflated into one buffer.
+
+   o Decoding tables
+
+     Huffman codes are decoded by table lookup.  Codes of up to 9
+     bits for literals and lengths, and 6 bits for distances, are
+     decoded with one lookup.  Longer codes link from the root table
+     to a second level table.  The worst case sizes of the tables,
+     852 and 592 entries, are those computed by the enough program of
+     zlib.  Dynamic tables are built in one static array.  The fixed
+     tables are built once on first use.
+
+   o Bit buffer
+
+     The bit buffer is an unsigned long.  The fast loop runs while
+     there is enough input and output that no checks are needed for a
+     whole literal or match.  It refills the bit buffer a byte at a
+     time until it is full, so on a 32 bit target a refill gives
+     room for a length code and its extra bits.  Distances may need a
+     second refill.  Near the end of the input or output buffers,
+     symbols are decoded one at a time with every read checked, and
+     the fill callback is called for more input.
+
+*/
+
+#include <config.h>
+#include <apex.h>
+#include <linux/string.h>
+#include <inflate.h>
+#include <crc32.h>
+
+#define ROOT_CODES	(7)		/* Root bits for code length codes */
+#define ROOT_LENS	(9)		/* Root bits for literal/length codes */
+#define ROOT_DISTS	(6)		/* Root bits for distance codes */
+#define ENOUGH_LENS	(852)
+#define ENOUGH_DISTS	(592)
+#define ENOUGH		(ENOUGH_LENS + ENOUGH_DISTS)
+
+#define HOLD_BITS	(8*sizeof (unsigned long))
+#define IN_MARGIN	(3*sizeof (unsigned long)) /* Most bytes per symbol */
+#define OUT_MARGIN	(258)		/* Longest match */
+
+#define ADLER_BASE	(65521)
+#define ADLER_NMAX	(5552)
+
+	/* Table entry operations */
+enum {
+  opLiteral	= 0x00,		/* val is the literal */
+  opBase	= 0x10,		/* val is a base, low bits are extra bits */
+  opLink	= 0x20,		/* val is a subtable, low bits are its bits */
+  opEnd		= 0x40,		/* End of block */
+  opInvalid	= 0x80,
+};
+
+enum {
+  tableCodes,
+  tableLens,
+  tableDists,
+};
+
+struct code {
+  unsigned char op;
+  unsigned char bits;		/* Bits consumed by this entry */
+  unsigned short val;
+};
+
+static const unsigned short length_base[29] = {
+  3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const unsigned char length_extra[29] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+  3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const unsigned short dist_base[30] = {
+  1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+  257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+  8193, 12289, 16385, 24577 };
+static const unsigned char dist_extra[30] = {
+  0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+  7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+static const unsigned char code_order[19] = {
+  16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+static struct code codes[ENOUGH];	/* Dynamic block tables */
+static struct code fixed[512 + 32];	/* Fixed block tables */
+static int fFixed;
+
+
+static struct code make_code (int type, unsigned sym, unsigned bits)
+{
+  struct code c = { opInvalid, bits, 0 };
+
+  switch (type) {
+  case tableCodes:
+    c.op = opLiteral;
+    c.val = sym;
+    break;
+  case tableLens:
+    if (sym < 256) {
+      c.op = opLiteral;
+      c.val = sym;
+    }
+    else if (sym == 256)
+      c.op = opEnd;
+    else if (sym < 286) {
+      c.op = opBase | length_extra[sym - 257];
+      c.val = length_base[sym - 257];
+    }
+    break;
+  case tableDists:
+    if (sym < 30) {
+      c.op = opBase | dist_extra[sym];
+      c.val = dist_base[sym];
+    }
+    break;
+  }
+  return c;
+}
+
+
+/** build_table builds the decoding table for the n code lengths in
+    lens.  The table has a root table of 1<<root entries followed by
+    the second level tables.  The return value is the number of
+    entries used or -1 when the lengths are not a valid code or the
+    table would need more than cMax entries.  Incomplete codes are
+    accepted only when they have a single one bit code, as zlib
+    does. */
+
+static int build_table (const unsigned char* lens, unsigned n, int type,
+                        struct code* table, unsigned root, unsigned cMax)
+{
+  unsigned short count[16];
+  unsigned short offs[16];
+  unsigned short sorted[288];
+  struct code invalid = { opInvalid, 1, 0 };
+  struct code* sub = NULL;
+  unsigned sym, len, max, used, code, low, curr, prev, i, k;
+  unsigned cCodes;
+  int left;
+
+  memset (count, 0, sizeof (count));
+  for (sym = 0; sym < n; ++sym)
+    ++count[lens[sym]];
+  for (max = 15; max > 0 && !count[max]; --max)
+    ;
+  cCodes = n - count[0];
+
+  used = 1 << root;
+  for (i = 0; i < used; ++i)
+    table[i] = invalid;
+  if (max == 0)
+    return used;		/* No codes, e.g. no distances */
+
+  left = 1;
+  for (len = 1; len <= 15; ++len) {
+    left <<= 1;
+    left -= count[len];
+    if (left < 0)
+      return -1;		/* Over-subscribed */
+  }
+  if (left > 0 && (type == tableCodes || max != 1))
+    return -1;			/* Incomplete */
+
+  offs[1] = 0;
+  for (len = 1; len < 15; ++len)
+    offs[len + 1] = offs[len] + count[len];
+  for (sym = 0; sym < n; ++sym)
+    if (lens[sym])
+      sorted[offs[lens[sym]]++] = sym;
+
+  code = 0;
+  prev = 0;
+  low = ~0;
+  curr = 0;
+  for (i = 0; i < cCodes; ++i) {
+    unsigned rev = 0;
+    struct code c;
+
+    sym = sorted[i];
+    len = lens[sym];
+    code <<= len - prev;
+    prev = len;
+    for (k = 0; k < len; ++k)	/* Deflate sends codes LSB first */
+      rev |= ((code >> k) & 1) << (len - 1 - k);
+
+    if (len <= root) {
+      c = make_code (type, sym, len);
+      for (k = rev; k < (1U << root); k += 1U << len)
+        table[k] = c;
+    }
+    else {
+      if ((rev & ((1U << root) - 1)) != low) {
+        low = rev & ((1U << root) - 1);
+        curr = len - root;	/* Size the subtable for remaining codes */
+        left = 1 << curr;
+        while (curr + root < max) {
+          left -= count[curr + root];
+          if (left <= 0)
+            break;
+          ++curr;
+          left <<= 1;
+        }
+        if (used + (1U << curr) > cMax)
+          return -1;
+        sub = table + used;
+        for (k = 0; k < (1U << curr); ++k)
+          sub[k] = invalid;
+        table[low].op = opLink | curr;
+        table[low].bits = root;
+        table[low].val = used;
+        used += 1 << curr;
+      }
+      c = make_code (type, sym, len - root);
+      for (k = rev >> root; k < (1U << curr); k += 1U << (len - root))
+        sub[k] = c;
+    }
+    --count[len];
+    ++code;
+  }
+
+  return used;
+}
+
+static void build_fixed (void)
+{
+  unsigned char lens[288];
+
+  memset (lens +   0, 8, 144);
+  memset (lens + 144, 9, 112);
+  memset (lens + 256, 7,  24);
+  memset (lens + 280, 8,   8);
+  build_table (lens, 288, tableLens, fixed, 9, 512);
+  memset (lens, 5, 32);
+  build_table (lens, 32, tableDists, fixed + 512, 5, 32);
+  fFixed = 1;
+}
+
+static unsigned long adler32 (unsigned long adler,
+                              const unsigned char* pb, size_t cb)
+{
+  unsigned long a = adler & 0xffff;
+  unsigned long b = adler >> 16;
+
+  while (cb) {
+    size_t c = cb < ADLER_NMAX ? cb : ADLER_NMAX;
+    cb -= c;
+    while (c--) {
+      a += *pb++;
+      b += a;
+    }
+    a %= ADLER_BASE;
+    b %= ADLER_BASE;
+  }
+  return (b << 16) | a;
+}
+
+/** update_check adds the output written since the last update, up
+    to op, to the running check.  It is called while the output is
+    still fresh in the cache: at the end of each block and before each
+    call for more input. */
+
+static void update_check (struct inflate_d* inf, const unsigned char* op)
+{
+  const unsigned char* pb = inf->out + inf->ibCheck;
+  size_t cb = op - pb;
+
+  if (!cb)
+    return;
+  inf->ibCheck += cb;
+
+  switch (inf->check) {
+  case INFLATE_CHECK_ADLER32:
+    inf->checksum = adler32 (inf->checksum, pb, cb);
+    break;
+#if defined (CONFIG_CRC32_LSB)
+  case INFLATE_CHECK_CRC32:
+    inf->checksum = compute_crc32_lsb (inf->checksum, pb, cb);
+    break;
+#endif
+  }
+}
+
+static int more_input (struct inflate_d* inf)
+{
+  update_check (inf, inf->out + inf->total_out);
+  return inf->fill && inf->fill (inf) > 0 && inf->avail_in;
+}
+
+static inline unsigned char* copy_match (unsigned char* op, size_t dist,
+                                         unsigned len)
+{
+  const unsigned char* from = op - dist;
+
+  if (len >= 32 && dist >= len) {
+    memcpy (op, from, len);
+    return op + len;
+  }
+
+	/* Overlapping copies, e.g. runs, must go forward a byte at a time */
+  while (len > 2) {
+    op[0] = from[0];
+    op[1] = from[1];
+    op[2] = from[2];
+    op += 3;
+    from += 3;
+    len -= 3;
+  }
+  while (len--)
+    *op++ = *from++;
+  return op;
+}
+
+#define SYNC \
+  inf->next_in = in; inf->avail_in = in_end - in; \
+  inf->hold = hold; inf->bits = bits; inf->total_out = op - out
+#define LOAD \
+  in = inf->next_in; in_end = in + inf->avail_in
+
+#define PULLBYTE \
+  do {								\
+    if (in == in_end) {						\
+      SYNC;							\
+      if (!more_input (inf))					\
+        goto input_error;					\
+      LOAD;							\
+    }								\
+    hold |= (unsigned long) *in++ << bits;			\
+    bits += 8;							\
+  } while (0)
+#define NEEDBITS(n) \
+  while (bits < (unsigned) (n)) PULLBYTE
+#define REFILL \
+  while (bits <= HOLD_BITS - 8) {				\
+    hold |= (unsigned long) *in++ << bits;			\
+    bits += 8;							\
+  }
+#define BITS(n) \
+  ((unsigned) hold & ((1U << (n)) - 1))
+#define DROP(n) \
+  do { hold >>= (n); bits -= (n); } while (0)
+
+
+/** inflate_init prepares to inflate a stream into the cbOut bytes
+    at out.  The caller sets the input fields afterwards. */
+
+void inflate_init (struct inflate_d* inf, void* out, size_t cbOut)
+{
+  memset (inf, 0, sizeof (*inf));
+  inf->out = out;
+  inf->cbOut = cbOut;
+}
+
+
+/** inflate_raw inflates a raw deflate stream.  The output is written
+    after any output already in the buffer.  On return, the bit
+    buffer holds the whole bytes read past the end of the stream.
+    The result is INFLATE_OK or one of the INFLATE_E_ codes. */
+
+int inflate_raw (struct inflate_d* inf)
+{
+  const unsigned char* in;
+  const unsigned char* in_end;
+  unsigned char* const out = inf->out;
+  unsigned char* op = out + inf->total_out;
+  unsigned char* const out_end = out + inf->cbOut;
+  unsigned long hold = inf->hold;
+  unsigned bits = inf->bits;
+  const struct code* lcode;
+  const struct code* dcode;
+  unsigned lbits;
+  unsigned dbits;
+  struct code here;
+  unsigned len;
+  unsigned extra;
+  size_t dist;
+  int last;
+  int result = INFLATE_OK;
+
+  LOAD;
+
+  do {
+    update_check (inf, op);
+    NEEDBITS (3);
+    last = BITS (1);
+    DROP (1);
+
+    switch (BITS (2)) {
+
+    case 0:			/* Stored */
+      DROP (2);
+      DROP (bits & 7);
+      NEEDBITS (32);
+      len = BITS (16);
+      DROP (16);
+      if (len != (~BITS (16) & 0xffff))
+        goto data_error;
+      DROP (16);
+      if (len > (size_t) (out_end - op))
+        goto output_error;
+      for (; len && bits; --len) {
+        *op++ = BITS (8);
+        DROP (8);
+      }
+      while (len) {
+        unsigned cb;
+        if (in == in_end) {
+          SYNC;
+          if (!more_input (inf))
+            goto input_error;
+          LOAD;
+        }
+        cb = (size_t) (in_end - in) < len ? in_end - in : len;
+        memcpy (op, in, cb);
+        op += cb;
+        in += cb;
+        len -= cb;
+      }
+      continue;
+
+    case 1:			/* Fixed Huffman codes */
+      DROP (2);
+      if (!fFixed)
+        build_fixed ();
+      lcode = fixed;
+      dcode = fixed + 512;
+      lbits = 9;
+      dbits = 5;
+      break;
+
+    case 2:			/* Dynamic Huffman codes */
+      {
+        unsigned char lens[286 + 30];
+        unsigned nlen, ndist, ncode;
+        unsigned i;
+        int used;
+
+        DROP (2);
+        NEEDBITS (14);
+        nlen = BITS (5) + 257;
+        DROP (5);
+        ndist = BITS (5) + 1;
+        DROP (5);
+        ncode = BITS (4) + 4;
+        DROP (4);
+        if (nlen > 286 || ndist > 30)
+          goto data_error;
+
+        for (i = 0; i < ncode; ++i) {
+          NEEDBITS (3);
+          lens[code_order[i]] = BITS (3);
+          DROP (3);
+        }
+        for (; i < 19; ++i)
+          lens[code_order[i]] = 0;
+        if (build_table (lens, 19, tableCodes, codes, ROOT_CODES, ENOUGH) < 0)
+          goto data_error;
+
+        for (i = 0; i < nlen + ndist; ) {
+          unsigned rep;
+          unsigned char v = 0;
+
+          for (;;) {
+            here = codes[BITS (ROOT_CODES)];
+            if (here.bits <= bits)
+              break;
+            PULLBYTE;
+          }
+          if (here.op != opLiteral)
+            goto data_error;
+          DROP (here.bits);
+
+          if (here.val < 16) {
+            lens[i++] = here.val;
+            continue;
+          }
+          if (here.val == 16) {
+            if (i == 0)
+              goto data_error;
+            v = lens[i - 1];
+            NEEDBITS (2);
+            rep = 3 + BITS (2);
+            DROP (2);
+          }
+          else if (here.val == 17) {
+            NEEDBITS (3);
+            rep = 3 + BITS (3);
+            DROP (3);
+          }
+          else {
+            NEEDBITS (7);
+            rep = 11 + BITS (7);
+            DROP (7);
+          }
+          if (i + rep > nlen + ndist)
+            goto data_error;
+          while (rep--)
+            lens[i++] = v;
+        }
+        if (lens[256] == 0)
+          goto data_error;	/* No end of block code */
+
+        used = build_table (lens, nlen, tableLens, codes,
+                            ROOT_LENS, ENOUGH_LENS);
+        if (used < 0
+            || build_table (lens + nlen, ndist, tableDists, codes + used,
+                            ROOT_DISTS, ENOUGH - used) < 0)
+          goto data_error;
+        lcode = codes;
+        dcode = codes + used;
+        lbits = ROOT_LENS;
+        dbits = ROOT_DISTS;
+      }
+      break;
+
+    default:
+      goto data_error;
+    }
+
+    for (;;) {
+
+		/* Fast loop, no input or output checks */
+      while ((size_t) (in_end - in) >= IN_MARGIN
+             && out_end - op >= OUT_MARGIN) {
+        REFILL;
+        here = lcode[BITS (lbits)];
+        if (here.op & opLink) {
+          DROP (here.bits);
+          here = lcode[here.val + BITS (here.op & 15)];
+        }
+        DROP (here.bits);
+        if (here.op == opLiteral) {
+          *op++ = here.val;
+          continue;
+        }
+        if (here.op & opEnd)
+          goto block_done;
+        if (!(here.op & opBase))
+          goto data_error;
+        extra = here.op & 15;
+        len = here.val + BITS (extra);
+        DROP (extra);
+
+        if (bits < 15)
+          REFILL;
+        here = dcode[BITS (dbits)];
+        if (here.op & opLink) {
+          DROP (here.bits);
+          here = dcode[here.val + BITS (here.op & 15)];
+        }
+        DROP (here.bits);
+        if (!(here.op & opBase))
+          goto data_error;
+        extra = here.op & 15;
+        if (bits < extra)
+          REFILL;
+        dist = here.val + BITS (extra);
+        DROP (extra);
+        if (dist > (size_t) (op - out))
+          goto data_error;	/* Distance too far back */
+        op = copy_match (op, dist, len);
+      }
+
+		/* One symbol with checks */
+      for (;;) {
+        here = lcode[BITS (lbits)];
+        if (here.bits <= bits)
+          break;
+        PULLBYTE;
+      }
+      if (here.op & opLink) {
+        struct code root = here;
+        for (;;) {
+          here = lcode[root.val
+                       + ((unsigned) (hold >> root.bits)
+                          & ((1U << (root.op & 15)) - 1))];
+          if (root.bits + here.bits <= bits)
+            break;
+          PULLBYTE;
+        }
+        DROP (root.bits);
+      }
+      DROP (here.bits);
+      if (here.op == opLiteral) {
+        if (op == out_end)
+          goto output_error;
+        *op++ = here.val;
+        continue;
+      }
+      if (here.op & opEnd)
+        break;
+      if (!(here.op & opBase))
+        goto data_error;
+      extra = here.op & 15;
+      NEEDBITS (extra);
+      len = here.val + BITS (extra);
+      DROP (extra);
+
+      for (;;) {
+        here = dcode[BITS (dbits)];
+        if (here.bits <= bits)
+          break;
+        PULLBYTE;
+      }
+      if (here.op & opLink) {
+        struct code root = here;
+        for (;;) {
+          here = dcode[root.val
+                       + ((unsigned) (hold >> root.bits)
+                          & ((1U << (root.op & 15)) - 1))];
+          if (root.bits + here.bits <= bits)
+            break;
+          PULLBYTE;
+        }
+        DROP (root.bits);
+      }
+      DROP (here.bits);
+      if (!(here.op & opBase))
+        goto data_error;
+      extra = here.op & 15;
+      NEEDBITS (extra);
+      dist = here.val + BITS (extra);
+      DROP (extra);
+      if (dist > (size_t) (op - out))
+        goto data_error;
+      if (len > (size_t) (out_end - op))
+        goto output_error;
+      op = copy_match (op, dist, len);
+    }
+  block_done:
+    ;
+  } while (!last);
+
+  goto done;
+
+ data_error:
+  result = INFLATE_E_DATA;
+  goto done;
+
+ output_error:
+  result = INFLATE_E_OUTPUT;
+  goto done;
+
+ input_error:
+  return INFLATE_E_INPUT;	/* State was saved before the fill */
+
+ done:
+  SYNC;
+  update_check (inf, op);
+  return result;
+}
+
+
+static int next_byte (struct inflate_d* inf)
+{
+  int b;
+
+  if (inf->bits >= 8) {
+    b = inf->hold & 0xff;
+    inf->hold >>= 8;
+    inf->bits -= 8;
+    return b;
+  }
+  if (!inf->avail_in && !more_input (inf))
+    return -1;
+  --inf->avail_in;
+  return *inf->next_in++;
+}
+
+/** read_trailer discards the bits to the next byte boundary and
+    reads the cb bytes of a stream trailer into rgb.  The return value
+    is INFLATE_OK or INFLATE_E_INPUT. */
+
+static int read_trailer (struct inflate_d* inf, unsigned char* rgb, int cb)
+{
+  inf->hold >>= inf->bits & 7;
+  inf->bits &= ~7;
+  while (cb--) {
+    int b = next_byte (inf);
+    if (b < 0)
+      return INFLATE_E_INPUT;
+    *rgb++ = b;
+  }
+  return INFLATE_OK;
+}
+
+
+/** inflate_zlib inflates a zlib stream, RFC 1950, and checks the
+    Adler-32 of the output.  Streams that need a preset dictionary are
+    rejected. */
+
+int inflate_zlib (struct inflate_d* inf)
+{
+  unsigned char rgb[4];
+  int cmf = next_byte (inf);
+  int flg = next_byte (inf);
+  int result;
+
+  if (cmf < 0 || flg < 0)
+    return INFLATE_E_INPUT;
+  if ((cmf & 0xf) != 8 || (cmf >> 4) > 7
+      || ((cmf << 8) | flg) % 31 || (flg & 0x20))
+    return INFLATE_E_DATA;
+
+  inf->check = INFLATE_CHECK_ADLER32;
+  inf->checksum = 1;
+  inf->ibCheck = inf->total_out;
+
+  result = inflate_raw (inf);
+  if (result == INFLATE_OK)
+    result = read_trailer (inf, rgb, sizeof (rgb));
+  if (result != INFLATE_OK)
+    return result;
+
+  return inf->checksum == (((unsigned long) rgb[0] << 24) | (rgb[1] << 16)
+                           | (rgb[2] << 8) | rgb[3])
+    ? INFLATE_OK : INFLATE_E_CHECK;
+}
+
+
+#if defined (CONFIG_CRC32_LSB)
+
+/** inflate_gzip inflates the deflate data of a gzip member, RFC 1952,
+    and checks the CRC32 and length of the output against the member
+    trailer.  The caller has already consumed the member header. */
+
+int inflate_gzip (struct inflate_d* inf)
+{
+  unsigned char rgb[8];
+  size_t ibStart = inf->total_out;
+  int result;
+
+  inf->check = INFLATE_CHECK_CRC32;
+  inf->checksum = 0;
+  inf->ibCheck = ibStart;
+
+  result = inflate_raw (inf);
+  if (result == INFLATE_OK)
+    result = read_trailer (inf, rgb, sizeof (rgb));
+  if (result != INFLATE_OK)
+    return result;
+
+  return inf->checksum == (rgb[0] | (rgb[1] << 8) | (rgb[2] << 16)
+                           | ((unsigned long) rgb[3] << 24))
+    && (u32) (inf->total_out - ibStart) == (rgb[4] | (rgb[5] << 8)
+                                            | (rgb[6] << 16)
+                                            | ((u32) rgb[7] << 24))
+    ? INFLATE_OK : INFLATE_E_CHECK;
+}
+
+#endif
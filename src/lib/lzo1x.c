@@ -0,0 +1,219 @@
+/* lzo1x.c
+
+   written by agent
+   16 Oct 2026
+
+   Copyright (C) 2026 agent
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   version 2 as published by the Free Software Foundation.
+   Please refer to the file debian/copyright for further details.
+
+   -----------
+   DESCRIPTION
+   -----------
+
+   LZO1X decompression.  The stream is a sequence of literal runs and
+   back references.  Each instruction byte selects one of four match
+   encodings by its magnitude.
+
+     0-15     literal run, or a short match after literals
+     16-31    M4, offsets from 16KiB to 48KiB
+     32-63    M3, offsets up to 16KiB
+     64-255   M2, short matches with offsets up to 2KiB
+
+   The two low bits of the last offset byte of a match give the number
+   of literals, zero to three, that follow the match.  Zero means that
+   the next instruction starts a literal run.  An M4 match with a zero
+   offset marks the end of the stream.  Lengths that don't fit in the
+   instruction are extended with zero bytes, each adding 255, and a
+   final non-zero byte.
+
+   Every read of the source and every write of the destination is
+   checked, so corrupt data cannot overrun either buffer.  The
+   LZO_SMALL configuration copies literals and matches a byte at a
+   time instead of using memcpy.
+
+*/
+
+#include <config.h>
+#include <apex.h>
+#include <linux/string.h>
+#include <lzo.h>
+
+#define M2_MAX_OFFSET	(0x0800)
+#define M4_BASE_OFFSET	(0x4000)
+
+#define NEED_IP(n) \
+  if ((size_t) (ip_end - ip) < (size_t) (n)) goto input_overrun
+#define NEED_OP(n) \
+  if ((size_t) (op_end - op) < (size_t) (n)) goto output_overrun
+#define TEST_LB(off) \
+  if ((off) > (size_t) (op - out)) goto lookbehind_overrun
+
+	/* Extend a length with zero bytes worth 255 and a final byte */
+#define EXTEND(t,base) \
+  if ((t) == 0) {					\
+    NEED_IP (1);					\
+    while (*ip == 0) {					\
+      (t) += 255;					\
+      ++ip;						\
+      NEED_IP (1);					\
+    }							\
+    (t) += (base) + *ip++;				\
+  }
+
+static inline void copy_literals (unsigned char* op,
+                                  const unsigned char* ip, size_t cb)
+{
+#if defined (CONFIG_LZO_SMALL)
+  while (cb--)
+    *op++ = *ip++;
+#else
+  memcpy (op, ip, cb);
+#endif
+}
+
+/* Matches may overlap the output when the offset is less than the
+   length, e.g. a run of one repeated byte.  These must be copied
+   forward a byte at a time. */
+
+static inline void copy_match (unsigned char* op, size_t off, size_t cb)
+{
+  const unsigned char* m = op - off;
+#if !defined (CONFIG_LZO_SMALL)
+  if (cb >= 8 && off >= cb) {
+    memcpy (op, m, cb);
+    return;
+  }
+#endif
+  while (cb--)
+    *op++ = *m++;
+}
+
+
+/** lzo1x_decompress decompresses cbSrc bytes of LZO1X data from src
+    into dst.  On entry, *pcbDst is the size of the destination.  On
+    return, it is the number of bytes written.  The result is LZO_E_OK
+    or one of the negative LZO error codes. */
+
+int lzo1x_decompress (const void* src, size_t cbSrc,
+                      void* dst, size_t* pcbDst)
+{
+  const unsigned char* ip = src;
+  const unsigned char* const ip_end = ip + cbSrc;
+  unsigned char* const out = dst;
+  unsigned char* op = out;
+  unsigned char* const op_end = op + *pcbDst;
+  size_t off;
+  size_t t;
+  int result;
+
+  NEED_IP (1);
+  if (*ip > 17) {		/* Leading literal run */
+    t = *ip++ - 17;
+    if (t < 4)
+      goto match_next;
+    NEED_OP (t);
+    NEED_IP (t + 1);
+    copy_literals (op, ip, t);
+    op += t;
+    ip += t;
+    goto first_literal_run;
+  }
+
+  for (;;) {
+    NEED_IP (1);
+    t = *ip++;
+    if (t >= 16)
+      goto match;
+    EXTEND (t, 15);
+    NEED_OP (t + 3);
+    NEED_IP (t + 4);
+    copy_literals (op, ip, t + 3);
+    op += t + 3;
+    ip += t + 3;
+
+  first_literal_run:
+    t = *ip++;
+    if (t >= 16)
+      goto match;
+		/* Three byte match just beyond the reach of M2 */
+    NEED_IP (1);
+    off = 1 + M2_MAX_OFFSET + (t >> 2) + (*ip++ << 2);
+    TEST_LB (off);
+    NEED_OP (3);
+    copy_match (op, off, 3);
+    op += 3;
+    goto match_done;
+
+    for (;;) {
+    match:
+      if (t >= 64) {		/* M2 */
+        NEED_IP (1);
+        off = 1 + ((t >> 2) & 7) + (*ip++ << 3);
+        t = (t >> 5) - 1;
+      }
+      else if (t >= 32) {	/* M3 */
+        t &= 31;
+        EXTEND (t, 31);
+        NEED_IP (2);
+        off = 1 + (ip[0] >> 2) + (ip[1] << 6);
+        ip += 2;
+      }
+      else if (t >= 16) {	/* M4 */
+        off = (t & 8) << 11;
+        t &= 7;
+        EXTEND (t, 7);
+        NEED_IP (2);
+        off += (ip[0] >> 2) + (ip[1] << 6);
+        ip += 2;
+        if (off == 0)
+          goto eof_found;
+        off += M4_BASE_OFFSET;
+      }
+      else {			/* M1, two bytes after literals */
+        NEED_IP (1);
+        off = 1 + (t >> 2) + (*ip++ << 2);
+        t = 0;
+      }
+      TEST_LB (off);
+      NEED_OP (t + 2);
+      copy_match (op, off, t + 2);
+      op += t + 2;
+
+    match_done:
+      t = ip[-2] & 3;
+      if (t == 0)
+        break;
+
+    match_next:
+      NEED_OP (t);
+      NEED_IP (t + 1);
+      copy_literals (op, ip, t);
+      op += t;
+      ip += t;
+      t = *ip++;
+    }
+  }
+
+ eof_found:
+  result = (ip == ip_end) ? LZO_E_OK : LZO_E_INPUT_NOT_CONSUMED;
+  goto done;
+
+ input_overrun:
+  result = LZO_E_INPUT_OVERRUN;
+  goto done;
+
+ output_overrun:
+  result = LZO_E_OUTPUT_OVERRUN;
+  goto done;
+
+ lookbehind_overrun:
+  result = LZO_E_LOOKBEHIND_OVERRUN;
+
+ done:
+  *pcbDst = op - out;
+  return result;
+}
@@ -42,3 +42,14 @@ unsigned long timer_delta (unsigned long start, unsigned long end)
 {
   return (end - start)/66660;
 }
+
+/* timer_delta_ticks
+
+   returns the difference in time in timer ticks.
+
+ */
+
+unsigned long timer_delta_ticks (unsigned long start, unsigned long end)
+{
+  return end - start;
+}
@@ -140,6 +140,17 @@ unsigned long timer_delta (unsigned long start, unsigned long end)
 #endif
 }
 
+/* timer_delta_ticks
+
+   returns the difference in time in timer ticks.
+
+ */
+
+unsigned long timer_delta_ticks (unsigned long start, unsigned long end)
+{
+  return end - start;
+}
+
 static __service_2 struct service_d lh79524_timer_service = {
   .init    = lh79524_timer_init,
   .release = lh79524_timer_release,
@@ -65,6 +65,17 @@ unsigned long timer_delta (unsigned long start, unsigned long end)
   return (end - start)/2;
 }
 
+/* timer_delta_ticks
+
+   returns the difference in time in timer ticks.
+
+ */
+
+unsigned long timer_delta_ticks (unsigned long start, unsigned long end)
+{
+  return end - start;
+}
+
 static __service_2 struct service_d lh7a40x_timer_service = {
   .init    = lh7a40x_timer_init,
   .release = lh7a40x_timer_release,
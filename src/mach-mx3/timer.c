@@ -48,6 +48,17 @@ unsigned long timer_delta (unsigned long start, unsigned long end)
   return end - start;
 }
 
+/* timer_delta_ticks
+
+   returns the difference in time in timer ticks.
+
+ */
+
+unsigned long timer_delta_ticks (unsigned long start, unsigned long end)
+{
+  return end - start;
+}
+
 static __service_2 struct service_d mx3x_timer_service = {
   .init    = mx3x_timer_init,
   .release = mx3x_timer_release,
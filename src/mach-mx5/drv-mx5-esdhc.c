@@ -68,6 +68,7 @@
 #include <mach/hardware.h>
 #include <console.h>
 #include <error.h>
+#include <block-cache.h>
 
 #include <debug_ll.h>
 
@@ -180,12 +181,15 @@ struct mmc_info {
 
 uint8_t __xbss(mmc) mmc_rgb[CB_CACHE_MAX];
 
+static struct driver_d mx5_esdhc_driver;
+
 bool mmc_card_acquired (void) {
   return mmc.acquired; }
 
 void mmc_clear (void) {
   memset (&mmc, 0, sizeof (mmc));
   mmc.ib = -1;
+  block_cache_invalidate (&mx5_esdhc_driver);
 }
 
 uint32_t ocr_host (void) {
@@ -1242,6 +1246,22 @@ ssize_t mx5_esdhc_read (struct descriptor_d* d, void* pv, size_t cb)
   return cbRead;
 }
 
+static int mx5_esdhc_query (struct descriptor_d* d, int index, void* pv)
+{
+  if (!mmc.acquired)
+    return ERROR_UNSUPPORTED;
+
+  switch (index) {
+  default:
+    return ERROR_UNSUPPORTED;
+  case QUERY_IOSIZE:		/* Whole sector cache fills */
+    *(unsigned long*)pv = mmc.cb_cache;
+    break;
+  }
+
+  return 0;
+}
+
 
 static __driver_5 struct driver_d mx5_esdhc_driver = {
   .name		= "mmc-esdhc-mx5",
@@ -1252,6 +1272,7 @@ static __driver_5 struct driver_d mx5_esdhc_driver = {
   .read		= mx5_esdhc_read,
 //  .write	= mx5_esdhc_write,
   .seek		= seek_helper,
+  .query	= mx5_esdhc_query,
 };
 
 static __service_6 struct service_d mx5_esdhc_service = {
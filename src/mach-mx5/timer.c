@@ -51,6 +51,14 @@ unsigned long timer_delta (unsigned long start, unsigned long end)
   return end - start;
 }
 
+/** compute the difference between two read timer values and return the
+   difference in timer ticks. */
+
+unsigned long timer_delta_ticks (unsigned long start, unsigned long end)
+{
+  return end - start;
+}
+
 
 /* usleep
 
@@ -57,6 +57,18 @@ unsigned long timer_delta (unsigned long start, unsigned long end)
   return (start - end)/(get_tclk ()/1000);
 }
 
+/* timer_delta_ticks
+
+   returns the difference in time in timer ticks.  The timer counts
+   down.
+
+ */
+
+unsigned long timer_delta_ticks (unsigned long start, unsigned long end)
+{
+  return start - end;
+}
+
 static __service_2 struct service_d orion5x_timer_service = {
   .init    = orion5x_timer_init,
   .release = orion5x_timer_release,
@@ -75,6 +75,17 @@ unsigned long timer_delta(unsigned long start, unsigned long end)
 	return (end - start) / 12;
 }
 
+/* timer_delta_ticks
+
+   returns the difference in time in timer ticks.
+
+ */
+
+unsigned long timer_delta_ticks(unsigned long start, unsigned long end)
+{
+	return end - start;
+}
+
 static __service_2 struct service_d s3c2410_timer_service = {
 	.init = s3c2410_timer_init,
 	.release = s3c2410_timer_release,
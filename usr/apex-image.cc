@@ -118,6 +118,7 @@
 #include <sys/types.h>
 #include <regex.h>
 #include <argp.h>
+#include <zlib.h>
 
 #include <list>
 #include <vector>
@@ -141,6 +142,8 @@ enum {
   sizeVariable  = 0x0,          // 00b
 };
 
+#define BLOCK_CRCS_MAX	(127/4)	// Block CRCs in one variable length field
+
 enum {
   fieldImageDescription                 = 0x10 | sizeVariable,
   fieldImageCreationDate                = 0x14 | sizeFour,
@@ -150,6 +153,8 @@ enum {
   fieldPayloadType                      = 0x3c | sizeOne,
   fieldPayloadDescription               = 0x40 | sizeVariable,
   fieldPayloadCompression               = 0x44 | sizeZero,
+  fieldPayloadBlockSize                 = 0x48 | sizeFour,
+  fieldPayloadBlockCRC                  = 0x4c | sizeVariable,
   fieldLinuxKernelArchitectureID        = 0x80 | sizeFour,
   fieldNOP                              = 0xfc | sizeZero,
 };
@@ -234,6 +239,10 @@ const char* describe_tag (uint8_t tag)
     return "fieldPayloadDescription";
   case fieldPayloadCompression:
     return "fieldPayloadCompression";
+  case fieldPayloadBlockSize:
+    return "fieldPayloadBlockSize";
+  case fieldPayloadBlockCRC:
+    return "fieldPayloadBlockCRC";
   case fieldLinuxKernelArchitectureID:
     return "fieldLinuxKernelArchitectureID";
   case fieldNOP:
@@ -253,6 +262,22 @@ const char* describe_image_type (unsigned long v)
   }
 };
 
+/** Return the name of the compression format of a file that APEX
+    will recognize by its signature, or NULL. */
+
+const char* describe_compression (const void* pv, size_t cb)
+{
+  static const uint8_t gzip[] = { 0x1f, 0x8b };
+  static const uint8_t lzop[] = {
+    0x89, 'L', 'Z', 'O', 0x00, 0x0d, 0x0a, 0x1a, 0x0a };
+
+  if (cb >= sizeof (gzip) && memcmp (pv, gzip, sizeof (gzip)) == 0)
+    return "gzip";
+  if (cb >= sizeof (lzop) && memcmp (pv, lzop, sizeof (lzop)) == 0)
+    return "lzop";
+  return NULL;
+}
+
 uint32_t compute_crc32 (uint32_t crc, const void* pv, int cb)
 {
 #define IPOLY		(0xedb88320)
@@ -430,7 +455,9 @@ struct Payload : public File {
   int type;
   uint32_t load_address;
   uint32_t entry_point;
-  bool compressed;
+  bool compress;                // Compress the payload when writing
+  bool compressed;              // Payload data is zlib or gzip
+  uint32_t block_size;          // Bytes covered by each block CRC or 0
 
   uint32_t crc_loaded;          // CRC as read from an existing image
 
@@ -439,15 +466,21 @@ struct Payload : public File {
       || load_address != ~0U
       || entry_point != ~0U
       || description
-      //      || compressed
+      || compress
+      || block_size
       ; }
+  size_t block_count (void) {
+    return block_size ? (cb + block_size - 1)/block_size : 0; }
   size_t header_size (void) {
     return 5                    // Mandatory length
       + (type ? 2 : 0)
       + (load_address != ~0U ? 5 : 0)
       + (entry_point != ~0U ? 5 : 0)
       + (description ? 1 + 1 + strlen (description) + 1 : 0)
-      + (compressed ? 1 : 0); }
+      + (compressed ? 1 : 0)
+      + (block_size ? 5 + block_count ()*4
+                      + 2*((block_count () + BLOCK_CRCS_MAX - 1)
+                           /BLOCK_CRCS_MAX) : 0); }
 
   uint32_t build_header (uint32_t crc, crope& rope) {
     unsigned char tag;
@@ -492,6 +525,34 @@ struct Payload : public File {
       crc = compute_crc32 (crc, &tag, 1);
       rope.append (tag);
     }
+    if (block_size) {
+      tag = fieldPayloadBlockSize;
+      uint32_t _block_size = swabl (block_size);
+      crc = compute_crc32 (crc, &tag, 1);
+      crc = compute_crc32 (crc, &_block_size, sizeof (_block_size));
+      rope.append (tag);
+      rope.append ((char*) &_block_size, sizeof (_block_size));
+
+	// Each field holds as many block CRCs as will fit
+      tag = fieldPayloadBlockCRC;
+      for (size_t i = 0; i < block_count (); ) {
+        size_t c = block_count () - i;
+        if (c > BLOCK_CRCS_MAX)
+          c = BLOCK_CRCS_MAX;
+        uint8_t length = c*4;
+        crc = compute_crc32 (crc, &tag, 1);
+        crc = compute_crc32 (crc, &length, 1);
+        rope.append (tag);
+        rope.append (length);
+        for (; c--; ++i) {
+          size_t ib = i*block_size;
+          size_t cbBlock = cb - ib < block_size ? cb - ib : block_size;
+          uint32_t _crc = swabl (compute_crc32 (0, (char*) pv + ib, cbBlock));
+          crc = compute_crc32 (crc, &_crc, sizeof (_crc));
+          rope.append ((char*) &_crc, sizeof (_crc));
+        }
+      }
+    }
     // Length is always last
     {
       tag = fieldPayloadLength;
@@ -506,9 +567,30 @@ struct Payload : public File {
 
   Payload () : description (NULL), type (0),
                load_address (~0), entry_point (~0),
-               compressed (false), crc_loaded (0) {}
+               compress (false), compressed (false), block_size (0),
+               crc_loaded (0) {}
   ~Payload () { }
 
+  /** Replace the payload data with a zlib compressed copy.  Files
+      that are already gzip or lzop compressed are used as they
+      are. */
+  void compress_payload (void) {
+    if (describe_compression (pv, cb)) {
+      compressed = true;
+      return;
+    }
+    uLongf cbCompressed = compressBound (cb);
+    Bytef* pbCompressed = (Bytef*) malloc (cbCompressed);
+    if (!pbCompressed
+        || compress2 (pbCompressed, &cbCompressed, (const Bytef*) pv, cb,
+                      Z_BEST_COMPRESSION) != Z_OK)
+      throw Exception ("unable to compress payload '%s'", szPath);
+    const char* _szPath = szPath;
+    set_external (pbCompressed, cbCompressed);
+    szPath = _szPath;
+    compressed = true;
+  }
+
   /** Merge payload with this.  The process of updating an image
       somtimes involves makes  */
   Payload& operator+= (Payload& payload) {
@@ -525,6 +607,10 @@ struct Payload : public File {
       entry_point = payload.entry_point;
     if (!description)
       description = payload.description;
+    if (!compressed)
+      compressed = payload.compressed;
+    if (!block_size)
+      block_size = payload.block_size;
     crc_loaded = 0;             // Clear the old value if it was loaded
 
     return *this;
@@ -623,6 +709,8 @@ struct Image : public std::list<Payload*>, public File
       _header_size += (*it)->header_size ();
     }
     _header_size += 4;           // CRC
+    if (_header_size > 255*16)
+      throw Exception ("header too large, block CRC size may be too small");
 
 	// Compute and store the header size byte
     uint8_t __header_size = (_header_size + 15)/16;
@@ -784,6 +872,9 @@ struct argp_option options[] = {
   { "description",      'd', "LABEL", 0,         "Set payload description"    },
   { "architecture-id",  'A', "NUMBER", 0,
                              "Set a value to override the architecture ID"    },
+  { "compress",		'z', 0, 0,          "Compress payload with zlib"    },
+  { "block-crc",	'b', "SIZE", 0,
+			    "Add a CRC for each SIZE bytes of the payload"    },
 
   { "force",		'f', 0, 0,        "Force overwrite of output file", 3 },
   { "verbose",		'v', 0, 0,        "Verbose output, when available"    },
@@ -814,8 +905,10 @@ struct argp argp = {
   "  The CRC of the header is a simple CRC of the header data, from the\n"
   "signature to the last byte before the CRC.  The CRC that protects each\n"
   "payload is computed the same way that the POSIX cksum command computes\n"
-  "the CRC.  This makes it easy to verify the identity of a payload."
-  "\n"
+  "the CRC.  This makes it easy to verify the identity of a payload.\n"
+  "  With --block-crc, the header also holds a CRC of each SIZE bytes of\n"
+  "the payload, computed from zero without the length, so that APEX can\n"
+  "stop at the first bad block and report where the damage lies.\n"
   "  ADDR is a 32 bit number in decimal or in hexadecimal if prefixed with 0x\n"
   "  TYPE is one of: kernel, initrd\n"
   "  FILE is either a filename, or possibly '.' when updating an image.\n"
@@ -824,6 +917,10 @@ struct argp argp = {
   "   apex-image aImage\n"
   "              # Create image with kernel and initrd\n"
   "   apex-image -t kernel zImage -t initrd aImage\n"
+  "              # Create image with a compressed initrd\n"
+  "   apex-image -t kernel Image -t initrd -z initrd aImage\n"
+  "              # Create image with a CRC for each 64KiB of the initrd\n"
+  "   apex-image -t kernel zImage -t initrd -b 65536 initrd aImage\n"
   "              # Update the load address for the first payload\n"
   "   apex-image -l 0xc0008000 aImage\n"
   "              # Update the load address for the second payload\n"
@@ -883,6 +980,16 @@ error_t arg_parser (int key, char* arg, struct argp_state* state)
     args.payload ()->description = arg;
     break;
 
+  case 'z':
+    args.payload ()->compress = true;
+    break;
+
+  case 'b':
+    args.payload ()->block_size = interpret_number (arg);
+    if (args.payload ()->block_size < 16)
+      argp_error (state, "block CRC size must be at least 16 bytes");
+    break;
+
   case 't':
     args.payload ()->type = interpret_image_type (arg);
     if (args.payload ()->type == 0)
@@ -1077,7 +1184,10 @@ void Image::load (struct arguments& args)
       payload->description = (char*) it.data ();
       break;
     case fieldPayloadCompression:
-      printf ("Payload Compression:  gzip\n");
+      payload->compressed = true;
+      break;
+    case fieldPayloadBlockSize:
+      payload->block_size = uint32_t (it);
       break;
     case fieldLinuxKernelArchitectureID:
       if (!architecture_id)
@@ -1192,11 +1302,23 @@ void Image::describe (struct arguments& args)
       if (multi_payload)
         strcpy (sz, "           ");
     }
+    if (payload.compressed) {
+      const char* szFormat = describe_compression (payload.pv, payload.cb);
+      printf ("%sCompression:  %s\n", sz, szFormat ? szFormat : "zlib");
+      if (multi_payload)
+        strcpy (sz, "           ");
+    }
     if (payload.cb) {
       printf ("%sLength:       %s\n", sz, describe_size (payload.cb));
       if (multi_payload)
         strcpy (sz, "           ");
     }
+    if (payload.block_size) {
+      printf ("%sBlock CRCs:   %zd of %s\n", sz, payload.block_count (),
+              describe_size (payload.block_size));
+      if (multi_payload)
+        strcpy (sz, "           ");
+    }
     if (payload.pv) {
       uint32_t crc = compute_crc32 (0, payload.pv, payload.cb);
       crc = compute_crc32_length (crc, payload.cb);
@@ -1285,6 +1407,12 @@ void apeximage (struct arguments& args)
     break;
   }
 
+	// Compress payloads before the header records their lengths
+  for (Image::iterator it = g_image.begin (); it != g_image.end (); ++it)
+    if ((*it) != &payloadOut && (*it)->compress && !(*it)->compressed
+        && (*it)->pv)
+      (*it)->compress_payload ();
+
   g_image.build_header (args);
 
   if (args.dry_run || args.verbose)